@@ -0,0 +1,450 @@
+// AmyMachine ahead-of-time translator
+// turns a program image into C++ source - one host function per
+// function of its control flow graph - and compiles that into a native
+// executable that reads and writes like riscvInterpreter
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "amyAot.h"
+
+//========================================================================
+// Runtime
+// everything the generated program needs besides its functions. guest
+// registers live in regs between host functions and in a local copy
+// (which g++ keeps in host registers) inside them. the interpreter
+// runs whatever the translated code cannot and never returns - the
+// program ends at HLT
+
+static const char* runtime = R"(
+typedef unsigned char byte;
+
+// a fixed array, so stores through it cannot alias anything else
+static byte memory[MEMORY_SIZE];
+static int32_t regs[16];
+
+// address arithmetic wraps like the interpreters' int math
+#define ADDR(base, offset) ((int32_t)((uint32_t)(base) + (uint32_t)(offset)))
+#define WRAP(a, op, b) ((int32_t)((uint32_t)(a) op (uint32_t)(b)))
+
+static inline int32_t load16 (int32_t address)
+{
+    int16_t value;
+    memcpy (&value, memory + address, 2);
+    return value;
+}
+static inline int32_t load32 (int32_t address)
+{
+    int32_t value;
+    memcpy (&value, memory + address, 4);
+    return value;
+}
+static inline void store16 (int32_t address, int32_t value)
+{
+    int16_t half = (int16_t)value;
+    memcpy (memory + address, &half, 2);
+}
+static inline void store32 (int32_t address, int32_t value)
+{
+    memcpy (memory + address, &value, 4);
+}
+
+// GETCHAR reads stdin in chunks (after flushing any prompt) and gets
+// EOF (-1) once it is closed
+static byte input[4096];
+static ssize_t inputPosition = 0;
+static ssize_t inputSize = 0;
+static bool inputClosed = false;
+static int32_t readInput ()
+{
+    if (inputPosition == inputSize && !inputClosed)
+    {
+        fflush (stdout);
+        inputSize = read (0, input, sizeof(input));
+        inputPosition = 0;
+        if (inputSize <= 0)
+        {
+            inputSize = 0;
+            inputClosed = true;
+        }
+    }
+    if (inputPosition < inputSize) return input[inputPosition++];
+    return EOF;
+}
+
+[[noreturn]] static void halt ()
+{
+    fflush (stdout);
+    exit (0);
+}
+
+[[noreturn]] static void invalidOpcode (byte opcode)
+{
+    printf ("Invalid opcode %x%x\n", (opcode & 0xf0) >> 4, opcode & 0x0f);
+    halt ();
+}
+
+// runs the guest from pc until it halts
+[[noreturn]] static void interpret (uint32_t pc)
+{
+    int32_t* r = regs;
+    while (true)
+    {
+        if (pc >= MEMORY_SIZE) halt ();
+        byte* instruction = memory + pc;
+        byte opcode = instruction[0];
+        byte dest = instruction[1] >> 4;
+        byte src1 = instruction[1] & 0xf;
+        byte src2 = instruction[2] >> 4;
+        int32_t imm = (int16_t)(instruction[2] | (instruction[3] << 8));
+        switch (opcode)
+        {
+            case OPCODE_LUI:  r[dest] = (r[dest] & 0xffff0000) | (uint16_t)imm; break;
+            case OPCODE_LLI:  r[dest] = (r[dest] & 0x0000ffff) | ((uint32_t)imm << 16); break;
+            case OPCODE_LB:   r[dest] = memory[ADDR(r[src1], imm)]; break;
+            case OPCODE_LH:   r[dest] = load16 (ADDR(r[src1], imm)); break;
+            case OPCODE_LW:   r[dest] = load32 (ADDR(r[src1], imm)); break;
+            case OPCODE_SB:   memory[ADDR(r[dest], imm)] = (byte)r[src1]; break;
+            case OPCODE_SH:   store16 (ADDR(r[dest], imm), r[src1]); break;
+            case OPCODE_SW:   store32 (ADDR(r[dest], imm), r[src1]); break;
+            case OPCODE_ADD:  r[dest] = WRAP(r[src1], +, r[src2]); break;
+            case OPCODE_SUB:  r[dest] = WRAP(r[src1], -, r[src2]); break;
+            case OPCODE_MUL:  r[dest] = WRAP(r[src1], *, r[src2]); break;
+            case OPCODE_DIV:  r[dest] = r[src1] / r[src2]; break;
+            case OPCODE_MOD:  r[dest] = r[src1] % r[src2]; break;
+            case OPCODE_SLL:  r[dest] = WRAP(r[src1], <<, r[src2] & 31); break;
+            case OPCODE_SRL:  r[dest] = WRAP(r[src1], >>, r[src2] & 31); break;
+            case OPCODE_SRA:  r[dest] = r[src1] >> (r[src2] & 31); break;
+            case OPCODE_OR:   r[dest] = r[src1] | r[src2]; break;
+            case OPCODE_AND:  r[dest] = r[src1] & r[src2]; break;
+            case OPCODE_XOR:  r[dest] = r[src1] ^ r[src2]; break;
+            case OPCODE_ADDI: r[dest] = WRAP(r[src1], +, imm); break;
+            case OPCODE_SUBI: r[dest] = WRAP(r[src1], -, imm); break;
+            case OPCODE_MULI: r[dest] = WRAP(r[src1], *, imm); break;
+            case OPCODE_DIVI: r[dest] = r[src1] / imm; break;
+            case OPCODE_MODI: r[dest] = r[src1] % imm; break;
+            case OPCODE_SLLI: r[dest] = WRAP(r[src1], <<, imm & 31); break;
+            case OPCODE_SRLI: r[dest] = WRAP(r[src1], >>, imm & 31); break;
+            case OPCODE_SRAI: r[dest] = r[src1] >> (imm & 31); break;
+            case OPCODE_ORI:  r[dest] = r[src1] | imm; break;
+            case OPCODE_ANDI: r[dest] = r[src1] & imm; break;
+            case OPCODE_XORI: r[dest] = r[src1] ^ imm; break;
+            case OPCODE_BEQ:  if (r[dest] == r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_BNE:  if (r[dest] != r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_BLT:  if (r[dest] <  r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_BLE:  if (r[dest] <= r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_BGT:  if (r[dest] >  r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_BGE:  if (r[dest] >= r[src1]) pc = r[src2] - 4; break;
+            case OPCODE_JMP:  pc = r[dest] - 4; break;
+            case OPCODE_CALL:
+                r[15] -= 4;
+                store32 (r[15], pc);
+                pc = r[dest] - 4;
+                break;
+            case OPCODE_RET:
+                pc = load32 (r[15]);
+                r[15] += 4;
+                break;
+            case OPCODE_PUSH:
+                r[15] -= 4;
+                store32 (r[15], r[dest]);
+                break;
+            case OPCODE_POP:
+                r[dest] = load32 (r[15]);
+                r[15] += 4;
+                break;
+            case OPCODE_NOP: break;
+            case OPCODE_HLT: halt ();
+            case OPCODE_GETCHAR: r[dest] = readInput (); break;
+            case OPCODE_PUTCHAR: putchar (r[dest]); break;
+            default: invalidOpcode (opcode);
+        }
+        pc += 4;
+    }
+}
+)";
+
+//========================================================================
+// Functions
+
+// instruction fields
+inline byte opcodeOf (const byte* image, uint32_t address) { return image[address]; }
+inline byte destOf (const byte* image, uint32_t address) { return image[address+1] >> 4; }
+inline byte src1Of (const byte* image, uint32_t address) { return image[address+1] & 0xf; }
+inline byte src2Of (const byte* image, uint32_t address) { return image[address+2] >> 4; }
+// immediates/offsets are stored in little endian
+inline int32_t immOf (const byte* image, uint32_t address) { return (int16_t)(image[address+2] | (image[address+3] << 8)); }
+
+// C++ for one instruction that does not end a block
+void
+emitInstruction (FILE* out, const byte* image, uint32_t address, uint32_t codeSize)
+{
+    byte opcode = opcodeOf (image, address);
+    byte dest = destOf (image, address);
+    byte src1 = src1Of (image, address);
+    byte src2 = src2Of (image, address);
+    int32_t imm = immOf (image, address);
+    if (opcode == OPCODE_LUI)
+        fprintf (out, "    r[%d] = (r[%d] & 0xffff0000) | 0x%x;\n", dest, dest, (uint16_t)imm);
+    else if (opcode == OPCODE_LLI)
+        fprintf (out, "    r[%d] = (r[%d] & 0x0000ffff) | (int32_t)0x%xu;\n", dest, dest, (uint32_t)imm << 16);
+    else if (opcode == OPCODE_LB)
+        fprintf (out, "    r[%d] = memory[ADDR(r[%d], %d)];\n", dest, src1, imm);
+    else if (opcode == OPCODE_LH)
+        fprintf (out, "    r[%d] = load16 (ADDR(r[%d], %d));\n", dest, src1, imm);
+    else if (opcode == OPCODE_LW)
+        fprintf (out, "    r[%d] = load32 (ADDR(r[%d], %d));\n", dest, src1, imm);
+    else if (opcode == OPCODE_SB || opcode == OPCODE_SH || opcode == OPCODE_SW)
+    {
+        // a store to the program leaves the rest to the interpreter,
+        // which runs the program as it now is
+        fprintf (out, "    a = ADDR(r[%d], %d);\n", dest, imm);
+        if (opcode == OPCODE_SB)      fprintf (out, "    memory[a] = (byte)r[%d];\n", src1);
+        else if (opcode == OPCODE_SH) fprintf (out, "    store16 (a, r[%d]);\n", src1);
+        else                          fprintf (out, "    store32 (a, r[%d]);\n", src1);
+        fprintf (out, "    if ((uint32_t)a < %uu) { pc = 0x%x; goto leave; }\n", codeSize, address + 4);
+    }
+    else if (instructionInfo (opcode).format == FORMAT_REGISTERS)
+    {
+        const char* op = instructionInfo (opcode).symbol;
+        if (opcode == OPCODE_ADD || opcode == OPCODE_SUB || opcode == OPCODE_MUL)
+            fprintf (out, "    r[%d] = WRAP(r[%d], %s, r[%d]);\n", dest, src1, op, src2);
+        else if (opcode == OPCODE_SLL || opcode == OPCODE_SRL)
+            fprintf (out, "    r[%d] = WRAP(r[%d], %s, r[%d] & 31);\n", dest, src1, op, src2);
+        else if (opcode == OPCODE_SRA)
+            fprintf (out, "    r[%d] = r[%d] >> (r[%d] & 31);\n", dest, src1, src2);
+        else
+            fprintf (out, "    r[%d] = r[%d] %s r[%d];\n", dest, src1, op, src2);
+    }
+    else if (instructionInfo (opcode).format == FORMAT_IMMEDIATE)
+    {
+        const char* op = instructionInfo (opcode).symbol;
+        if (opcode == OPCODE_ADDI || opcode == OPCODE_SUBI || opcode == OPCODE_MULI)
+            fprintf (out, "    r[%d] = WRAP(r[%d], %s, %d);\n", dest, src1, op, imm);
+        else if (opcode == OPCODE_SLLI || opcode == OPCODE_SRLI)
+            fprintf (out, "    r[%d] = WRAP(r[%d], %s, %d);\n", dest, src1, op, imm & 31);
+        else if (opcode == OPCODE_SRAI)
+            fprintf (out, "    r[%d] = r[%d] >> %d;\n", dest, src1, imm & 31);
+        else
+            fprintf (out, "    r[%d] = r[%d] %s %d;\n", dest, src1, op, imm);
+    }
+    else if (opcode == OPCODE_PUSH)
+    {
+        // the stack can grow down into the program too
+        fprintf (out, "    r[15] -= 4;\n    store32 (r[15], r[%d]);\n", dest);
+        fprintf (out, "    if ((uint32_t)r[15] < %uu) { pc = 0x%x; goto leave; }\n", codeSize, address + 4);
+    }
+    else if (opcode == OPCODE_POP)
+        fprintf (out, "    r[%d] = load32 (r[15]);\n    r[15] += 4;\n", dest);
+    else if (opcode == OPCODE_GETCHAR)
+        fprintf (out, "    r[%d] = readInput ();\n", dest);
+    else if (opcode == OPCODE_PUTCHAR)
+        fprintf (out, "    putchar (r[%d]);\n", dest);
+    // NOP
+}
+
+// true if the instruction may write the program and leave for the
+// interpreter
+inline bool
+storesToMemory (byte opcode)
+{
+    return opcode == OPCODE_SB || opcode == OPCODE_SH || opcode == OPCODE_SW
+        || opcode == OPCODE_PUSH || opcode == OPCODE_CALL;
+}
+
+// continues at address - a goto if it is a block of this function,
+// the function's switch otherwise
+void
+emitGoto (FILE* out, const ControlFlowGraph* cfg, const bool* inFunction, uint32_t address, const char* indent)
+{
+    uint32_t block = address < cfg->codeSize ? cfg->blockAt[address / 4] : CFG_NONE;
+    if (block != CFG_NONE && inFunction[block]) fprintf (out, "%sgoto L%x;\n", indent, address);
+    else fprintf (out, "%s{ pc = 0x%x; goto dispatch; }\n", indent, address);
+}
+
+// the host function for the guest function starting at entry. it holds
+// every block reachable from the entry without following calls (blocks
+// shared with other functions are copied) and returns the address RET
+// popped
+void
+emitFunction (FILE* out, const byte* image, const ControlFlowGraph* cfg, uint32_t entry, bool* inFunction,
+    uint32_t* stack)
+{
+    // the blocks reachable from the entry
+    for (uint32_t b = 0; b < cfg->numBlocks; ++b) inFunction[b] = false;
+    uint32_t top = 0;
+    stack[top++] = cfg->blockAt[entry / 4];
+    inFunction[stack[0]] = true;
+    while (top > 0)
+    {
+        const CfgBlock& block = cfg->blocks[stack[--top]];
+        for (int i = 0; i < block.numSuccessors; ++i)
+        {
+            if (inFunction[block.successors[i]]) continue;
+            inFunction[block.successors[i]] = true;
+            stack[top++] = block.successors[i];
+        }
+    }
+
+    fprintf (out, "static uint32_t\nf%x ()\n{\n", entry);
+    fprintf (out, "    int32_t r[16];\n    memcpy (r, regs, sizeof(r));\n    uint32_t pc;\n    int32_t a;\n");
+    fprintf (out, "    goto L%x;\n", entry);
+
+    bool stores = false;
+    for (uint32_t b = 0; b < cfg->numBlocks; ++b)
+    {
+        if (!inFunction[b]) continue;
+        const CfgBlock& block = cfg->blocks[b];
+        fprintf (out, "L%x:\n", block.start);
+        uint32_t last = block.end - 4;
+        for (uint32_t address = block.start; address < last; address += 4)
+        {
+            emitInstruction (out, image, address, cfg->codeSize);
+            if (storesToMemory (opcodeOf (image, address))) stores = true;
+        }
+
+        byte opcode = opcodeOf (image, last);
+        if (storesToMemory (opcode)) stores = true;
+        uint32_t target = cfg->targets[last / 4];
+        if (opcode >= OPCODE_BEQ && opcode <= OPCODE_JMP)
+        {
+            byte reg = opcode == OPCODE_JMP ? destOf (image, last) : src2Of (image, last);
+            const char* indent = "    ";
+            if (hasFlag (opcode, ISA_CONDITIONAL))
+            {
+                fprintf (out, "    if (r[%d] %s r[%d])\n    {\n", destOf (image, last),
+                    instructionInfo (opcode).symbol, src1Of (image, last));
+                indent = "        ";
+            }
+            // the graph's target holds on every path it followed - the
+            // check keeps paths it did not follow correct
+            if (target != CFG_NONE)
+            {
+                fprintf (out, "%sif (r[%d] == 0x%x) goto L%x;\n", indent, reg, target, target);
+            }
+            fprintf (out, "%spc = r[%d];\n%sgoto dispatch;\n", indent, reg, indent);
+            if (hasFlag (opcode, ISA_CONDITIONAL))
+            {
+                fprintf (out, "    }\n");
+                emitGoto (out, cfg, inFunction, block.end, "    ");
+            }
+        }
+        else if (opcode == OPCODE_CALL)
+        {
+            byte reg = destOf (image, last);
+            fprintf (out, "    r[15] -= 4;\n    store32 (r[15], 0x%x);\n", last);
+            // the return address written into the program - the
+            // interpreter runs the callee
+            fprintf (out, "    if ((uint32_t)r[15] < %uu) { pc = r[%d]; goto leave; }\n", cfg->codeSize, reg);
+            fprintf (out, "    memcpy (regs, r, sizeof(r));\n");
+            if (target != CFG_NONE)
+                fprintf (out, "    a = r[%d] == 0x%x ? f%x () : call (r[%d]);\n", reg, target, target, reg);
+            else
+                fprintf (out, "    a = call (r[%d]);\n", reg);
+            fprintf (out, "    memcpy (r, regs, sizeof(r));\n");
+            // the callee returned somewhere else
+            fprintf (out, "    if ((uint32_t)a != 0x%x) { pc = a + 4; goto dispatch; }\n", last);
+            emitGoto (out, cfg, inFunction, block.end, "    ");
+        }
+        else if (opcode == OPCODE_RET)
+        {
+            fprintf (out, "    a = load32 (r[15]);\n    r[15] += 4;\n");
+            fprintf (out, "    memcpy (regs, r, sizeof(r));\n    return a;\n");
+        }
+        else if (opcode == OPCODE_HLT)
+        {
+            fprintf (out, "    halt ();\n");
+        }
+        else if (opcode == OPCODE_UNDEFINED || opcode >= NUM_OPCODES)
+        {
+            fprintf (out, "    invalidOpcode (0x%x);\n", opcode);
+        }
+        else
+        {
+            emitInstruction (out, image, last, cfg->codeSize);
+            emitGoto (out, cfg, inFunction, block.end, "    ");
+        }
+    }
+
+    // computed targets - the blocks of this function, or the interpreter
+    fprintf (out, "dispatch:\n    switch (pc)\n    {\n");
+    for (uint32_t b = 0; b < cfg->numBlocks; ++b)
+        if (inFunction[b]) fprintf (out, "        case 0x%x: goto L%x;\n", cfg->blocks[b].start, cfg->blocks[b].start);
+    fprintf (out, "    }\n");
+    if (stores) fprintf (out, "leave:\n");
+    fprintf (out, "    memcpy (regs, r, sizeof(r));\n    interpret (pc);\n}\n\n");
+}
+
+//========================================================================
+
+void
+translateToCpp (FILE* out, const byte* image, size_t imageSize, size_t memorySize, const ControlFlowGraph* cfg)
+{
+    fprintf (out, "// generated by riscvInterpreter --aot\n\n");
+    fprintf (out, "#include <stdio.h>\n#include <stdlib.h>\n#include <stdint.h>\n#include <string.h>\n#include <unistd.h>\n\n");
+    // the opcodes the runtime's interpreter is written against
+    for (const InstructionInfo& info : instructionSet)
+        fprintf (out, "const int OPCODE_%s = 0x%x;\n", info.mnemonic, info.opcode);
+    fprintf (out, "const uint32_t MEMORY_SIZE = %zuu;\n", memorySize);
+    fputs (runtime, out);
+
+    fprintf (out, "\nstatic const byte image[%zu] = {", imageSize + 1);
+    for (size_t i = 0; i < imageSize; ++i)
+        fprintf (out, "%s0x%02x,", i % 16 == 0 ? "\n    " : " ", image[i]);
+    fprintf (out, "\n};\n\n");
+
+    // prototypes and the table unresolved calls go through
+    fprintf (out, "static uint32_t call (int32_t target);\n");
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        fprintf (out, "static uint32_t f%x ();\n", cfg->functions[f].entry);
+    fprintf (out, "\n");
+
+    bool* inFunction = (bool*) malloc ((cfg->numBlocks + 1) * sizeof(bool));
+    uint32_t* stack = (uint32_t*) malloc ((cfg->numBlocks + 1) * sizeof(uint32_t));
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        if (cfg->numBlocks > 0) emitFunction (out, image, cfg, cfg->functions[f].entry, inFunction, stack);
+    free (inFunction);
+    free (stack);
+
+    fprintf (out, "static uint32_t\ncall (int32_t target)\n{\n    switch (target)\n    {\n");
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        fprintf (out, "        case 0x%x: return f%x ();\n", cfg->functions[f].entry, cfg->functions[f].entry);
+    fprintf (out, "    }\n    interpret (target);\n}\n\n");
+
+    // memory and registers as AmyMachine::reset leaves them
+    fprintf (out, "int\nmain ()\n{\n");
+    fprintf (out, "    memcpy (memory, image, %zu);\n", imageSize);
+    fprintf (out, "    regs[14] = MEMORY_SIZE - (MEMORY_SIZE %% 4);\n");
+    fprintf (out, "    regs[15] = MEMORY_SIZE - (MEMORY_SIZE %% 4);\n");
+    if (cfg->numBlocks > 0) fprintf (out, "    interpret (f0 () + 4);\n}\n");
+    else                    fprintf (out, "    interpret (0);\n}\n");
+}
+
+bool
+compileNative (const char* outputPath, const byte* image, size_t imageSize, size_t memorySize,
+    const ControlFlowGraph* cfg)
+{
+    std::string sourcePath = std::string (outputPath) + ".cpp";
+    FILE* out = fopen (sourcePath.c_str (), "w");
+    if (out == nullptr)
+    {
+        printf ("Could not write '%s'\n", sourcePath.c_str ());
+        return false;
+    }
+    translateToCpp (out, image, imageSize, memorySize, cfg);
+    fclose (out);
+
+    // paths are quoted for the shell
+    std::string command = "g++ -O2 -o '" + std::string (outputPath) + "' '" + sourcePath + "'";
+    if (system (command.c_str ()) != 0)
+    {
+        printf ("Could not compile '%s'\n", sourcePath.c_str ());
+        return false;
+    }
+    return true;
+}
+
+//========================================================================
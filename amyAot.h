@@ -0,0 +1,35 @@
+// AmyMachine ahead-of-time translator
+// turns a program image into C++ source - one host function per
+// function of its control flow graph - and compiles that into a native
+// executable that reads and writes like riscvInterpreter
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_AOT_H
+#define AMY_AOT_H
+
+#include <stdio.h>
+
+#include "amyMachine.h"
+#include "amyCfg.h"
+
+//========================================================================
+
+// writes a standalone C++ program that runs the image with memorySize
+// bytes of memory. branches whose targets the graph found become gotos
+// (checked against the register at run time), the rest go through a
+// switch over the blocks of the function, and anything that leaves the
+// translated code (unknown targets, returns elsewhere, stores to the
+// program) continues in an interpreter built into the program
+void translateToCpp (FILE* out, const byte* image, size_t imageSize, size_t memorySize,
+    const ControlFlowGraph* cfg);
+
+// translates the image into outputPath.cpp and compiles that with
+// g++ -O2 into outputPath. prints what went wrong and returns false if
+// either step fails
+bool compileNative (const char* outputPath, const byte* image, size_t imageSize, size_t memorySize,
+    const ControlFlowGraph* cfg);
+
+//========================================================================
+
+#endif
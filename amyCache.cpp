@@ -0,0 +1,299 @@
+// AmyMachine analysis cache
+// keeps the per-program work of a machine - the predecoded records
+// with their superinstructions, and the control flow graph - in a file
+// named after a hash of the program image, so the next process that
+// loads the same image maps it back in instead of doing it again
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "amyCache.h"
+
+//========================================================================
+// File layout
+// the header, then the records, then the graph's blocks, functions,
+// unresolved sites, targets and blockAt. every section is a whole
+// number of 4 byte words, so each starts aligned
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    // words of the program the graph covers
+    uint32_t codeSize;
+    uint64_t key;
+    uint64_t imageSize;
+    uint64_t memorySize;
+    // 0 if no records were saved
+    uint32_t numRecords;
+    byte recordsVerified;
+    byte recordsFused;
+    byte hasGraph;
+    byte unused;
+    uint32_t numBlocks;
+    uint32_t numFunctions;
+    uint32_t numUnresolved;
+    uint32_t unused2;
+};
+
+static const char cacheMagic[8] = { 'A', 'M', 'Y', 'C', 'A', 'C', 'H', 'E' };
+
+struct ProgramCache
+{
+    std::string path;
+    uint64_t key;
+    uint64_t imageSize;
+    uint64_t memorySize;
+    // the file an earlier run wrote (null if there was none) - kept
+    // mapped while the sections below point into it
+    void* mapping;
+    size_t mappingSize;
+    // the saved records - in the mapping, or in ownedRecords once saved
+    const CachedRecord* records;
+    uint32_t numRecords;
+    bool recordsVerified;
+    bool recordsFused;
+    CachedRecord* ownedRecords;
+    // the saved graph - its arrays are in the mapping, or in ownedGraph
+    // once saved
+    ControlFlowGraph graph;
+    bool hasGraph;
+    ControlFlowGraph* ownedGraph;
+};
+
+// FNV-1a over the image, then the version and memory size
+static uint64_t
+hashImage (const byte* image, size_t imageSize, size_t memorySize)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < imageSize; ++i)
+        hash = (hash ^ image[i]) * 0x100000001b3ull;
+    uint64_t extra[3] = { CACHE_VERSION, imageSize, memorySize };
+    const byte* bytes = (const byte*)extra;
+    for (size_t i = 0; i < sizeof(extra); ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+// bytes the graph's arrays take in the file
+static size_t
+graphSize (uint32_t codeSize, uint32_t numBlocks, uint32_t numFunctions, uint32_t numUnresolved)
+{
+    return numBlocks * sizeof(CfgBlock) + numFunctions * sizeof(CfgFunction)
+        + numUnresolved * sizeof(CfgSite) + 2 * (codeSize / 4) * sizeof(uint32_t);
+}
+
+// a graph with its own copies of the arrays (with a spare entry each,
+// like buildControlFlowGraph allocates them)
+template <typename T>
+static T*
+copyArray (const T* from, uint32_t count)
+{
+    T* to = (T*) malloc ((count + 1) * sizeof(T));
+    memcpy (to, from, count * sizeof(T));
+    return to;
+}
+
+static ControlFlowGraph*
+copyGraph (const ControlFlowGraph* from)
+{
+    ControlFlowGraph* to = (ControlFlowGraph*) calloc (1, sizeof(ControlFlowGraph));
+    *to = *from;
+    to->blocks = copyArray (from->blocks, from->numBlocks);
+    to->functions = copyArray (from->functions, from->numFunctions);
+    to->unresolved = copyArray (from->unresolved, from->numUnresolved);
+    to->targets = copyArray (from->targets, from->codeSize / 4);
+    to->blockAt = copyArray (from->blockAt, from->codeSize / 4);
+    return to;
+}
+
+// writes everything saved so far - into a temporary file that is then
+// renamed over the old one, so processes sharing the directory only
+// ever map whole files
+static void
+writeCache (ProgramCache* cache)
+{
+    CacheHeader header;
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = CACHE_VERSION;
+    header.key = cache->key;
+    header.imageSize = cache->imageSize;
+    header.memorySize = cache->memorySize;
+    header.numRecords = cache->records != nullptr ? cache->numRecords : 0;
+    header.recordsVerified = cache->recordsVerified;
+    header.recordsFused = cache->recordsFused;
+    header.hasGraph = cache->hasGraph;
+    if (cache->hasGraph)
+    {
+        header.codeSize = cache->graph.codeSize;
+        header.numBlocks = cache->graph.numBlocks;
+        header.numFunctions = cache->graph.numFunctions;
+        header.numUnresolved = cache->graph.numUnresolved;
+    }
+
+    std::string temporary = cache->path + "." + std::to_string (getpid ());
+    FILE* out = fopen (temporary.c_str (), "wb");
+    if (out == nullptr) return;
+    bool ok = fwrite (&header, sizeof(header), 1, out) == 1;
+    if (header.numRecords > 0)
+        ok = ok && fwrite (cache->records, sizeof(CachedRecord), header.numRecords, out) == header.numRecords;
+    if (cache->hasGraph)
+    {
+        const ControlFlowGraph& g = cache->graph;
+        uint32_t numWords = g.codeSize / 4;
+        ok = ok && fwrite (g.blocks, sizeof(CfgBlock), g.numBlocks, out) == g.numBlocks;
+        ok = ok && fwrite (g.functions, sizeof(CfgFunction), g.numFunctions, out) == g.numFunctions;
+        ok = ok && fwrite (g.unresolved, sizeof(CfgSite), g.numUnresolved, out) == g.numUnresolved;
+        ok = ok && fwrite (g.targets, sizeof(uint32_t), numWords, out) == numWords;
+        ok = ok && fwrite (g.blockAt, sizeof(uint32_t), numWords, out) == numWords;
+    }
+    ok = fclose (out) == 0 && ok;
+    if (!ok || rename (temporary.c_str (), cache->path.c_str ()) != 0)
+        unlink (temporary.c_str ());
+}
+
+// points the cache's sections into the mapped file if it holds this
+// image's analysis, and unmaps it otherwise
+static void
+readMapping (ProgramCache* cache)
+{
+    const CacheHeader* header = (const CacheHeader*)cache->mapping;
+    size_t expected = sizeof(CacheHeader);
+    bool valid = cache->mappingSize >= sizeof(CacheHeader)
+        && memcmp (header->magic, cacheMagic, sizeof(cacheMagic)) == 0
+        && header->version == CACHE_VERSION
+        && header->key == cache->key
+        && header->imageSize == cache->imageSize
+        && header->memorySize == cache->memorySize;
+    if (valid)
+    {
+        expected += header->numRecords * sizeof(CachedRecord);
+        if (header->hasGraph)
+            expected += graphSize (header->codeSize, header->numBlocks, header->numFunctions, header->numUnresolved);
+        valid = cache->mappingSize == expected;
+    }
+    if (!valid)
+    {
+        munmap (cache->mapping, cache->mappingSize);
+        cache->mapping = nullptr;
+        return;
+    }
+
+    const byte* section = (const byte*)cache->mapping + sizeof(CacheHeader);
+    if (header->numRecords > 0)
+    {
+        cache->records = (const CachedRecord*)section;
+        cache->numRecords = header->numRecords;
+        cache->recordsVerified = header->recordsVerified;
+        cache->recordsFused = header->recordsFused;
+        section += header->numRecords * sizeof(CachedRecord);
+    }
+    if (header->hasGraph)
+    {
+        ControlFlowGraph& g = cache->graph;
+        g.codeSize = header->codeSize;
+        g.numBlocks = header->numBlocks;
+        g.numFunctions = header->numFunctions;
+        g.numUnresolved = header->numUnresolved;
+        g.blocks = (CfgBlock*)section;
+        section += g.numBlocks * sizeof(CfgBlock);
+        g.functions = (CfgFunction*)section;
+        section += g.numFunctions * sizeof(CfgFunction);
+        g.unresolved = (CfgSite*)section;
+        section += g.numUnresolved * sizeof(CfgSite);
+        g.targets = (uint32_t*)section;
+        section += (g.codeSize / 4) * sizeof(uint32_t);
+        g.blockAt = (uint32_t*)section;
+        cache->hasGraph = true;
+    }
+}
+
+//========================================================================
+
+ProgramCache*
+openProgramCache (const char* directory, const byte* image, size_t imageSize, size_t memorySize)
+{
+    ProgramCache* cache = new ProgramCache ();
+    cache->key = hashImage (image, imageSize, memorySize);
+    cache->imageSize = imageSize;
+    cache->memorySize = memorySize;
+    char name[32];
+    snprintf (name, sizeof(name), "%016llx.amycache", (unsigned long long)cache->key);
+    cache->path = std::string (directory) + "/" + name;
+    // the first run creates the directory
+    mkdir (directory, 0777);
+
+    int fd = open (cache->path.c_str (), O_RDONLY);
+    if (fd < 0) return cache;
+    struct stat info;
+    if (fstat (fd, &info) == 0 && info.st_size > 0)
+    {
+        cache->mappingSize = info.st_size;
+        cache->mapping = mmap (nullptr, cache->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (cache->mapping == MAP_FAILED) cache->mapping = nullptr;
+    }
+    close (fd);
+    if (cache->mapping != nullptr) readMapping (cache);
+    return cache;
+}
+
+void
+closeProgramCache (ProgramCache* cache)
+{
+    if (cache == nullptr) return;
+    if (cache->mapping != nullptr) munmap (cache->mapping, cache->mappingSize);
+    free (cache->ownedRecords);
+    freeControlFlowGraph (cache->ownedGraph);
+    delete cache;
+}
+
+const CachedRecord*
+cachedRecords (const ProgramCache* cache, uint32_t numRecords, bool verified, bool fused)
+{
+    if (cache->records == nullptr || cache->numRecords != numRecords) return nullptr;
+    if (cache->recordsVerified != verified || cache->recordsFused != fused) return nullptr;
+    return cache->records;
+}
+
+void
+saveRecords (ProgramCache* cache, const CachedRecord* records, uint32_t numRecords, bool verified, bool fused)
+{
+    // there is nothing to map back in for an empty program
+    if (numRecords == 0) return;
+    free (cache->ownedRecords);
+    cache->ownedRecords = copyArray (records, numRecords);
+    cache->records = cache->ownedRecords;
+    cache->numRecords = numRecords;
+    cache->recordsVerified = verified;
+    cache->recordsFused = fused;
+    writeCache (cache);
+}
+
+ControlFlowGraph*
+cachedControlFlowGraph (const ProgramCache* cache)
+{
+    if (!cache->hasGraph) return nullptr;
+    return copyGraph (&cache->graph);
+}
+
+void
+saveControlFlowGraph (ProgramCache* cache, const ControlFlowGraph* cfg)
+{
+    ControlFlowGraph* copy = copyGraph (cfg);
+    freeControlFlowGraph (cache->ownedGraph);
+    cache->ownedGraph = copy;
+    cache->graph = *copy;
+    cache->hasGraph = true;
+    writeCache (cache);
+}
+
+//========================================================================
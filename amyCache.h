@@ -0,0 +1,57 @@
+// AmyMachine analysis cache
+// keeps the per-program work of a machine - the predecoded records
+// with their superinstructions, and the control flow graph - in a file
+// named after a hash of the program image, so the next process that
+// loads the same image maps it back in instead of doing it again
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_CACHE_H
+#define AMY_CACHE_H
+
+#include "amyMachine.h"
+#include "amyCfg.h"
+
+//========================================================================
+
+// part of the key - bump whenever decoding, superinstructions or the
+// control flow analysis change what they produce, so old files are
+// never read
+const uint32_t CACHE_VERSION = 3;
+
+// a predecoded record without its handler address (which moves from one
+// process to the next) - kind is the opcode for a plain handler, or
+// NUM_OPCODES plus the superinstruction for a fused one
+struct CachedRecord
+{
+    byte kind;
+    byte dest;
+    byte src1;
+    byte src2;
+    int32_t imm;
+    uint32_t runLength;
+};
+
+struct ProgramCache;
+
+// the cache of an image (run with memorySize bytes of memory) in
+// directory. maps in the file an earlier run wrote, if there is one
+// and it was written for this image by this version
+ProgramCache* openProgramCache (const char* directory, const byte* image, size_t imageSize, size_t memorySize);
+void closeProgramCache (ProgramCache* cache);
+
+// the records a decode of numRecords records with the same settings
+// saved, or null
+const CachedRecord* cachedRecords (const ProgramCache* cache, uint32_t numRecords, bool verified, bool fused);
+// replaces the saved records and writes the file
+void saveRecords (ProgramCache* cache, const CachedRecord* records, uint32_t numRecords, bool verified, bool fused);
+
+// a copy of the saved control flow graph (freed with
+// freeControlFlowGraph), or null
+ControlFlowGraph* cachedControlFlowGraph (const ProgramCache* cache);
+// replaces the saved control flow graph and writes the file
+void saveControlFlowGraph (ProgramCache* cache, const ControlFlowGraph* cfg);
+
+//========================================================================
+
+#endif
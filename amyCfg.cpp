@@ -0,0 +1,597 @@
+// AmyMachine control flow
+// recovers the basic blocks and functions of a program image before it
+// runs. every branch, JMP and CALL goes through a register, so targets
+// are found by following the constants LUI/LLI/ADDI (and the rest of
+// the arithmetic) build in registers
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>   //memset
+
+#include "amyCfg.h"
+
+//========================================================================
+// Constant propagation
+// a forward dataflow over every instruction reachable from address 0.
+// each register is tracked bit by bit (LUI and LLI each set half of a
+// register), and where control meets only the bits every path agrees
+// on stay known. calls flow into the callee (so constants passed in
+// registers are followed) and on to the instruction after the CALL,
+// where only the registers the callee may write are forgotten
+
+// what is known about the registers before an instruction
+struct KnownRegisters
+{
+    uint32_t knownBits[16];
+    uint32_t value[16];
+};
+
+struct Analysis
+{
+    const byte* image;
+    uint32_t codeSize;
+    uint32_t numWords;
+    size_t memorySize;
+    // known registers before each word (where reached)
+    KnownRegisters* in;
+    bool* reached;
+    // words waiting to be looked at (again)
+    uint32_t* work;
+    uint32_t workSize;
+    bool* queued;
+    // registers the function at each word is taken to clobber
+    uint16_t* assumedClobbers;
+};
+
+// instruction fields
+inline byte opcodeAt (const byte* image, uint32_t address) { return image[address]; }
+inline byte destAt (const byte* image, uint32_t address) { return image[address+1] >> 4; }
+inline byte src1At (const byte* image, uint32_t address) { return image[address+1] & 0xf; }
+inline byte src2At (const byte* image, uint32_t address) { return image[address+2] >> 4; }
+// immediates/offsets are stored in little endian
+inline int32_t immAt (const byte* image, uint32_t address) { return *(int16_t*)&image[address+2]; }
+
+inline bool
+isBranch (byte opcode)
+{
+    return hasFlag (opcode, ISA_CONDITIONAL);
+}
+
+// true for instructions control does not fall past
+inline bool
+endsBlock (byte opcode)
+{
+    return hasFlag (opcode, ISA_CONTROL | ISA_HALTS);
+}
+
+// register holding the target of a branch/jump/call
+inline byte
+targetRegister (const byte* image, uint32_t address)
+{
+    return isBranch (opcodeAt (image, address)) ? src2At (image, address) : destAt (image, address);
+}
+
+// registers an instruction writes (CALL/RET leave sp as it was, once
+// the callee returns)
+inline uint16_t
+writes (const byte* image, uint32_t address)
+{
+    byte opcode = opcodeAt (image, address);
+    uint16_t written = 0;
+    if (hasFlag (opcode, ISA_WRITES_DEST)) written |= 1 << destAt (image, address);
+    if (hasFlag (opcode, ISA_WRITES_SP) && !hasFlag (opcode, ISA_CONTROL)) written |= 1 << sp;
+    return written;
+}
+
+inline bool
+isKnown (const KnownRegisters& r, byte reg)
+{
+    return r.knownBits[reg] == 0xffffffff;
+}
+
+inline void
+forget (KnownRegisters& r, byte reg)
+{
+    r.knownBits[reg] = 0;
+    r.value[reg] = 0;
+}
+
+inline void
+setKnown (KnownRegisters& r, byte reg, uint32_t value)
+{
+    r.knownBits[reg] = 0xffffffff;
+    r.value[reg] = value;
+}
+
+// folds ADD..XOR like the interpreters compute them - false for a
+// division that traps
+bool
+fold (byte opcode, int32_t a, int32_t b, uint32_t* result)
+{
+    switch (opcode)
+    {
+        case OPCODE_ADD: *result = (uint32_t)a + (uint32_t)b; return true;
+        case OPCODE_SUB: *result = (uint32_t)a - (uint32_t)b; return true;
+        case OPCODE_MUL: *result = (uint32_t)a * (uint32_t)b; return true;
+        case OPCODE_DIV:
+        case OPCODE_MOD:
+            if (b == 0 || (a == INT32_MIN && b == -1)) return false;
+            *result = opcode == OPCODE_DIV ? a / b : a % b;
+            return true;
+        case OPCODE_SLL: *result = (uint32_t)a << (b & 31); return true;
+        case OPCODE_SRL: *result = (uint32_t)a >> (b & 31); return true;
+        case OPCODE_SRA: *result = a >> (b & 31); return true;
+        case OPCODE_OR:  *result = a | b; return true;
+        case OPCODE_AND: *result = a & b; return true;
+        default:         *result = a ^ b; return true;
+    }
+}
+
+// what an instruction (other than a branch/jump/call/return) leaves in
+// the registers
+void
+transfer (const byte* image, uint32_t address, KnownRegisters& r)
+{
+    byte opcode = opcodeAt (image, address);
+    byte dest = destAt (image, address);
+    byte src1 = src1At (image, address);
+    int32_t imm = immAt (image, address);
+    uint32_t result;
+    switch (opcode)
+    {
+        // LUI/LLI write the first/last 2 bytes of dest
+        case OPCODE_LUI:
+            r.knownBits[dest] |= 0x0000ffff;
+            r.value[dest] = (r.value[dest] & 0xffff0000) | (uint16_t)imm;
+            break;
+        case OPCODE_LLI:
+            r.knownBits[dest] |= 0xffff0000;
+            r.value[dest] = (r.value[dest] & 0x0000ffff) | ((uint32_t)imm << 16);
+            break;
+
+        case OPCODE_ADD: case OPCODE_SUB: case OPCODE_MUL: case OPCODE_DIV:
+        case OPCODE_MOD: case OPCODE_SLL: case OPCODE_SRL: case OPCODE_SRA:
+        case OPCODE_OR:  case OPCODE_AND: case OPCODE_XOR:
+        {
+            byte src2 = src2At (image, address);
+            if (isKnown (r, src1) && isKnown (r, src2) && fold (opcode, r.value[src1], r.value[src2], &result))
+                setKnown (r, dest, result);
+            else forget (r, dest);
+            break;
+        }
+        // immediate forms are in the same order as the register forms
+        case OPCODE_ADDI: case OPCODE_SUBI: case OPCODE_MULI: case OPCODE_DIVI:
+        case OPCODE_MODI: case OPCODE_SLLI: case OPCODE_SRLI: case OPCODE_SRAI:
+        case OPCODE_ORI:  case OPCODE_ANDI: case OPCODE_XORI:
+            if (isKnown (r, src1) && fold (opcode - OPCODE_ADDI + OPCODE_ADD, r.value[src1], imm, &result))
+                setKnown (r, dest, result);
+            else forget (r, dest);
+            break;
+
+        case OPCODE_PUSH:
+            if (isKnown (r, sp)) r.value[sp] -= 4;
+            else forget (r, sp);
+            break;
+        case OPCODE_POP:
+            forget (r, dest);
+            if (isKnown (r, sp)) r.value[sp] += 4;
+            else forget (r, sp);
+            break;
+
+        // loads and GETCHAR write what the analysis cannot know
+        default:
+            for (byte reg = 0; reg < 16; ++reg)
+                if (writes (image, address) & (1 << reg)) forget (r, reg);
+            break;
+    }
+}
+
+// the program instruction register reg holds, or CFG_NONE
+inline uint32_t
+knownTarget (const Analysis& an, const KnownRegisters& r, byte reg)
+{
+    if (!isKnown (r, reg) || r.value[reg] >= an.codeSize || r.value[reg] % 4 != 0) return CFG_NONE;
+    return r.value[reg];
+}
+
+// control reaches address with registers r
+void
+flow (Analysis& an, uint32_t address, const KnownRegisters& r)
+{
+    if (address >= an.codeSize || address % 4 != 0) return;
+    uint32_t word = address / 4;
+    bool changed = false;
+    if (!an.reached[word])
+    {
+        an.in[word] = r;
+        an.reached[word] = true;
+        changed = true;
+    }
+    else
+    {
+        KnownRegisters& in = an.in[word];
+        for (int reg = 0; reg < 16; ++reg)
+        {
+            uint32_t agreed = in.knownBits[reg] & r.knownBits[reg] & ~(in.value[reg] ^ r.value[reg]);
+            if (agreed != in.knownBits[reg]) changed = true;
+            in.knownBits[reg] = agreed;
+            in.value[reg] &= agreed;
+        }
+    }
+    if (changed && !an.queued[word])
+    {
+        an.queued[word] = true;
+        an.work[an.workSize++] = word;
+    }
+}
+
+// runs the dataflow to a fixed point from address 0, with the registers
+// as reset leaves them
+void
+propagate (Analysis& an)
+{
+    std::memset (an.reached, 0, an.numWords);
+    std::memset (an.queued, 0, an.numWords);
+    an.workSize = 0;
+
+    KnownRegisters start;
+    for (int reg = 0; reg < 16; ++reg) setKnown (start, reg, 0);
+    setKnown (start, bp, an.memorySize - (an.memorySize % 4));
+    setKnown (start, sp, an.memorySize - (an.memorySize % 4));
+    flow (an, 0, start);
+
+    while (an.workSize > 0)
+    {
+        uint32_t word = an.work[--an.workSize];
+        an.queued[word] = false;
+        uint32_t address = word * 4;
+        KnownRegisters r = an.in[word];
+        byte opcode = opcodeAt (an.image, address);
+
+        if (isBranch (opcode))
+        {
+            uint32_t target = knownTarget (an, r, src2At (an.image, address));
+            if (target != CFG_NONE) flow (an, target, r);
+            flow (an, address + 4, r);
+        }
+        else if (opcode == OPCODE_JMP)
+        {
+            uint32_t target = knownTarget (an, r, destAt (an.image, address));
+            if (target != CFG_NONE) flow (an, target, r);
+        }
+        else if (opcode == OPCODE_CALL)
+        {
+            uint32_t target = knownTarget (an, r, destAt (an.image, address));
+            KnownRegisters after = r;
+            if (target != CFG_NONE)
+            {
+                // the callee starts with the return address pushed
+                KnownRegisters callee = r;
+                if (isKnown (callee, sp)) callee.value[sp] -= 4;
+                else forget (callee, sp);
+                flow (an, target, callee);
+                for (byte reg = 0; reg < 16; ++reg)
+                    if (an.assumedClobbers[target / 4] & (1 << reg)) forget (after, reg);
+            }
+            else
+            {
+                for (byte reg = 0; reg < 16; ++reg) forget (after, reg);
+            }
+            flow (an, address + 4, after);
+        }
+        else if (!endsBlock (opcode))
+        {
+            transfer (an.image, address, r);
+            flow (an, address + 4, r);
+        }
+    }
+}
+
+//========================================================================
+// Blocks and functions
+
+// the block starting at address, or CFG_NONE
+inline uint32_t
+blockStartingAt (const ControlFlowGraph* cfg, uint32_t address)
+{
+    if (address >= cfg->codeSize) return CFG_NONE;
+    return cfg->blockAt[address / 4];
+}
+
+// splits the reached instructions into blocks and finds their edges
+void
+buildBlocks (Analysis& an, ControlFlowGraph* cfg)
+{
+    const byte* image = an.image;
+    uint32_t numWords = an.numWords;
+
+    // targets and the sites that have none
+    cfg->numUnresolved = 0;
+    for (uint32_t word = 0; word < numWords; ++word)
+    {
+        cfg->targets[word] = CFG_NONE;
+        if (!an.reached[word]) continue;
+        uint32_t address = word * 4;
+        byte opcode = opcodeAt (image, address);
+        if (!isBranch (opcode) && opcode != OPCODE_JMP && opcode != OPCODE_CALL) continue;
+        byte reg = targetRegister (image, address);
+        cfg->targets[word] = knownTarget (an, an.in[word], reg);
+        if (cfg->targets[word] == CFG_NONE)
+        {
+            CfgSite& site = cfg->unresolved[cfg->numUnresolved++];
+            site.address = address;
+            site.target = reg;
+            site.knownBits = an.in[word].knownBits[reg];
+            site.value = an.in[word].value[reg];
+        }
+    }
+
+    // a block starts at address 0, at every target, and after every
+    // instruction control does not fall past
+    bool* leader = (bool*) calloc (numWords + 1, sizeof(bool));
+    leader[0] = true;
+    for (uint32_t word = 0; word < numWords; ++word)
+    {
+        if (!an.reached[word]) continue;
+        if (word == 0 || !an.reached[word - 1] || endsBlock (opcodeAt (image, (word - 1) * 4)))
+            leader[word] = true;
+        if (cfg->targets[word] != CFG_NONE) leader[cfg->targets[word] / 4] = true;
+    }
+
+    cfg->numBlocks = 0;
+    for (uint32_t word = 0; word < numWords; ++word)
+    {
+        cfg->blockAt[word] = CFG_NONE;
+        if (!an.reached[word]) continue;
+        if (leader[word])
+        {
+            CfgBlock& block = cfg->blocks[cfg->numBlocks];
+            block.start = word * 4;
+            block.function = CFG_NONE;
+            block.numSuccessors = 0;
+            block.unresolved = false;
+            cfg->blockAt[word] = cfg->numBlocks++;
+        }
+        cfg->blocks[cfg->numBlocks - 1].end = word * 4 + 4;
+    }
+    free (leader);
+
+    for (uint32_t b = 0; b < cfg->numBlocks; ++b)
+    {
+        CfgBlock& block = cfg->blocks[b];
+        uint32_t last = block.end - 4;
+        byte opcode = opcodeAt (image, last);
+        uint32_t target = cfg->targets[last / 4];
+        uint32_t next = blockStartingAt (cfg, block.end);
+        uint32_t candidates[2] = { CFG_NONE, CFG_NONE };
+        if (isBranch (opcode))
+        {
+            candidates[0] = next;
+            if (target != CFG_NONE) candidates[1] = blockStartingAt (cfg, target);
+            else block.unresolved = true;
+        }
+        else if (opcode == OPCODE_JMP)
+        {
+            if (target != CFG_NONE) candidates[0] = blockStartingAt (cfg, target);
+            else block.unresolved = true;
+        }
+        else if (opcode == OPCODE_CALL)
+        {
+            candidates[0] = next;
+            if (target == CFG_NONE) block.unresolved = true;
+        }
+        else if (!endsBlock (opcode))
+        {
+            candidates[0] = next;
+        }
+        for (int i = 0; i < 2; ++i)
+        {
+            if (candidates[i] == CFG_NONE) continue;
+            if (block.numSuccessors == 1 && block.successors[0] == candidates[i]) continue;
+            block.successors[block.numSuccessors++] = candidates[i];
+        }
+    }
+}
+
+// the registers a function may write, from every block reachable from
+// its entry without following calls (marks is scratch, one per block)
+uint16_t
+functionWrites (const Analysis& an, const ControlFlowGraph* cfg, uint32_t f, const uint16_t* clobbers,
+    uint32_t* marks, uint32_t* stack)
+{
+    uint16_t written = 0;
+    uint32_t top = 0;
+    uint32_t entry = cfg->blockAt[cfg->functions[f].entry / 4];
+    marks[entry] = f;
+    stack[top++] = entry;
+    while (top > 0)
+    {
+        const CfgBlock& block = cfg->blocks[stack[--top]];
+        for (uint32_t address = block.start; address < block.end; address += 4)
+        {
+            written |= writes (an.image, address);
+            if (opcodeAt (an.image, address) != OPCODE_CALL) continue;
+            uint32_t target = cfg->targets[address / 4];
+            if (target == CFG_NONE) written = 0xffff;
+            else written |= clobbers[target / 4];
+        }
+        for (int i = 0; i < block.numSuccessors; ++i)
+        {
+            if (marks[block.successors[i]] == f) continue;
+            marks[block.successors[i]] = f;
+            stack[top++] = block.successors[i];
+        }
+    }
+    return written;
+}
+
+// finds the functions (address 0 and every CALL target), which blocks
+// belong to them, and what each may write
+void
+buildFunctions (Analysis& an, ControlFlowGraph* cfg)
+{
+    cfg->numFunctions = 1;
+    cfg->functions[0].entry = 0;
+    // CALL targets in address order (each once)
+    for (uint32_t word = 0; word < an.numWords; ++word)
+    {
+        if (!an.reached[word] || opcodeAt (an.image, word * 4) != OPCODE_CALL) continue;
+        uint32_t target = cfg->targets[word];
+        if (target == CFG_NONE || target == 0) continue;
+        bool seen = false;
+        for (uint32_t f = 1; f < cfg->numFunctions; ++f)
+            if (cfg->functions[f].entry == target) seen = true;
+        if (!seen) cfg->functions[cfg->numFunctions++].entry = target;
+    }
+
+    uint32_t* marks = (uint32_t*) malloc ((cfg->numBlocks + 1) * sizeof(uint32_t));
+    uint32_t* stack = (uint32_t*) malloc ((cfg->numBlocks + 1) * sizeof(uint32_t));
+
+    // each block belongs to the first function that reaches it
+    for (uint32_t b = 0; b < cfg->numBlocks; ++b) marks[b] = CFG_NONE;
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+    {
+        CfgFunction& function = cfg->functions[f];
+        function.numBlocks = 0;
+        uint32_t top = 0;
+        uint32_t entry = cfg->blockAt[function.entry / 4];
+        if (cfg->blocks[entry].function != CFG_NONE) continue;
+        cfg->blocks[entry].function = f;
+        stack[top++] = entry;
+        while (top > 0)
+        {
+            CfgBlock& block = cfg->blocks[stack[--top]];
+            ++function.numBlocks;
+            for (int i = 0; i < block.numSuccessors; ++i)
+            {
+                CfgBlock& successor = cfg->blocks[block.successors[i]];
+                if (successor.function != CFG_NONE) continue;
+                successor.function = f;
+                stack[top++] = block.successors[i];
+            }
+        }
+    }
+
+    // what each function may write, through the functions it calls too
+    uint16_t* clobbers = (uint16_t*) calloc (an.numWords + 1, sizeof(uint16_t));
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t b = 0; b < cfg->numBlocks; ++b) marks[b] = CFG_NONE;
+        for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        {
+            uint32_t entry = cfg->functions[f].entry / 4;
+            uint16_t written = functionWrites (an, cfg, f, clobbers, marks, stack) | clobbers[entry];
+            if (written != clobbers[entry]) changed = true;
+            clobbers[entry] = written;
+        }
+    }
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        cfg->functions[f].clobbers = clobbers[cfg->functions[f].entry / 4];
+
+    free (clobbers);
+    free (marks);
+    free (stack);
+}
+
+//========================================================================
+
+ControlFlowGraph*
+buildControlFlowGraph (const byte* image, uint32_t codeSize, size_t memorySize)
+{
+    Analysis an;
+    an.image = image;
+    an.codeSize = codeSize - (codeSize % 4);
+    an.numWords = an.codeSize / 4;
+    an.memorySize = memorySize;
+    an.in = (KnownRegisters*) malloc ((an.numWords + 1) * sizeof(KnownRegisters));
+    an.reached = (bool*) calloc (an.numWords + 1, sizeof(bool));
+    an.queued = (bool*) calloc (an.numWords + 1, sizeof(bool));
+    an.work = (uint32_t*) malloc ((an.numWords + 1) * sizeof(uint32_t));
+    an.assumedClobbers = (uint16_t*) calloc (an.numWords + 1, sizeof(uint16_t));
+
+    ControlFlowGraph* cfg = (ControlFlowGraph*) calloc (1, sizeof(ControlFlowGraph));
+    cfg->codeSize = an.codeSize;
+    cfg->blocks = (CfgBlock*) malloc ((an.numWords + 1) * sizeof(CfgBlock));
+    cfg->functions = (CfgFunction*) malloc ((an.numWords + 1) * sizeof(CfgFunction));
+    cfg->unresolved = (CfgSite*) malloc ((an.numWords + 1) * sizeof(CfgSite));
+    cfg->targets = (uint32_t*) malloc ((an.numWords + 1) * sizeof(uint32_t));
+    cfg->blockAt = (uint32_t*) malloc ((an.numWords + 1) * sizeof(uint32_t));
+
+    // start by assuming calls write nothing, and go again with what the
+    // callees were found to write until the assumption holds (it only
+    // grows, so this ends)
+    while (true)
+    {
+        propagate (an);
+        if (an.numWords == 0) break;
+        buildBlocks (an, cfg);
+        buildFunctions (an, cfg);
+        bool grew = false;
+        for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+        {
+            uint16_t& assumed = an.assumedClobbers[cfg->functions[f].entry / 4];
+            if ((cfg->functions[f].clobbers & ~assumed) != 0) grew = true;
+            assumed |= cfg->functions[f].clobbers;
+        }
+        if (!grew) break;
+    }
+
+    free (an.in);
+    free (an.reached);
+    free (an.queued);
+    free (an.work);
+    free (an.assumedClobbers);
+    return cfg;
+}
+
+void
+freeControlFlowGraph (ControlFlowGraph* cfg)
+{
+    if (cfg == nullptr) return;
+    free (cfg->blocks);
+    free (cfg->functions);
+    free (cfg->unresolved);
+    free (cfg->targets);
+    free (cfg->blockAt);
+    free (cfg);
+}
+
+void
+printControlFlowGraph (const ControlFlowGraph* cfg)
+{
+    printf ("%u functions, %u blocks, %u unresolved\n", cfg->numFunctions, cfg->numBlocks, cfg->numUnresolved);
+    for (uint32_t f = 0; f < cfg->numFunctions; ++f)
+    {
+        const CfgFunction& function = cfg->functions[f];
+        printf ("function 0x%x - %u blocks, writes", function.entry, function.numBlocks);
+        for (int reg = 0; reg < 16; ++reg)
+            if (function.clobbers & (1 << reg)) printf (" r%d", reg);
+        printf ("\n");
+        for (uint32_t b = 0; b < cfg->numBlocks; ++b)
+        {
+            const CfgBlock& block = cfg->blocks[b];
+            if (block.function != f) continue;
+            printf ("    0x%x-0x%x ->", block.start, block.end - 4);
+            for (int i = 0; i < block.numSuccessors; ++i)
+                printf (" 0x%x", cfg->blocks[block.successors[i]].start);
+            if (block.unresolved) printf (" ?");
+            printf ("\n");
+        }
+    }
+    for (uint32_t i = 0; i < cfg->numUnresolved; ++i)
+    {
+        const CfgSite& site = cfg->unresolved[i];
+        printf ("unresolved 0x%x - target in r%d", site.address, site.target);
+        if (site.knownBits == 0xffffffff)
+            printf (" is 0x%x, not an instruction of the program", site.value);
+        else if (site.knownBits != 0)
+            printf (" has known bits 0x%08x = 0x%08x", site.knownBits, site.value);
+        printf ("\n");
+    }
+}
+
+//========================================================================
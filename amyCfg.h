@@ -0,0 +1,84 @@
+// AmyMachine control flow
+// recovers the basic blocks and functions of a program image before it
+// runs. every branch, JMP and CALL goes through a register, so targets
+// are found by following the constants LUI/LLI/ADDI (and the rest of
+// the arithmetic) build in registers
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_CFG_H
+#define AMY_CFG_H
+
+#include "amyMachine.h"
+
+//========================================================================
+
+// no block/target
+const uint32_t CFG_NONE = 0xffffffff;
+
+// a straight-line run of instructions entered only at its start
+struct CfgBlock
+{
+    uint32_t start;
+    // address after its last instruction
+    uint32_t end;
+    // function it belongs to (index into functions) - a block reached
+    // from several functions belongs to the first one found
+    uint32_t function;
+    // blocks control goes to next (indices into blocks), fall-through
+    // first. a CALL's successor is the block after it - the callee is
+    // a function of its own
+    uint32_t successors[2];
+    byte numSuccessors;
+    // ends in a branch/jump/call whose target is not known
+    bool unresolved;
+};
+
+// code reached from address 0 or from a CALL
+struct CfgFunction
+{
+    uint32_t entry;
+    uint32_t numBlocks;
+    // registers it (or anything it calls) may write - bit r for register r
+    uint16_t clobbers;
+};
+
+// a branch, jump or call whose target is not a known instruction of the
+// program
+struct CfgSite
+{
+    uint32_t address;
+    // register holding the target, and what is known about it
+    byte target;
+    uint32_t knownBits;
+    uint32_t value;
+};
+
+struct ControlFlowGraph
+{
+    uint32_t codeSize;
+    // in address order
+    CfgBlock* blocks;
+    uint32_t numBlocks;
+    // the program's entry (address 0) first
+    CfgFunction* functions;
+    uint32_t numFunctions;
+    CfgSite* unresolved;
+    uint32_t numUnresolved;
+    // for each word of the program - the address its branch/jump/call
+    // goes to, or CFG_NONE if it is not one or its target is not known
+    uint32_t* targets;
+    // for each word of the program - the block starting there, or CFG_NONE
+    uint32_t* blockAt;
+};
+
+// analyzes the program image (as loaded, before it runs) and returns its
+// control flow graph. memorySize gives the starting sp and bp
+ControlFlowGraph* buildControlFlowGraph (const byte* image, uint32_t codeSize, size_t memorySize);
+void freeControlFlowGraph (ControlFlowGraph* cfg);
+// prints the functions, blocks and unresolved sites
+void printControlFlowGraph (const ControlFlowGraph* cfg);
+
+//========================================================================
+
+#endif
@@ -0,0 +1,1543 @@
+// AmyMachine JIT
+// translates basic blocks of the 32-bit machine language into native
+// x86-64 code - used by ENGINE_JIT and ENGINE_TIERED
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>   //memcpy
+
+#include "amyJitCode.h"
+#include "amyOpt.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+//========================================================================
+// Translator
+
+// the loads/stores of the block being translated, each waiting for the
+// code it leaves by if it faults
+struct BlockFaults
+{
+    byte* marker[MAX_BLOCK_LENGTH];
+    uint32_t pc[MAX_BLOCK_LENGTH];
+    uint32_t refund[MAX_BLOCK_LENGTH];
+    unsigned int count;
+};
+
+// a fault marker for the access of the instruction at address
+inline void
+markAccess (Emitter& e, BlockFaults& faults, uint32_t address, uint32_t refund)
+{
+    faults.marker[faults.count] = emitFaultMarker (e);
+    faults.pc[faults.count] = address;
+    faults.refund[faults.count++] = refund;
+}
+
+// translates one instruction - refund is how many instructions of
+// the block come after it (given back if it has to leave early)
+void
+translateInstruction (Emitter& e, JitState* jit, BlockFaults& faults, byte* memory, uint32_t address, uint32_t refund)
+{
+    byte opcode = memory[address];
+    byte dest   = memory[address+1] >> 4;
+    byte src1   = memory[address+1] & 0xf;
+    byte src2   = memory[address+2] >> 4;
+    // immediates/offsets are stored in little endian
+    int32_t imm = *(int16_t*)&memory[address+2];
+
+    switch (opcode)
+    {
+        // LUI/LLI write the first/last 2 bytes of dest
+        case OPCODE_LUI:
+            emit8 (e, 0x66);
+            emitFrame (e, 0xc7, 0, dest * 4);
+            emit16 (e, imm);
+            break;
+        case OPCODE_LLI:
+            emit8 (e, 0x66);
+            emitFrame (e, 0xc7, 0, dest * 4 + 2);
+            emit16 (e, imm);
+            break;
+
+        // loads - dest <- [src1 + imm]
+        case OPCODE_LB:
+        case OPCODE_LH:
+        case OPCODE_LW:
+            emitLoadGuest (e, EAX, src1);
+            if (imm != 0) emitImmediateOp (e, 0, imm);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            if (opcode == OPCODE_LB)      emitGuestMemory (e, "\x41\x0f\xb6", 3, EAX); // movzx
+            else if (opcode == OPCODE_LH) emitGuestMemory (e, "\x41\x0f\xbf", 3, EAX); // movsx
+            else                          emitGuestMemory (e, "\x41\x8b", 2, EAX);
+            emitStoreGuest (e, EAX, dest);
+            break;
+
+        // stores - [dest + imm] <- src1
+        // a store into the program leaves so it can be translated again
+        case OPCODE_SB:
+        case OPCODE_SH:
+        case OPCODE_SW:
+        {
+            emitLoadGuest (e, EAX, dest);
+            if (imm != 0) emitImmediateOp (e, 0, imm);
+            emitLoadGuest (e, ECX, src1);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            if (opcode == OPCODE_SB)      emitGuestMemory (e, "\x41\x88", 2, ECX);
+            else if (opcode == OPCODE_SH) emitGuestMemory (e, "\x66\x41\x89", 3, ECX);
+            else                          emitGuestMemory (e, "\x41\x89", 2, ECX);
+            // cmp eax, r15d
+            emitBytes (e, "\x44\x39\xf8", 3);
+            byte* outside = emitShortJumpIf (e, CC_AE);
+            // add r13, refund
+            emitBytes (e, "\x49\x81\xc5", 3);
+            emit32 (e, refund);
+            emitExit (e, jit, address + 4, EXIT_STORE);
+            patchShortJump (e, outside);
+            break;
+        }
+
+        // arithmetic - dest <- src1 <op> src2
+        case OPCODE_ADD:
+        case OPCODE_SUB:
+        case OPCODE_OR:
+        case OPCODE_AND:
+        case OPCODE_XOR:
+        {
+            byte op = opcode == OPCODE_ADD ? 0x03 : opcode == OPCODE_SUB ? 0x2b
+                : opcode == OPCODE_OR ? 0x0b : opcode == OPCODE_AND ? 0x23 : 0x33;
+            emitLoadGuest (e, EAX, src1);
+            emitFrame (e, op, EAX, src2 * 4);
+            emitStoreGuest (e, EAX, dest);
+            break;
+        }
+        case OPCODE_MUL:
+            emitLoadGuest (e, EAX, src1);
+            emit8 (e, 0x0f);
+            emitFrame (e, 0xaf, EAX, src2 * 4);
+            emitStoreGuest (e, EAX, dest);
+            break;
+        case OPCODE_DIV:
+        case OPCODE_MOD:
+            emitLoadGuest (e, EAX, src1);
+            // cdq ; idiv dword [src2]
+            emit8 (e, 0x99);
+            emitFrame (e, 0xf7, 7, src2 * 4);
+            emitStoreGuest (e, opcode == OPCODE_DIV ? EAX : EDX, dest);
+            break;
+        case OPCODE_SLL:
+        case OPCODE_SRL:
+        case OPCODE_SRA:
+            emitLoadGuest (e, EAX, src1);
+            emitLoadGuest (e, ECX, src2);
+            emitShiftByCl (e, opcode == OPCODE_SLL ? 4 : opcode == OPCODE_SRL ? 5 : 7);
+            emitStoreGuest (e, EAX, dest);
+            break;
+
+        // immediate arithmetic - dest <- src1 <op> imm
+        case OPCODE_ADDI:
+        case OPCODE_SUBI:
+        case OPCODE_ORI:
+        case OPCODE_ANDI:
+        case OPCODE_XORI:
+        {
+            byte extension = opcode == OPCODE_ADDI ? 0 : opcode == OPCODE_SUBI ? 5
+                : opcode == OPCODE_ORI ? 1 : opcode == OPCODE_ANDI ? 4 : 6;
+            emitLoadGuest (e, EAX, src1);
+            emitImmediateOp (e, extension, imm);
+            emitStoreGuest (e, EAX, dest);
+            break;
+        }
+        case OPCODE_MULI:
+            emitLoadGuest (e, EAX, src1);
+            // imul eax, eax, imm32
+            emitBytes (e, "\x69\xc0", 2);
+            emit32 (e, imm);
+            emitStoreGuest (e, EAX, dest);
+            break;
+        case OPCODE_DIVI:
+        case OPCODE_MODI:
+            emitLoadGuest (e, EAX, src1);
+            emitMoveImmediate (e, ECX, imm);
+            // cdq ; idiv ecx
+            emitBytes (e, "\x99\xf7\xf9", 3);
+            emitStoreGuest (e, opcode == OPCODE_DIVI ? EAX : EDX, dest);
+            break;
+        case OPCODE_SLLI:
+        case OPCODE_SRLI:
+        case OPCODE_SRAI:
+            // shift counts are taken mod 32 like the interpreters'
+            emitLoadGuest (e, EAX, src1);
+            emitShiftByImmediate (e, opcode == OPCODE_SLLI ? 4 : opcode == OPCODE_SRLI ? 5 : 7, imm & 31);
+            emitStoreGuest (e, EAX, dest);
+            break;
+
+        // branching - ssssssss aaaa0000
+        case OPCODE_BEQ:
+        case OPCODE_BNE:
+        case OPCODE_BLT:
+        case OPCODE_BLE:
+        case OPCODE_BGT:
+        case OPCODE_BGE:
+        {
+            static const byte conditions[] = { CC_E, CC_NE, CC_L, CC_LE, CC_G, CC_GE };
+            emitLoadGuest (e, EAX, dest);
+            emitFrame (e, 0x3b, EAX, src1 * 4);
+            byte* taken = emitShortJumpIf (e, conditions[opcode - OPCODE_BEQ]);
+            emitMoveImmediate (e, EAX, address + 4);
+            emitJump (e, jit->dispatch);
+            patchShortJump (e, taken);
+            emitLoadGuest (e, EAX, src2);
+            emitJump (e, jit->dispatch);
+            break;
+        }
+        case OPCODE_JMP:
+            emitLoadGuest (e, EAX, dest);
+            emitJump (e, jit->dispatch);
+            break;
+
+        // function instructions
+        // CALL pushes its own address - sp is written after the push, so
+        // a push that faults leaves it alone. a push into the program
+        // leaves like a store does (CALL ends the block, so there is
+        // nothing to refund)
+        case OPCODE_CALL:
+            emitLoadGuest (e, EAX, sp);
+            // sub eax, 4
+            emitBytes (e, "\x83\xe8\x04", 3);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            // mov dword [r12 + rax], address
+            emitGuestMemory (e, "\x41\xc7", 2, 0);
+            emit32 (e, address);
+            // cmp eax, r15d - the moves after it leave the flags alone
+            emitBytes (e, "\x44\x39\xf8", 3);
+            emitStoreGuest (e, EAX, sp);
+            emitLoadGuest (e, EAX, dest);
+            emitJumpIf (e, CC_AE, jit->dispatch);
+            emitMoveImmediate (e, EDX, EXIT_STORE);
+            emitJump (e, jit->exit);
+            break;
+        // RET continues past the CALL
+        case OPCODE_RET:
+            emitLoadGuest (e, EAX, sp);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            emitGuestMemory (e, "\x41\x8b", 2, ECX);
+            // add dword [sp], 4
+            emitFrame (e, 0x83, 0, sp * 4);
+            emit8 (e, 4);
+            // lea eax, [rcx + 4]
+            emitBytes (e, "\x8d\x41\x04", 3);
+            emitJump (e, jit->dispatch);
+            break;
+        // the stack can grow down into the program too - a push into it
+        // leaves like a store does
+        case OPCODE_PUSH:
+        {
+            emitLoadGuest (e, EAX, sp);
+            emitBytes (e, "\x83\xe8\x04", 3);
+            // the value is read after sp moves, like the interpreters
+            // (PUSH sp) - mov ecx, eax
+            if (dest == sp) emitBytes (e, "\x89\xc1", 2);
+            else            emitLoadGuest (e, ECX, dest);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            emitGuestMemory (e, "\x41\x89", 2, ECX);
+            emitStoreGuest (e, EAX, sp);
+            // cmp eax, r15d
+            emitBytes (e, "\x44\x39\xf8", 3);
+            byte* outside = emitShortJumpIf (e, CC_AE);
+            // add r13, refund
+            emitBytes (e, "\x49\x81\xc5", 3);
+            emit32 (e, refund);
+            emitExit (e, jit, address + 4, EXIT_STORE);
+            patchShortJump (e, outside);
+            break;
+        }
+        case OPCODE_POP:
+            emitLoadGuest (e, EAX, sp);
+            emitWidenAddress (e);
+            markAccess (e, faults, address, refund);
+            emitGuestMemory (e, "\x41\x8b", 2, ECX);
+            emitStoreGuest (e, ECX, dest);
+            // sp moves after dest is written, like the interpreters (POP sp)
+            emitFrame (e, 0x83, 0, sp * 4);
+            emit8 (e, 4);
+            break;
+
+        case OPCODE_NOP:
+            break;
+    }
+}
+
+// throws away all translated code
+void
+flushJit (JitState* jit)
+{
+    jit->used = jit->blocksStart;
+    std::memset (jit->blocks, 0, (jit->codeSize / 4) * sizeof(void*));
+    std::memset (jit->traceHeads, 0, jit->codeSize / 4);
+    resetOptimizer (jit);
+}
+
+// translates the block starting at pc and returns its code, or null if
+// the instruction at pc is left to the interpreter. a block runs up
+// to and including its first branch/jump/call/return, and stops before
+// anything left to the interpreter
+void*
+translateBlock (JitState* jit, MachineState& state, uint32_t pc)
+{
+    byte* memory = state.memory;
+    unsigned int length = 0;
+    bool endsWithBranch = false;
+    for (uint32_t address = pc; address < jit->codeSize && length < MAX_BLOCK_LENGTH; address += 4)
+    {
+        byte opcode = memory[address];
+        if (!isTranslatable (opcode)) break;
+        ++length;
+        if (hasFlag (opcode, ISA_CONTROL))
+        {
+            endsWithBranch = true;
+            break;
+        }
+    }
+    if (length == 0) return nullptr;
+    if (!reserveCode (jit, (length + 2) * MAX_INSTRUCTION_BYTES)) return nullptr;
+
+    Emitter e = { jit->buffer + jit->used };
+    BlockFaults faults;
+    faults.count = 0;
+    byte* block = e.at;
+
+    // charge the whole block, or hand back if the budget cannot cover it
+    // cmp r13, length
+    emitBytes (e, "\x49\x81\xfd", 3);
+    emit32 (e, length);
+    byte* enough = emitShortJumpIf (e, CC_AE);
+    emitExit (e, jit, pc, EXIT_BUDGET);
+    patchShortJump (e, enough);
+    // sub r13, length
+    emitBytes (e, "\x49\x81\xed", 3);
+    emit32 (e, length);
+
+    for (unsigned int i = 0; i < length; ++i)
+        translateInstruction (e, jit, faults, memory, pc + i*4, length - i - 1);
+    if (!endsWithBranch)
+    {
+        emitMoveImmediate (e, EAX, pc + length*4);
+        emitJump (e, jit->dispatch);
+    }
+    // where accesses that fault leave - the instruction did not run
+    for (unsigned int i = 0; i < faults.count; ++i)
+    {
+        uint32_t displacement = (uint32_t)(e.at - (faults.marker[i] + 4));
+        std::memcpy (faults.marker[i], &displacement, 4);
+        // add r13, refund + 1
+        emitBytes (e, "\x49\x81\xc5", 3);
+        emit32 (e, faults.refund[i] + 1);
+        emitExit (e, jit, faults.pc[i], EXIT_INTERPRET);
+    }
+
+    jit->used = e.at - jit->buffer;
+    installBlock (jit, pc, block);
+    return block;
+}
+
+//========================================================================
+// Traces
+// when a hot block heads a loop, the tiered engine records the path the
+// program takes from it until it comes back (following branches and
+// register-indirect jumps to wherever they went) and compiles the whole
+// path as one native loop:
+//  - every branch and jump is a guard. leaving the recorded path writes
+//    the registers back and continues at the real next instruction
+//  - constants are followed through the path and only written to their
+//    registers at exits and where they stop being constant, so LUI/LLI
+//    pairs that build the same compare value or branch target on every
+//    iteration cost nothing inside the loop
+//  - the first iteration is compiled on its own (peeled) so the loop
+//    starts with those constants already known
+//  - the most used guest registers live in host registers
+
+// longest path recorded (in instructions)
+const unsigned int MAX_TRACE_LENGTH = 256;
+// most exits of a trace - two per instruction (guards, or a store/push's
+// fault and program check) in both copies (the first iteration and
+// the loop) and the budget check of the loop
+const unsigned int MAX_TRACE_EXITS = 4 * MAX_TRACE_LENGTH + 1;
+// room a trace may need
+const size_t MAX_TRACE_BYTES = 1 << 20;
+// host registers guest registers can live in - esi, edi, r8d-r11d
+static const byte traceHosts[] = { 6, 7, 8, 9, 10, 11 };
+const unsigned int NUM_TRACE_HOSTS = sizeof(traceHosts);
+// a guest register that lives in the frame
+const byte IN_FRAME = 0xff;
+// an exit whose next pc is a constant
+const byte NO_TARGET = 0xff;
+// the condition of an exit that is always taken
+const byte ALWAYS = 0xff;
+
+// one recorded instruction
+struct TraceStep
+{
+    uint32_t pc;
+    // branches - whether it was taken
+    bool taken;
+    // the pc after it
+    uint32_t next;
+};
+
+// what the compiler knows about the guest registers at a point of a trace
+struct TraceRegisters
+{
+    // bits of each register known at compile time, and their values
+    uint32_t knownBits[16];
+    uint32_t value[16];
+    // some known bits may not have been written to where the register
+    // lives yet (every other bit there is always current)
+    bool stale[16];
+};
+
+// a guard leaving the recorded path
+struct TraceExit
+{
+    // displacement of the jump to the exit's code
+    byte* jump;
+    TraceRegisters registers;
+    // the next pc - pc, or the value of register target
+    uint32_t pc;
+    byte target;
+    // instructions of the current iteration that did not run
+    uint32_t refund;
+    // EXIT_LOOKUP continues through the dispatcher
+    JitExit reason;
+};
+
+struct TraceCompiler
+{
+    Emitter e;
+    byte* memory;
+    uint32_t codeSize;
+    TraceStep steps[MAX_TRACE_LENGTH];
+    unsigned int length;
+    // host register each guest register lives in (or IN_FRAME)
+    byte hostOf[16];
+    TraceRegisters s;
+    TraceExit exits[MAX_TRACE_EXITS];
+    unsigned int numExits;
+};
+
+// true for instructions a trace can contain - CALL/RET end the path
+inline bool
+isTraceable (byte opcode)
+{
+    return isTranslatable (opcode) && opcode != OPCODE_CALL && opcode != OPCODE_RET;
+}
+
+inline bool
+isKnown (TraceCompiler& c, byte r)
+{
+    return c.s.knownBits[r] == 0xffffffff;
+}
+
+// <opcode> reg, home where home is the host register guest register r
+// lives in, or (host == IN_FRAME) its slot in the frame
+void
+emitOperand (TraceCompiler& c, const char* opcode, int length, byte reg, byte host, byte r)
+{
+    byte rex = 0x40;
+    if (reg & 8) rex |= 0x04;
+    if (host != IN_FRAME && (host & 8)) rex |= 0x01;
+    if (rex != 0x40) emit8 (c.e, rex);
+    emitBytes (c.e, opcode, length);
+    if (host != IN_FRAME) emit8 (c.e, 0xc0 | ((reg & 7) << 3) | (host & 7));
+    else
+    {
+        emit8 (c.e, 0x43 | ((reg & 7) << 3));
+        emit8 (c.e, r * 4);
+    }
+}
+
+// <opcode> reg, where guest register r lives
+inline void
+emitHome (TraceCompiler& c, const char* opcode, int length, byte reg, byte r)
+{
+    emitOperand (c, opcode, length, reg, c.hostOf[r], r);
+}
+
+// writes the known bits of r to where it lives
+void
+materialize (TraceCompiler& c, byte r)
+{
+    if (!c.s.stale[r]) return;
+    uint32_t bits = c.s.knownBits[r];
+    if (bits == 0xffffffff)
+    {
+        emitHome (c, "\xc7", 1, 0, r);
+        emit32 (c.e, c.s.value[r]);
+    }
+    else
+    {
+        emitHome (c, "\x81", 1, 4, r);
+        emit32 (c.e, ~bits);
+        emitHome (c, "\x81", 1, 1, r);
+        emit32 (c.e, c.s.value[r] & bits);
+    }
+    c.s.stale[r] = false;
+}
+
+// scratch register host <- guest register r
+void
+readRegister (TraceCompiler& c, byte host, byte r)
+{
+    if (isKnown (c, r)) emitMoveImmediate (c.e, host, c.s.value[r]);
+    else
+    {
+        materialize (c, r);
+        emitHome (c, "\x8b", 1, host, r);
+    }
+}
+
+// guest register r <- scratch register host
+void
+writeRegister (TraceCompiler& c, byte host, byte r)
+{
+    emitHome (c, "\x89", 1, host, r);
+    c.s.knownBits[r] = 0;
+    c.s.stale[r] = false;
+}
+
+// sets the bits of mask in guest register r - only at compile time
+void
+writeBits (TraceCompiler& c, byte r, uint32_t mask, uint32_t bits)
+{
+    if ((c.s.knownBits[r] & mask) == mask && (c.s.value[r] & mask) == bits) return;
+    c.s.knownBits[r] |= mask;
+    c.s.value[r] = (c.s.value[r] & ~mask) | bits;
+    c.s.stale[r] = true;
+}
+
+// an exit through the displacement jump, with the registers as they are
+void
+recordExit (TraceCompiler& c, byte* jump, uint32_t pc, byte target, uint32_t refund, JitExit reason)
+{
+    TraceExit& x = c.exits[c.numExits++];
+    x.jump = jump;
+    x.registers = c.s;
+    x.pc = pc;
+    x.target = target;
+    x.refund = refund;
+    x.reason = reason;
+}
+
+// leaves the trace when condition holds (or always, for condition 0xff)
+void
+addExit (TraceCompiler& c, byte condition, uint32_t pc, byte target, uint32_t refund, JitExit reason)
+{
+    if (condition == ALWAYS) emit8 (c.e, 0xe9);
+    else
+    {
+        emit8 (c.e, 0x0f);
+        emit8 (c.e, 0x80 | condition);
+    }
+    emit32 (c.e, 0);
+    recordExit (c, c.e.at - 4, pc, target, refund, reason);
+}
+
+// leaves the trace for the interpreter at pc if the access after it
+// faults - the instruction has not run
+void
+addFaultExit (TraceCompiler& c, uint32_t pc, uint32_t refund)
+{
+    recordExit (c, emitFaultMarker (c.e), pc, NO_TARGET, refund + 1, EXIT_INTERPRET);
+}
+
+// a taken branch/jump through register t must go to next
+void
+guardTarget (TraceCompiler& c, byte t, uint32_t next, uint32_t refund)
+{
+    if (isKnown (c, t))
+    {
+        if (c.s.value[t] != next) addExit (c, ALWAYS, 0, t, refund, EXIT_LOOKUP);
+        return;
+    }
+    materialize (c, t);
+    // cmp home, next
+    emitHome (c, "\x81", 1, 7, t);
+    emit32 (c.e, next);
+    addExit (c, CC_NE, 0, t, refund, EXIT_LOOKUP);
+    // past the guard t is next (and already in place)
+    c.s.knownBits[t] = 0xffffffff;
+    c.s.value[t] = next;
+}
+
+// dest <- src1 <op> src2 for ADD..XOR, where src2 is imm if constant
+void
+compileArithmetic (TraceCompiler& c, byte opcode, byte dest, byte src1, byte src2, bool constant, int32_t imm)
+{
+    if (!constant && isKnown (c, src2))
+    {
+        constant = true;
+        imm = c.s.value[src2];
+    }
+    uint32_t result;
+    if (constant && isKnown (c, src1) && evaluate (opcode, c.s.value[src1], imm, &result))
+    {
+        writeBits (c, dest, 0xffffffff, result);
+        return;
+    }
+
+    readRegister (c, EAX, src1);
+    byte resultRegister = EAX;
+    switch (opcode)
+    {
+        case OPCODE_ADD:
+        case OPCODE_SUB:
+        case OPCODE_OR:
+        case OPCODE_AND:
+        case OPCODE_XOR:
+            if (constant)
+                emitImmediateOp (c.e, opcode == OPCODE_ADD ? 0 : opcode == OPCODE_SUB ? 5
+                    : opcode == OPCODE_OR ? 1 : opcode == OPCODE_AND ? 4 : 6, imm);
+            else
+            {
+                materialize (c, src2);
+                emitHome (c, opcode == OPCODE_ADD ? "\x03" : opcode == OPCODE_SUB ? "\x2b"
+                    : opcode == OPCODE_OR ? "\x0b" : opcode == OPCODE_AND ? "\x23" : "\x33", 1, EAX, src2);
+            }
+            break;
+        case OPCODE_MUL:
+            if (constant)
+            {
+                emitBytes (c.e, "\x69\xc0", 2);
+                emit32 (c.e, imm);
+            }
+            else
+            {
+                materialize (c, src2);
+                emitHome (c, "\x0f\xaf", 2, EAX, src2);
+            }
+            break;
+        case OPCODE_DIV:
+        case OPCODE_MOD:
+            if (constant) emitMoveImmediate (c.e, ECX, imm);
+            else          readRegister (c, ECX, src2);
+            // cdq ; idiv ecx
+            emitBytes (c.e, "\x99\xf7\xf9", 3);
+            if (opcode == OPCODE_MOD) resultRegister = EDX;
+            break;
+        default:
+        {
+            byte extension = opcode == OPCODE_SLL ? 4 : opcode == OPCODE_SRL ? 5 : 7;
+            if (constant) emitShiftByImmediate (c.e, extension, imm & 31);
+            else
+            {
+                readRegister (c, ECX, src2);
+                emitShiftByCl (c.e, extension);
+            }
+            break;
+        }
+    }
+    writeRegister (c, resultRegister, dest);
+}
+
+// eax <- REG(base) + offset as a guest address - returns true (with the
+// address) if it is known at compile time
+bool
+compileAddress (TraceCompiler& c, byte base, int32_t offset, uint32_t* address)
+{
+    bool known = isKnown (c, base);
+    if (known)
+    {
+        *address = c.s.value[base] + offset;
+        emitMoveImmediate (c.e, EAX, *address);
+    }
+    else
+    {
+        readRegister (c, EAX, base);
+        if (offset != 0) emitImmediateOp (c.e, 0, offset);
+    }
+    emitWidenAddress (c.e);
+    return known;
+}
+
+// compiles recorded instruction i
+void
+compileStep (TraceCompiler& c, unsigned int i)
+{
+    TraceStep& step = c.steps[i];
+    byte* memory = c.memory;
+    uint32_t pc = step.pc;
+    byte opcode = memory[pc];
+    byte dest   = memory[pc+1] >> 4;
+    byte src1   = memory[pc+1] & 0xf;
+    byte src2   = memory[pc+2] >> 4;
+    // immediates/offsets are stored in little endian
+    int32_t imm = *(int16_t*)&memory[pc+2];
+    // instructions after this one in the iteration
+    uint32_t refund = c.length - i - 1;
+    uint32_t address;
+
+    switch (opcode)
+    {
+        case OPCODE_LUI: writeBits (c, dest, 0x0000ffff, (uint16_t)imm); break;
+        case OPCODE_LLI: writeBits (c, dest, 0xffff0000, (uint32_t)imm << 16); break;
+
+        case OPCODE_LB:
+        case OPCODE_LH:
+        case OPCODE_LW:
+            compileAddress (c, src1, imm, &address);
+            addFaultExit (c, pc, refund);
+            if (opcode == OPCODE_LB)      emitGuestMemory (c.e, "\x41\x0f\xb6", 3, EAX);
+            else if (opcode == OPCODE_LH) emitGuestMemory (c.e, "\x41\x0f\xbf", 3, EAX);
+            else                          emitGuestMemory (c.e, "\x41\x8b", 2, EAX);
+            writeRegister (c, EAX, dest);
+            break;
+
+        // a store into the program leaves the trace after it
+        case OPCODE_SB:
+        case OPCODE_SH:
+        case OPCODE_SW:
+        {
+            bool known = compileAddress (c, dest, imm, &address);
+            readRegister (c, ECX, src1);
+            addFaultExit (c, pc, refund);
+            if (opcode == OPCODE_SB)      emitGuestMemory (c.e, "\x41\x88", 2, ECX);
+            else if (opcode == OPCODE_SH) emitGuestMemory (c.e, "\x66\x41\x89", 3, ECX);
+            else                          emitGuestMemory (c.e, "\x41\x89", 2, ECX);
+            if (known)
+            {
+                if (address < c.codeSize) addExit (c, ALWAYS, pc + 4, NO_TARGET, refund, EXIT_STORE);
+            }
+            else
+            {
+                // cmp eax, r15d
+                emitBytes (c.e, "\x44\x39\xf8", 3);
+                addExit (c, CC_B, pc + 4, NO_TARGET, refund, EXIT_STORE);
+            }
+            break;
+        }
+
+        case OPCODE_ADD: case OPCODE_SUB: case OPCODE_MUL: case OPCODE_DIV:
+        case OPCODE_MOD: case OPCODE_SLL: case OPCODE_SRL: case OPCODE_SRA:
+        case OPCODE_OR:  case OPCODE_AND: case OPCODE_XOR:
+            compileArithmetic (c, opcode, dest, src1, src2, false, 0);
+            break;
+        // immediate forms are in the same order as the register forms
+        case OPCODE_ADDI: case OPCODE_SUBI: case OPCODE_MULI: case OPCODE_DIVI:
+        case OPCODE_MODI: case OPCODE_SLLI: case OPCODE_SRLI: case OPCODE_SRAI:
+        case OPCODE_ORI:  case OPCODE_ANDI: case OPCODE_XORI:
+            compileArithmetic (c, opcode - OPCODE_ADDI + OPCODE_ADD, dest, src1, 0, true, imm);
+            break;
+
+        // branching - ssssssss aaaa0000
+        case OPCODE_BEQ:
+        case OPCODE_BNE:
+        case OPCODE_BLT:
+        case OPCODE_BLE:
+        case OPCODE_BGT:
+        case OPCODE_BGE:
+        {
+            static const byte conditions[] = { CC_E, CC_NE, CC_L, CC_LE, CC_G, CC_GE };
+            byte condition = conditions[opcode - OPCODE_BEQ];
+            if (isKnown (c, dest) && isKnown (c, src1))
+            {
+                // decided at compile time - the path only goes on if it
+                // went the recorded way
+                if (branchTaken (opcode, c.s.value[dest], c.s.value[src1]) != step.taken)
+                {
+                    if (step.taken) addExit (c, ALWAYS, pc + 4, NO_TARGET, refund, EXIT_LOOKUP);
+                    else            addExit (c, ALWAYS, 0, src2, refund, EXIT_LOOKUP);
+                }
+            }
+            else
+            {
+                readRegister (c, EAX, dest);
+                if (isKnown (c, src1))
+                {
+                    emitImmediateOp (c.e, 7, c.s.value[src1]);
+                }
+                else
+                {
+                    materialize (c, src1);
+                    emitHome (c, "\x3b", 1, EAX, src1);
+                }
+                // x86 conditions come in pairs - c ^ 1 is the opposite
+                if (step.taken) addExit (c, condition ^ 1, pc + 4, NO_TARGET, refund, EXIT_LOOKUP);
+                else            addExit (c, condition, 0, src2, refund, EXIT_LOOKUP);
+            }
+            if (step.taken) guardTarget (c, src2, step.next, refund);
+            break;
+        }
+        case OPCODE_JMP:
+            guardTarget (c, dest, step.next, refund);
+            break;
+
+        // sp is written after the push, so a push that faults leaves it
+        // alone. a push into the program leaves the trace after it, like
+        // a store
+        case OPCODE_PUSH:
+            readRegister (c, EAX, sp);
+            emitBytes (c.e, "\x83\xe8\x04", 3);
+            // the value is read after sp moves, like the interpreters
+            // (PUSH sp) - mov ecx, eax
+            if (dest == sp) emitBytes (c.e, "\x89\xc1", 2);
+            else            readRegister (c, ECX, dest);
+            emitWidenAddress (c.e);
+            addFaultExit (c, pc, refund);
+            emitGuestMemory (c.e, "\x41\x89", 2, ECX);
+            writeRegister (c, EAX, sp);
+            // cmp eax, r15d
+            emitBytes (c.e, "\x44\x39\xf8", 3);
+            addExit (c, CC_B, pc + 4, NO_TARGET, refund, EXIT_STORE);
+            break;
+        case OPCODE_POP:
+            readRegister (c, EAX, sp);
+            emitWidenAddress (c.e);
+            addFaultExit (c, pc, refund);
+            emitGuestMemory (c.e, "\x41\x8b", 2, ECX);
+            writeRegister (c, ECX, dest);
+            // sp moves after dest is written, like the interpreters (POP sp)
+            readRegister (c, EAX, sp);
+            emitBytes (c.e, "\x83\xc0\x04", 3);
+            writeRegister (c, EAX, sp);
+            break;
+
+        case OPCODE_NOP:
+            break;
+    }
+}
+
+// compiles one iteration of the path
+void
+compileIteration (TraceCompiler& c)
+{
+    for (unsigned int i = 0; i < c.length; ++i)
+        compileStep (c, i);
+}
+
+// what is known at the loop head - every known bit is stale there
+void
+enterLoopHead (TraceCompiler& c, const TraceRegisters& head)
+{
+    c.s = head;
+    for (int r = 0; r < 16; ++r) c.s.stale[r] = c.s.knownBits[r] != 0;
+}
+
+// writes back what the loop head does not know any more before going
+// round again
+void
+leaveForLoopHead (TraceCompiler& c, const TraceRegisters& head)
+{
+    for (int r = 0; r < 16; ++r)
+        if (c.s.knownBits[r] & ~head.knownBits[r]) materialize (c, r);
+}
+
+// picks the guest registers that live in host registers - the most used
+// ones that are not constant in the loop
+void
+allocateHosts (TraceCompiler& c, const TraceRegisters& head)
+{
+    unsigned int uses[16] = {};
+    for (unsigned int i = 0; i < c.length; ++i)
+    {
+        byte* instruction = &c.memory[c.steps[i].pc];
+        byte opcode = instruction[0];
+        if (opcode == OPCODE_LUI || opcode == OPCODE_LLI || opcode == OPCODE_JMP) continue;
+        ++uses[instruction[1] >> 4];
+        if (opcode == OPCODE_PUSH || opcode == OPCODE_POP) ++uses[sp];
+        else ++uses[instruction[1] & 0xf];
+        if (instructionInfo (opcode).format == FORMAT_REGISTERS) ++uses[instruction[2] >> 4];
+    }
+    for (int r = 0; r < 16; ++r)
+    {
+        c.hostOf[r] = IN_FRAME;
+        if (head.knownBits[r] == 0xffffffff) uses[r] = 0;
+    }
+    for (unsigned int h = 0; h < NUM_TRACE_HOSTS; ++h)
+    {
+        int best = 0;
+        for (int r = 1; r < 16; ++r)
+            if (uses[r] > uses[best]) best = r;
+        if (uses[best] < 2) break;
+        c.hostOf[best] = traceHosts[h];
+        uses[best] = 0;
+    }
+}
+
+// the scratch space for traces (allocated when first needed)
+TraceCompiler&
+traceCompiler (JitState* jit)
+{
+    if (jit->tracer == nullptr) jit->tracer = (TraceCompiler*) calloc (1, sizeof(TraceCompiler));
+    return *jit->tracer;
+}
+
+// compiles the path recorded in the tracer as a loop and returns its code
+void*
+compileTrace (JitState* jit, MachineState& state)
+{
+    TraceCompiler& c = traceCompiler (jit);
+    if (!reserveCode (jit, MAX_TRACE_BYTES)) return nullptr;
+    c.memory = state.memory;
+    c.codeSize = state.codeSize;
+    uint32_t header = c.steps[0].pc;
+    byte* start = jit->buffer + jit->used;
+
+    // find what the loop head knows - start from the end of the first
+    // iteration and keep what every later iteration agrees on (these
+    // passes only look at c.s - their code is written over)
+    for (int r = 0; r < 16; ++r) c.hostOf[r] = IN_FRAME;
+    std::memset (&c.s, 0, sizeof(c.s));
+    c.e.at = start;
+    c.numExits = 0;
+    compileIteration (c);
+    TraceRegisters head = c.s;
+    while (true)
+    {
+        enterLoopHead (c, head);
+        c.e.at = start;
+        c.numExits = 0;
+        compileIteration (c);
+        bool changed = false;
+        for (int r = 0; r < 16; ++r)
+        {
+            uint32_t agreed = head.knownBits[r] & c.s.knownBits[r] & ~(head.value[r] ^ c.s.value[r]);
+            if (agreed != head.knownBits[r]) changed = true;
+            head.knownBits[r] = agreed;
+            head.value[r] &= agreed;
+        }
+        if (!changed) break;
+    }
+    allocateHosts (c, head);
+
+    c.e.at = start;
+    c.numExits = 0;
+    byte* entry = c.e.at;
+    // charge the first iteration (everything is still in the frame)
+    emitBytes (c.e, "\x49\x81\xfd", 3);
+    emit32 (c.e, c.length);
+    byte* enough = emitShortJumpIf (c.e, CC_AE);
+    emitExit (c.e, jit, header, EXIT_BUDGET);
+    patchShortJump (c.e, enough);
+    emitBytes (c.e, "\x49\x81\xed", 3);
+    emit32 (c.e, c.length);
+    for (int r = 0; r < 16; ++r)
+        if (c.hostOf[r] != IN_FRAME) emitOperand (c, "\x8b", 1, c.hostOf[r], IN_FRAME, r);
+    std::memset (&c.s, 0, sizeof(c.s));
+    compileIteration (c);
+    leaveForLoopHead (c, head);
+
+    // the loop
+    byte* loop = c.e.at;
+    enterLoopHead (c, head);
+    // cmp r13, length ; jb exit ; sub r13, length
+    emitBytes (c.e, "\x49\x81\xfd", 3);
+    emit32 (c.e, c.length);
+    addExit (c, CC_B, header, NO_TARGET, 0, EXIT_BUDGET);
+    emitBytes (c.e, "\x49\x81\xed", 3);
+    emit32 (c.e, c.length);
+    compileIteration (c);
+    leaveForLoopHead (c, head);
+    emitJump (c.e, loop);
+
+    // exits - the next pc goes in eax first, since writing the
+    // registers back leaves eax alone
+    for (unsigned int i = 0; i < c.numExits; ++i)
+    {
+        TraceExit& x = c.exits[i];
+        uint32_t displacement = (uint32_t)(c.e.at - (x.jump + 4));
+        std::memcpy (x.jump, &displacement, 4);
+        c.s = x.registers;
+        if (x.target == NO_TARGET) emitMoveImmediate (c.e, EAX, x.pc);
+        else                       readRegister (c, EAX, x.target);
+        for (int r = 0; r < 16; ++r)
+        {
+            materialize (c, r);
+            if (c.hostOf[r] != IN_FRAME) emitOperand (c, "\x89", 1, c.hostOf[r], IN_FRAME, r);
+        }
+        if (x.refund != 0)
+        {
+            // add r13, refund
+            emitBytes (c.e, "\x49\x81\xc5", 3);
+            emit32 (c.e, x.refund);
+        }
+        if (x.reason == EXIT_LOOKUP) emitJump (c.e, jit->dispatch);
+        else
+        {
+            emitMoveImmediate (c.e, EDX, x.reason);
+            emitJump (c.e, jit->exit);
+        }
+    }
+
+    jit->used = c.e.at - jit->buffer;
+    installBlock (jit, header, entry);
+    __atomic_store_n (&jit->traceHeads[header / 4], 1, __ATOMIC_RELAXED);
+    return entry;
+}
+
+// runs the program from the hot block at its pc with the reference
+// engine, recording each instruction into steps (MAX_TRACE_LENGTH of
+// them), until it comes back there. returns false if it left the
+// program, reached an instruction a trace cannot hold or another trace,
+// wrote to the program, faulted, ran out of budget, or took too long
+bool
+recordTrace (JitState* jit, MachineState& state, uint64_t& budget, TraceStep* steps, unsigned int& length)
+{
+    byte* memory = state.memory;
+    int32_t* registers = state.registers;
+    uint32_t header = state.currentInstructionAddress;
+    uint32_t version = state.codeVersion;
+    length = 0;
+    while (length < MAX_TRACE_LENGTH && budget > 0)
+    {
+        uint32_t pc = state.currentInstructionAddress;
+        if (pc >= state.codeSize || pc % 4 != 0) return false;
+        // (the compiler thread may be marking new traces)
+        if (length > 0 && __atomic_load_n (&jit->traceHeads[pc / 4], __ATOMIC_RELAXED)) return false;
+        byte opcode = memory[pc];
+        if (!isTraceable (opcode)) return false;
+
+        TraceStep& step = steps[length++];
+        step.pc = pc;
+        step.taken = hasFlag (opcode, ISA_CONDITIONAL)
+            && branchTaken (opcode, registers[memory[pc+1] >> 4], registers[memory[pc+1] & 0xf]);
+        uint64_t retired = state.instructionsRetired;
+        runReferenceUntraced (state, 1);
+        budget -= state.instructionsRetired - retired;
+        if (state.codeVersion != version || state.halted) return false;
+        step.next = state.currentInstructionAddress;
+        if (step.next == header) return true;
+    }
+    return false;
+}
+
+//========================================================================
+// Background compilation
+// the tiered engine does not stop the program to compile hot code. it
+// records the loop a hot block heads (which runs the program anyway),
+// queues a request and goes on running the block in the threaded
+// engine. a compiler thread takes the requests in order and installs
+// what it compiles in the blocks table, where the dispatcher and
+// runTranslated find it the next time they get there.
+// the compiler thread holds compiling while it compiles, and the
+// execution thread takes it only to throw translated code away or to
+// compile itself (the other engines). the compiler thread never throws
+// code away - when the buffer fills up it drops the request and the
+// execution thread flushes at its next stop
+
+// most requests waiting - later ones are dropped (the block is counted
+// again from cold and asks again when it is hot)
+const unsigned int MAX_COMPILE_REQUESTS = 64;
+
+// hot code to compile
+struct CompileRequest
+{
+    uint32_t pc;
+    // the machine when the request was made - its program and the
+    // codeVersion the request is for (guest memory is shared)
+    MachineState state;
+    // the path recorded from pc (none if it does not head a loop)
+    TraceStep steps[MAX_TRACE_LENGTH];
+    unsigned int length;
+};
+
+struct BackgroundCompiler
+{
+    std::thread thread;
+    std::mutex compiling;
+    // true while the compiler thread holds compiling
+    bool active;
+    // wakes the thread when a request is queued or it has to stop
+    std::mutex waiting;
+    std::condition_variable wake;
+    bool stop;
+    // requests [tail, head) (modulo MAX_COMPILE_REQUESTS) are queued -
+    // only the execution thread moves head and only the compiler thread
+    // moves tail
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    CompileRequest requests[MAX_COMPILE_REQUESTS];
+    // the compiler thread found the buffer full
+    std::atomic<bool> full;
+};
+
+// keeps the compiler thread (if there is one) out of the translated code
+// while it is in scope
+struct CompilerLock
+{
+    BackgroundCompiler* compiler;
+
+    CompilerLock (JitState* jit) : compiler (jit->compiler)
+    {
+        if (compiler != nullptr) compiler->compiling.lock ();
+    }
+    ~CompilerLock ()
+    {
+        if (compiler != nullptr) compiler->compiling.unlock ();
+    }
+};
+
+bool
+reserveCode (JitState* jit, size_t size)
+{
+    if (JIT_BUFFER_SIZE - jit->used >= size) return true;
+    if (jit->compiler != nullptr && jit->compiler->active)
+    {
+        jit->compiler->full = true;
+        return false;
+    }
+    flushJit (jit);
+    return true;
+}
+
+// compiles the function a request enters, or else the loop it heads, or
+// else its block - like the tiered engine does when it compiles itself
+void
+compileRequest (JitState* jit, CompileRequest& request)
+{
+    MachineState& state = request.state;
+    uint32_t pc = request.pc;
+    // the program changed (or was thrown away) since
+    if (state.codeVersion != jit->codeVersion || state.codeSize != jit->codeSize) return;
+    // asked for twice
+    if (jit->blocks[pc / 4] != nullptr) return;
+    if (isOptimizable (jit, state, pc) && optimizeFunction (jit, state, pc) != nullptr) return;
+    if (request.length > 0)
+    {
+        TraceCompiler& c = traceCompiler (jit);
+        std::memcpy (c.steps, request.steps, request.length * sizeof(TraceStep));
+        c.length = request.length;
+        if (compileTrace (jit, state) != nullptr) return;
+    }
+    translateBlock (jit, state, pc);
+}
+
+// the compiler thread
+void
+runCompiler (JitState* jit)
+{
+    BackgroundCompiler& b = *jit->compiler;
+    while (true)
+    {
+        uint32_t tail = b.tail.load (std::memory_order_relaxed);
+        {
+            std::unique_lock<std::mutex> lock (b.waiting);
+            b.wake.wait (lock, [&] { return b.stop || b.head.load (std::memory_order_acquire) != tail; });
+            if (b.stop) return;
+        }
+        {
+            std::lock_guard<std::mutex> lock (b.compiling);
+            b.active = true;
+            compileRequest (jit, b.requests[tail % MAX_COMPILE_REQUESTS]);
+            b.active = false;
+        }
+        b.tail.store (tail + 1, std::memory_order_release);
+    }
+}
+
+// starts the compiler thread - false if there cannot be one
+bool
+startCompiler (JitState* jit)
+{
+    if (jit->compiler != nullptr) return true;
+    jit->compiler = new BackgroundCompiler ();
+    try
+    {
+        jit->compiler->thread = std::thread (runCompiler, jit);
+    }
+    catch (const std::system_error&)
+    {
+        delete jit->compiler;
+        jit->compiler = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// stops the compiler thread once it is done with the request it is on
+void
+stopCompiler (JitState* jit)
+{
+    BackgroundCompiler* b = jit->compiler;
+    if (b == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock (b->waiting);
+        b->stop = true;
+    }
+    b->wake.notify_one ();
+    b->thread.join ();
+    delete b;
+    jit->compiler = nullptr;
+}
+
+// queues the hot block at the current pc for the compiler thread, with
+// the loop it heads if it does. the block is counted again from cold, so
+// the threaded engine runs it until its code is installed
+void
+requestCompile (JitState* jit, MachineState& state, uint64_t& budget)
+{
+    BackgroundCompiler& b = *jit->compiler;
+    uint32_t pc = state.currentInstructionAddress;
+    state.hotness[pc / 4] = 0;
+    uint32_t head = b.head.load (std::memory_order_relaxed);
+    if (head - b.tail.load (std::memory_order_acquire) == MAX_COMPILE_REQUESTS) return;
+
+    CompileRequest& request = b.requests[head % MAX_COMPILE_REQUESTS];
+    request.pc = pc;
+    if (!recordTrace (jit, state, budget, request.steps, request.length)) request.length = 0;
+    request.state = state;
+    {
+        std::lock_guard<std::mutex> lock (b.waiting);
+        b.head.store (head + 1, std::memory_order_release);
+    }
+    b.wake.notify_one ();
+}
+
+//========================================================================
+// Shared code
+
+// emits the entry trampoline, the dispatcher and the exit
+void
+emitSharedCode (JitState* jit)
+{
+    Emitter e = { jit->buffer };
+
+    // uint32_t enter (JitContext* context (rdi), void* block (rsi))
+    jit->enter = (uint32_t (*) (JitContext*, void*)) e.at;
+    // push rbx, rbp, r12, r13, r14, r15 ; sub rsp, 8
+    emitBytes (e, "\x53\x55\x41\x54\x41\x55\x41\x56\x41\x57\x48\x83\xec\x08", 14);
+    // mov rbp, rdi
+    emitBytes (e, "\x48\x89\xfd", 3);
+    // mov rbx, [rbp] ; mov r12, [rbp+8] ; mov r13, [rbp+16]
+    emitBytes (e, "\x48\x8b\x5d\x00\x4c\x8b\x65\x08\x4c\x8b\x6d\x10", 12);
+    // mov r14, [rbp+24] ; mov r15d, [rbp+32]
+    emitBytes (e, "\x4c\x8b\x75\x18\x44\x8b\x7d\x20", 8);
+    // jmp rsi
+    emitBytes (e, "\xff\xe6", 2);
+
+    // exit - eax = pc, edx = reason
+    jit->exit = e.at;
+    // mov rcx, [rbp+40] ; test rcx, rcx ; jz out
+    emitBytes (e, "\x48\x8b\x4d\x28\x48\x85\xc9", 7);
+    byte* out = emitShortJumpIf (e, CC_E);
+    // the budget held back is added back - add r13, rcx ;
+    // mov qword [rbp+40], 0
+    emitBytes (e, "\x49\x01\xcd\x48\xc7\x45\x28\x00\x00\x00\x00", 11);
+    // and running out of what was left is no reason to stop -
+    // cmp edx, EXIT_BUDGET ; jne out ; mov edx, EXIT_LOOKUP
+    emitBytes (e, "\x83\xfa", 2);
+    emit8 (e, EXIT_BUDGET);
+    byte* lookedUp = emitShortJumpIf (e, CC_NE);
+    emitMoveImmediate (e, EDX, EXIT_LOOKUP);
+    patchShortJump (e, lookedUp);
+    patchShortJump (e, out);
+    // mov [rbp+36], eax ; mov [rbp+16], r13 ; mov eax, edx
+    emitBytes (e, "\x89\x45\x24\x4c\x89\x6d\x10\x89\xd0", 9);
+    // add rsp, 8 ; pop r15, r14, r13, r12, rbp, rbx ; ret
+    emitBytes (e, "\x48\x83\xc4\x08\x41\x5f\x41\x5e\x41\x5d\x41\x5c\x5d\x5b\xc3", 15);
+
+    // lookup - eax = pc
+    byte* lookup = e.at;
+    emitMoveImmediate (e, EDX, EXIT_LOOKUP);
+    emitJump (e, jit->exit);
+
+    // dispatch - eax = pc
+    jit->dispatch = e.at;
+    // cmp eax, r15d ; jae lookup
+    emitBytes (e, "\x44\x39\xf8", 3);
+    emitJumpIf (e, CC_AE, lookup);
+    // test al, 3 ; jnz lookup
+    emitBytes (e, "\xa8\x03", 2);
+    emitJumpIf (e, CC_NE, lookup);
+    // mov ecx, eax ; shr ecx, 2 ; mov rdx, [r14 + rcx*8]
+    emitBytes (e, "\x89\xc1\xc1\xe9\x02\x49\x8b\x14\xce", 9);
+    // test rdx, rdx ; jz lookup
+    emitBytes (e, "\x48\x85\xd2", 3);
+    emitJumpIf (e, CC_E, lookup);
+    // jmp rdx
+    emitBytes (e, "\xff\xe2", 2);
+
+    jit->blocksStart = e.at - jit->buffer;
+    jit->used = jit->blocksStart;
+}
+
+// the machine's translated code, set up for its current program
+// (null if no executable memory could be had)
+JitState*
+prepareJit (MachineState& state)
+{
+    JitState* jit = state.jit;
+    if (jit == nullptr)
+    {
+        void* buffer = mmap (nullptr, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED) return nullptr;
+        jit = (JitState*) calloc (1, sizeof(JitState));
+        jit->buffer = (byte*) buffer;
+        emitSharedCode (jit);
+        state.jit = jit;
+    }
+    // (only the execution thread changes these - the compiler thread is
+    // held off only when they do)
+    bool resized = jit->blocks == nullptr || jit->codeSize != state.codeSize;
+    if (!resized && jit->codeVersion == state.codeVersion) return jit;
+    CompilerLock lock (jit);
+    if (resized)
+    {
+        free (jit->blocks);
+        free (jit->traceHeads);
+        jit->codeSize = state.codeSize;
+        jit->blocks = (void**) calloc (jit->codeSize / 4 + 1, sizeof(void*));
+        jit->traceHeads = (byte*) calloc (jit->codeSize / 4 + 1, 1);
+        jit->codeVersion = state.codeVersion;
+        flushJit (jit);
+    }
+    if (jit->codeVersion != state.codeVersion)
+    {
+        flushJit (jit);
+        jit->codeVersion = state.codeVersion;
+    }
+    return jit;
+}
+
+//========================================================================
+
+bool
+jitAvailable ()
+{
+    return true;
+}
+
+// runs translated code wherever it can. every block reached is 
+// translated, or (tiered) only the hot ones, with the threaded engine 
+// running the rest. with optimize, functions are compiled whole by the
+// optimizing tier - when first entered, or (tiered) once their entry
+// is hot 
+RunResult
+runTranslated (MachineState& state, uint64_t maxInstructions, bool tiered, bool optimize)
+{
+    JitState* jit = prepareJit (state);
+    if (jit == nullptr) return runReferenceUntraced (state, maxInstructions);
+    if (tiered && state.hotness == nullptr)
+        state.hotness = (uint32_t*) calloc (state.codeSize / 4 + 1, sizeof(uint32_t));
+    // the tiered engine compiles on its own thread (if it can have one)
+    bool background = tiered && startCompiler (jit);
+    BackgroundCompiler* compiler = jit->compiler;
+
+    JitContext context;
+    context.registers = state.registers;
+    context.memory = state.memory;
+    context.codeSize = state.codeSize;
+    uint64_t budget = maxInstructions;
+    // instructions retired by translated code
+    uint64_t translated = 0;
+    RunResult result = RUN_BUDGET_EXHAUSTED;
+
+    while (budget > 0)
+    {
+        // recording a trace stopped on a fault
+        if (state.halted)
+        {
+            result = RUN_HALTED;
+            break;
+        }
+        // an interpreter (or recording a trace) wrote to the program, or
+        // the compiler thread ran out of room
+        if (jit->codeVersion != state.codeVersion || (compiler != nullptr && compiler->full))
+        {
+            CompilerLock lock (jit);
+            flushJit (jit);
+            jit->codeVersion = state.codeVersion;
+            if (compiler != nullptr) compiler->full = false;
+        }
+
+        uint32_t pc = state.currentInstructionAddress;
+        void* block = nullptr;
+        if (pc < state.codeSize && pc % 4 == 0)
+        {
+            block = __atomic_load_n (&jit->blocks[pc / 4], __ATOMIC_ACQUIRE);
+            bool hot = tiered && block == nullptr && state.hotness[pc / 4] >= HOT_THRESHOLD;
+            if (background && hot)
+            {
+                requestCompile (jit, state, budget);
+                continue;
+            }
+            if (!background && block == nullptr)
+            {
+                CompilerLock lock (jit);
+                // a function is compiled whole where it is entered - if
+                // that fails it goes on like any other block
+                if (optimize && (hot || !tiered) && isOptimizable (jit, state, pc))
+                    block = optimizeFunction (jit, state, pc);
+                if (block == nullptr && !tiered) block = translateBlock (jit, state, pc);
+                else if (block == nullptr && hot)
+                {
+                    // the block may head a loop - follow the program until
+                    // it comes back here, and compile the path it took
+                    TraceCompiler& c = traceCompiler (jit);
+                    if (recordTrace (jit, state, budget, c.steps, c.length)) block = compileTrace (jit, state);
+                    else
+                    {
+                        // it does not (or the path cannot be a trace) - the
+                        // block is translated on its own, and if there is 
+                        // nothing to translate it is counted again from
+                        // cold so the threaded engine does not stop there
+                        // every time
+                        if (jit->codeVersion == state.codeVersion && translateBlock (jit, state, pc) == nullptr)
+                            state.hotness[pc / 4] = 0;
+                        continue;
+                    }
+                }
+            }
+        }
+
+        // left to an interpreter
+        if (block == nullptr)
+        {
+            uint64_t retired = state.instructionsRetired;
+            if (tiered) result = runThreadedProfiled (state, budget);
+            else        result = runReferenceUntraced (state, 1);
+            budget -= state.instructionsRetired - retired;
+            if (result != RUN_BUDGET_EXHAUSTED) break;
+            continue;
+        }
+
+        context.budget = budget;
+        context.reserve = 0;
+        context.blocks = jit->blocks;
+        uint32_t reason = jit->enter (&context, block);
+        translated += budget - context.budget;
+        budget = context.budget;
+        state.currentInstructionAddress = context.pc;
+
+        if (reason == EXIT_BUDGET)
+        {
+            // fewer instructions left than the next block has
+            state.instructionsRetired += translated;
+            return runReferenceUntraced (state, budget);
+        }
+        if (reason == EXIT_STORE)
+        {
+            // the program changed - translate it again as it runs
+            ++state.codeVersion;
+            state.codeHandlers = nullptr;
+            CompilerLock lock (jit);
+            flushJit (jit);
+            jit->codeVersion = state.codeVersion;
+        }
+        if (reason == EXIT_INTERPRET && budget > 0)
+        {
+            // optimized code cannot start here this time
+            uint64_t retired = state.instructionsRetired;
+            result = runReferenceUntraced (state, 1);
+            budget -= state.instructionsRetired - retired;
+            if (result != RUN_BUDGET_EXHAUSTED) break;
+        }
+    }
+
+    state.instructionsRetired += translated;
+    return result;
+}
+
+RunResult
+runJit (MachineState& state, uint64_t maxInstructions)
+{
+    return runTranslated (state, maxInstructions, false, false);
+}
+
+RunResult
+runTiered (MachineState& state, uint64_t maxInstructions)
+{
+    return runTranslated (state, maxInstructions, true, true);
+}
+
+RunResult
+runOptimized (MachineState& state, uint64_t maxInstructions)
+{
+    return runTranslated (state, maxInstructions, false, true);
+}
+
+bool
+leaveTranslatedCode (MachineState& state, void* context)
+{
+    JitState* jit = state.jit;
+    if (jit == nullptr) return false;
+    greg_t* registers = ((ucontext_t*) context)->uc_mcontext.gregs;
+    byte* at = (byte*) registers[REG_RIP];
+    if (at < jit->buffer + jit->blocksStart + 7 || at >= jit->buffer + JIT_BUFFER_SIZE) return false;
+    if (!isFaultMarker (at - 7)) return false;
+    int32_t displacement;
+    std::memcpy (&displacement, at - 4, 4);
+    registers[REG_RIP] = (greg_t)(at + displacement);
+    return true;
+}
+
+void
+releaseJit (MachineState& state)
+{
+    if (state.jit == nullptr) return;
+    stopCompiler (state.jit);
+    munmap (state.jit->buffer, JIT_BUFFER_SIZE);
+    free (state.jit->blocks);
+    free (state.jit->traceHeads);
+    free (state.jit->tracer);
+    releaseOptimizer (state.jit);
+    free (state.jit);
+    state.jit = nullptr;
+}
+
+#else
+
+//========================================================================
+// other hosts run the reference engine
+
+bool
+jitAvailable ()
+{
+    return false;
+}
+
+RunResult
+runJit (MachineState& state, uint64_t maxInstructions)
+{
+    return runReferenceUntraced (state, maxInstructions);
+}
+
+RunResult
+runTiered (MachineState& state, uint64_t maxInstructions)
+{
+    return runReferenceUntraced (state, maxInstructions);
+}
+
+RunResult
+runOptimized (MachineState& state, uint64_t maxInstructions)
+{
+    return runReferenceUntraced (state, maxInstructions);
+}
+
+bool
+leaveTranslatedCode (MachineState& state, void* context)
+{
+    return false;
+}
+
+void
+releaseJit (MachineState& state)
+{
+}
+
+#endif
+
+//========================================================================
@@ -0,0 +1,60 @@
+// AmyMachine JIT
+// translates basic blocks of the 32-bit machine language into native
+// x86-64 code - used by ENGINE_JIT, ENGINE_TIERED and ENGINE_OPT
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_JIT_H
+#define AMY_JIT_H
+
+#include "amyMachine.h"
+
+//========================================================================
+
+// true if this host can run translated code (x86-64 Linux)
+bool jitAvailable ();
+
+// runs like the other engines - compiles each block as it is first
+// reached and hands the instructions it does not translate (GETCHAR,
+// PUTCHAR, HLT, invalid opcodes and code outside of the program) to
+// the reference engine
+RunResult runJit (MachineState& state, uint64_t maxInstructions);
+
+// runs like the other engines - starts in the threaded engine, which
+// counts how often each block is entered, and only translates a block
+// once it is hot (a hot function entry has its whole function compiled
+// by the optimizing tier). short runs never pay for translation. hot
+// code is compiled on a thread of its own while the threaded engine
+// goes on running it, so the program never waits for the compiler
+RunResult runTiered (MachineState& state, uint64_t maxInstructions);
+
+// runs like the JIT, but compiles each function whole when it is first
+// entered (see amyOpt.cpp) - blocks it cannot place in a function are
+// translated by the JIT
+RunResult runOptimized (MachineState& state, uint64_t maxInstructions);
+
+// frees the translated code of a machine
+void releaseJit (MachineState& state);
+
+// a load/store of the machine's translated code faulted - points the
+// SIGSEGV handler's context at the code that leaves for the reference
+// engine at the instruction, or returns false if the fault was not in
+// translated code (see Guest faults in amyMachine.cpp)
+bool leaveTranslatedCode (MachineState& state, void* context);
+
+// entries before the tiered engine translates a block
+const uint32_t HOT_THRESHOLD = 64;
+// extra count a block gets when it is reached by a backward branch,
+// so loop headers are translated after a few iterations
+const uint32_t BACKWARD_WEIGHT = 8;
+
+// the reference engine without tracing - defined in amyMachine.cpp
+RunResult runReferenceUntraced (MachineState& state, uint64_t maxInstructions);
+// the threaded engine counting block entries into state.hotness - stops
+// early (with RUN_BUDGET_EXHAUSTED) before the first hot block.
+// defined in amyMachine.cpp
+RunResult runThreadedProfiled (MachineState& state, uint64_t maxInstructions);
+
+//========================================================================
+
+#endif
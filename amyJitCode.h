@@ -0,0 +1,348 @@
+// AmyMachine JIT code
+// the layout of translated code and the x86-64 encoder - shared by the
+// block and trace translator (amyJit.cpp) and the optimizing tier
+// (amyOpt.cpp)
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_JIT_CODE_H
+#define AMY_JIT_CODE_H
+
+#include <cstring>   //memcpy
+#include <cstddef>   //offsetof
+
+#include "amyJit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+//========================================================================
+// Layout of translated code
+// guest registers stay in MachineState::registers (a fixed frame) and
+// every translated block keeps these host registers pinned:
+//      rbx  guest register file (r0 at [rbx], sp at [rbx+60])
+//      r12  guest memory
+//      r13  instructions left in the budget
+//      r14  translated block for each word of the program (or null)
+//      r15d size of the program in bytes
+//      rbp  the JitContext of the current call
+// each block charges the budget for all of its instructions on entry
+// and leaves with the next guest pc in eax. it jumps to the
+// dispatcher, which goes straight on to the next block if that has
+// been translated, and otherwise returns to runJit with the reason
+// in edx. loads and stores are not range checked - each one comes
+// right after a fault marker, which points at the code that leaves
+// for the interpreter at its instruction if it faults
+
+// most values optimized code keeps in the JitContext
+const unsigned int MAX_OPT_SPILLS = 256;
+
+// what translated code shares with runJit
+struct JitContext
+{
+    int32_t* registers;
+    byte* memory;
+    uint64_t budget;
+    void** blocks;
+    uint32_t codeSize;
+    // where the guest stopped
+    uint32_t pc;
+    // budget optimized code held back so a loop cannot run further than
+    // it was checked for (see amyOpt.cpp) - the exit adds it back
+    uint64_t reserve;
+    // where optimized code keeps the values it has no host register for
+    // (see amyOpt.cpp) - only used between two of its exits
+    uint32_t spills[MAX_OPT_SPILLS];
+};
+
+static_assert (offsetof(JitContext, registers) == 0 && offsetof(JitContext, memory) == 8
+    && offsetof(JitContext, budget) == 16 && offsetof(JitContext, blocks) == 24
+    && offsetof(JitContext, codeSize) == 32 && offsetof(JitContext, pc) == 36
+    && offsetof(JitContext, reserve) == 40,
+    "the entry trampoline expects the JitContext layout");
+
+// why translated code returned
+enum JitExit : uint32_t
+{
+    // the next pc has no translated block
+    EXIT_LOOKUP,
+    // the budget cannot cover the next block
+    EXIT_BUDGET,
+    // a store wrote to the program - pc is the instruction after it
+    EXIT_STORE,
+    // optimized code was entered somewhere its assumptions do not hold,
+    // or a load/store faulted - the instruction at pc has to run in the
+    // interpreter
+    EXIT_INTERPRET
+};
+
+// translated code of one machine
+struct JitState
+{
+    byte* buffer;
+    size_t used;
+    // where blocks start in buffer (after the shared code)
+    size_t blocksStart;
+    // saves the host registers, pins the ones above and jumps to a block
+    uint32_t (*enter) (JitContext* context, void* block);
+    // shared tails of every block
+    byte* dispatch;
+    byte* exit;
+    // translated block for each word of the program
+    void** blocks;
+    // words of the program that start a trace (see Traces)
+    byte* traceHeads;
+    // scratch space for recording and compiling traces
+    struct TraceCompiler* tracer;
+    // the optimizing tier's view of the program (see amyOpt.cpp)
+    struct Optimizer* optimizer;
+    // the tiered engine's compiler thread (see amyJit.cpp) - null until
+    // the tiered engine first runs
+    struct BackgroundCompiler* compiler;
+    uint32_t codeSize;
+    // state.codeVersion the blocks were translated from
+    uint32_t codeVersion;
+};
+
+// room for translated code - everything is thrown away when it fills up
+const size_t JIT_BUFFER_SIZE = 32 << 20;
+// longest block translated (in instructions)
+const unsigned int MAX_BLOCK_LENGTH = 256;
+// most bytes a block's entry, exit or one instruction translates to
+// (with the code it leaves by if it faults)
+const unsigned int MAX_INSTRUCTION_BYTES = 96;
+
+//========================================================================
+// x86-64 encoding
+// only the forms the translator needs. host registers are numbered as
+// in the encoding
+
+const byte EAX = 0;
+const byte ECX = 1;
+const byte EDX = 2;
+
+// condition codes
+const byte CC_B  = 0x2;
+const byte CC_AE = 0x3;
+const byte CC_E  = 0x4;
+const byte CC_NE = 0x5;
+const byte CC_BE = 0x6;
+const byte CC_L  = 0xc;
+const byte CC_GE = 0xd;
+const byte CC_LE = 0xe;
+const byte CC_G  = 0xf;
+
+// where the next byte of code goes
+struct Emitter
+{
+    byte* at;
+};
+
+inline void
+emit8 (Emitter& e, byte value)
+{
+    *e.at++ = value;
+}
+
+inline void
+emit16 (Emitter& e, uint16_t value)
+{
+    std::memcpy (e.at, &value, 2);
+    e.at += 2;
+}
+
+inline void
+emit32 (Emitter& e, uint32_t value)
+{
+    std::memcpy (e.at, &value, 4);
+    e.at += 4;
+}
+
+inline void
+emitBytes (Emitter& e, const char* bytes, int count)
+{
+    std::memcpy (e.at, bytes, count);
+    e.at += count;
+}
+
+// opcode with a [rbx + disp8] operand - guest registers live at
+// [rbx + 4*r]
+inline void
+emitFrame (Emitter& e, byte opcode, byte reg, byte displacement)
+{
+    emit8 (e, opcode);
+    emit8 (e, 0x43 | (reg << 3));
+    emit8 (e, displacement);
+}
+
+// mov host, guest
+inline void
+emitLoadGuest (Emitter& e, byte host, byte guest)
+{
+    emitFrame (e, 0x8b, host, guest * 4);
+}
+
+// mov guest, host
+inline void
+emitStoreGuest (Emitter& e, byte host, byte guest)
+{
+    emitFrame (e, 0x89, host, guest * 4);
+}
+
+// mov host, imm32
+inline void
+emitMoveImmediate (Emitter& e, byte host, uint32_t value)
+{
+    emit8 (e, 0xb8 + host);
+    emit32 (e, value);
+}
+
+// <op> eax, imm32 where extension picks the op (81 /extension)
+inline void
+emitImmediateOp (Emitter& e, byte extension, int32_t value)
+{
+    emit8 (e, 0x81);
+    emit8 (e, 0xc0 | (extension << 3));
+    emit32 (e, value);
+}
+
+// shl/shr/sar eax by cl (extension 4/5/7)
+inline void
+emitShiftByCl (Emitter& e, byte extension)
+{
+    emit8 (e, 0xd3);
+    emit8 (e, 0xc0 | (extension << 3));
+}
+
+// shl/shr/sar eax by imm8
+inline void
+emitShiftByImmediate (Emitter& e, byte extension, byte count)
+{
+    emit8 (e, 0xc1);
+    emit8 (e, 0xc0 | (extension << 3));
+    emit8 (e, count);
+}
+
+// movsxd rax, eax - guest addresses are signed 32-bit offsets
+inline void
+emitWidenAddress (Emitter& e)
+{
+    emitBytes (e, "\x48\x63\xc0", 3);
+}
+
+// <opcode> with a [r12 + rax] operand - guest memory at address eax
+inline void
+emitGuestMemory (Emitter& e, const char* opcode, int opcodeLength, byte reg)
+{
+    emitBytes (e, opcode, opcodeLength);
+    emit8 (e, 0x04 | (reg << 3));
+    emit8 (e, 0x04);
+}
+
+// nopl [rax + rel32] right before a guest memory access - if the
+// access faults, leaveTranslatedCode sends it to the code rel32 points
+// at (from the access). returns the rel32 to patch
+inline byte*
+emitFaultMarker (Emitter& e)
+{
+    emitBytes (e, "\x0f\x1f\x80", 3);
+    emit32 (e, 0);
+    return e.at - 4;
+}
+
+// true if the 7 bytes at code are a fault marker
+inline bool
+isFaultMarker (const byte* code)
+{
+    return code[0] == 0x0f && code[1] == 0x1f && code[2] == 0x80;
+}
+
+// jmp rel32
+inline void
+emitJump (Emitter& e, byte* target)
+{
+    emit8 (e, 0xe9);
+    emit32 (e, (uint32_t)(target - (e.at + 4)));
+}
+
+// jcc rel32
+inline void
+emitJumpIf (Emitter& e, byte condition, byte* target)
+{
+    emit8 (e, 0x0f);
+    emit8 (e, 0x80 | condition);
+    emit32 (e, (uint32_t)(target - (e.at + 4)));
+}
+
+// jcc rel8 to a later point - returns the displacement to patch
+inline byte*
+emitShortJumpIf (Emitter& e, byte condition)
+{
+    emit8 (e, 0x70 | condition);
+    emit8 (e, 0);
+    return e.at - 1;
+}
+
+// points a short jump at the next byte to be emitted
+inline void
+patchShortJump (Emitter& e, byte* displacement)
+{
+    *displacement = (byte)(e.at - (displacement + 1));
+}
+
+// leaves translated code with pc and a reason
+inline void
+emitExit (Emitter& e, JitState* jit, uint32_t pc, JitExit reason)
+{
+    emitMoveImmediate (e, EAX, pc);
+    emitMoveImmediate (e, EDX, reason);
+    emitJump (e, jit->exit);
+}
+
+// true for instructions translated code runs itself - the rest need
+// the machine's input/output or stop it
+inline bool
+isTranslatable (byte opcode)
+{
+    return !hasFlag (opcode, ISA_HALTS | ISA_INPUT | ISA_OUTPUT);
+}
+
+// the condition of a branch
+inline bool
+branchTaken (byte opcode, int32_t a, int32_t b)
+{
+    return instructionInfo (opcode).compute (a, b) != 0;
+}
+
+// folds ADD..XOR of two constants like the interpreters compute them -
+// false for a division that has to trap at run time
+inline bool
+evaluate (byte opcode, int32_t a, int32_t b, uint32_t* result)
+{
+    if ((opcode == OPCODE_DIV || opcode == OPCODE_MOD) && (b == 0 || (a == INT32_MIN && b == -1)))
+        return false;
+    *result = instructionInfo (opcode).compute (a, b);
+    return true;
+}
+
+// throws away all translated code
+void flushJit (JitState* jit);
+
+// makes room for size bytes of code, throwing everything away if the
+// buffer is full - false if the compiler thread found it full (it
+// cannot throw away code the program may be running)
+bool reserveCode (JitState* jit, size_t size);
+
+// makes code the translated code for pc - the compiler thread installs
+// code while the program runs, so the code must be complete before the
+// dispatcher can see it
+inline void
+installBlock (JitState* jit, uint32_t pc, void* code)
+{
+    __atomic_store_n (&jit->blocks[pc / 4], code, __ATOMIC_RELEASE);
+}
+
+#endif
+
+//========================================================================
+
+#endif
@@ -0,0 +1,2710 @@
+// AmyMachine 
+// embeddable interpreter for the 32-bit machine language 
+// that uses a RISC-V-like format 
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>   //memcpy
+#include <cstddef>   //offsetof
+#include <ctype.h>   //tolower
+#include <sys/mman.h> //mmap
+#include <signal.h>   //sigaction
+#include <setjmp.h>   //sigsetjmp
+#include <atomic>     //atomic_signal_fence
+#include <unistd.h>   //sysconf
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "amyMachine.h"
+#include "amyJit.h"
+#include "amyCfg.h"
+#include "amyAot.h"
+#include "amyCache.h"
+
+//========================================================================
+
+void 
+printMemory (byte* memory, size_t memory_size, int bytesPerLine)
+{
+    printf ("=== MEMORY ===================================================\n");
+    size_t numSameLines = 0; 
+    // start prevLine with something that wont be the same as the first line
+    int prevLine = (*(int*)&memory[0]) - 1; 
+    for (size_t i = 0; i < memory_size; i+=bytesPerLine)
+    {
+        // ensure line is new - otherwise ignore the line
+        int line = *(int*)&memory[i];
+        if (line == prevLine)
+        {
+            numSameLines++;
+            // ignore the line 
+            continue; 
+        }
+        else if (numSameLines > 0)
+        {
+            printf ("             ^ repeated %lu times\n", numSameLines);
+            numSameLines = 0;
+        }
+        prevLine = line; 
+
+        // print address (memory is below 2^31, so it fits in 32 bits)
+        unsigned int address = i; 
+        printf (
+            "0x%x%x%x%x%x%x%x%x | ", 
+            (0b11110000000000000000000000000000 & address) >> 28,
+            (0b00001111000000000000000000000000 & address) >> 24,
+            (0b00000000111100000000000000000000 & address) >> 20,
+            (0b00000000000011110000000000000000 & address) >> 16,
+            (0b00000000000000001111000000000000 & address) >> 12,
+            (0b00000000000000000000111100000000 & address) >>  8,
+            (0b00000000000000000000000011110000 & address) >>  4,
+            (0b00000000000000000000000000001111 & address) >>  0
+        );
+        // print binary representation (4 bytes per line)
+        for (size_t j = i; j < i+bytesPerLine; ++j)
+        {
+            printf (
+                "%d%d%d%d%d%d%d%d ",
+                (0b10000000 & memory[j]) >> 7,
+                (0b01000000 & memory[j]) >> 6,
+                (0b00100000 & memory[j]) >> 5,
+                (0b00010000 & memory[j]) >> 4,
+                (0b00001000 & memory[j]) >> 3,
+                (0b00000100 & memory[j]) >> 2,
+                (0b00000010 & memory[j]) >> 1,
+                (0b00000001 & memory[j]) >> 0
+            );
+        }
+        printf ("| ");
+        // print hex representation
+        for (size_t j = i; j < i+bytesPerLine; ++j)
+        {
+            printf (
+                "%x%x ",
+                (0b11110000 & memory[j]) >> 4,
+                (0b00001111 & memory[j]) >> 0
+            );
+        }
+        printf ("\n");
+    }
+    if (numSameLines > 0)
+    {
+        printf ("             ^ repeated %lu times\n", numSameLines);
+        numSameLines = 0;
+    }
+    printf ("=== END MEMORY ===============================================\n");
+}
+
+//========================================================================
+// Debug output 
+
+// reads the 4-byte instruction at address in big endian 
+unsigned int 
+fetchInstruction (byte* memory, unsigned int address)
+{
+    unsigned int instruction = memory[address];
+    instruction = (instruction << 8) | memory[address+1];
+    instruction = (instruction << 8) | memory[address+2];
+    instruction = (instruction << 8) | memory[address+3];
+    return instruction; 
+}
+
+void 
+printInstruction (unsigned int address, unsigned int instruction)
+{
+    // print address
+    printf (
+        "0x%x%x%x%x%x%x%x%x | ", 
+        (0b11110000000000000000000000000000 & address) >> 28,
+        (0b00001111000000000000000000000000 & address) >> 24,
+        (0b00000000111100000000000000000000 & address) >> 20,
+        (0b00000000000011110000000000000000 & address) >> 16,
+        (0b00000000000000001111000000000000 & address) >> 12,
+        (0b00000000000000000000111100000000 & address) >>  8,
+        (0b00000000000000000000000011110000 & address) >>  4,
+        (0b00000000000000000000000000001111 & address) >>  0
+    );
+    // print instruction 
+    printf (
+        "%x%x %x%x %x%x %x%x", 
+        (0b11110000000000000000000000000000 & instruction) >> 28,
+        (0b00001111000000000000000000000000 & instruction) >> 24,
+        (0b00000000111100000000000000000000 & instruction) >> 20,
+        (0b00000000000011110000000000000000 & instruction) >> 16,
+        (0b00000000000000001111000000000000 & instruction) >> 12,
+        (0b00000000000000000000111100000000 & instruction) >>  8,
+        (0b00000000000000000000000011110000 & instruction) >>  4,
+        (0b00000000000000000000000000001111 & instruction) >>  0
+    );
+    // print assembly 
+    byte bytes[4] = { (byte)(instruction >> 24), (byte)(instruction >> 16), (byte)(instruction >> 8), (byte)instruction }; 
+    char text[64]; 
+    formatInstruction (bytes, 0, text, sizeof (text)); 
+    printf (" | %s\n", text); 
+}
+
+// the assembly name of a register 
+static const char* 
+registerName (byte r)
+{
+    static const char* names[16] = {
+        "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", 
+        "r8", "r9", "r10", "r11", "r12", "ra", "bp", "sp"
+    }; 
+    return names[r & 0xf]; 
+}
+
+void 
+formatInstruction (const byte* memory, unsigned int address, char* text, size_t size)
+{
+    const byte* instruction = memory + address; 
+    const InstructionInfo& info = instructionInfo (instruction[0]); 
+    const char* dest = registerName (instruction[1] >> 4); 
+    const char* src1 = registerName (instruction[1] & 0xf); 
+    const char* src2 = registerName (instruction[2] >> 4); 
+    // immediates/offsets are stored in little endian 
+    int imm = (int16_t)(instruction[2] | (instruction[3] << 8)); 
+
+    // assembly is lower case 
+    char mnemonic[16]; 
+    size_t length = 0; 
+    for (; info.mnemonic[length] && length < sizeof (mnemonic) - 1; ++length) 
+        mnemonic[length] = tolower (info.mnemonic[length]); 
+    mnemonic[length] = '\0'; 
+
+    if (info.opcode == OPCODE_UNDEFINED) 
+    {
+        snprintf (text, size, "undefined 0x%x", instruction[0]); 
+        return; 
+    }
+    switch (info.format)
+    {
+        case FORMAT_NONE:       snprintf (text, size, "%s", mnemonic); break; 
+        case FORMAT_CONSTANT:   snprintf (text, size, "%s %s, 0x%x", mnemonic, dest, imm & 0xffff); break; 
+        case FORMAT_LOAD:       snprintf (text, size, "%s %s, %d(%s)", mnemonic, dest, imm, src1); break; 
+        case FORMAT_STORE:      snprintf (text, size, "%s %d(%s), %s", mnemonic, imm, dest, src1); break; 
+        case FORMAT_REGISTERS:  snprintf (text, size, "%s %s, %s, %s", mnemonic, dest, src1, src2); break; 
+        case FORMAT_IMMEDIATE:  snprintf (text, size, "%s %s, %s, %d", mnemonic, dest, src1, imm); break; 
+        case FORMAT_BRANCH:     snprintf (text, size, "%s %s, %s, %s", mnemonic, dest, src1, src2); break; 
+        case FORMAT_REGISTER:   snprintf (text, size, "%s %s", mnemonic, dest); break; 
+    }
+}
+
+void 
+printRegisters (int32_t* registerFile)
+{
+    // print in memory order
+    byte* registers = (byte*)registerFile; 
+    printf("registers:\n");
+    for (int i = 0; i < 16*4; i+=4)
+    {
+        printf(
+            "   r%2d: %x%x %x%x %x%x %x%x ",
+            i/4,
+            (0b11110000 & registers[i+0]) >> 4,
+            (0b00001111 & registers[i+0]) >> 0,
+            (0b11110000 & registers[i+1]) >> 4,
+            (0b00001111 & registers[i+1]) >> 0,
+            (0b11110000 & registers[i+2]) >> 4,
+            (0b00001111 & registers[i+2]) >> 0,
+            (0b11110000 & registers[i+3]) >> 4,
+            (0b00001111 & registers[i+3]) >> 0
+        );
+        // special registers
+        if (i/4 == ra) printf ("(ra)");
+        if (i/4 == bp) printf ("(bp)");
+        if (i/4 == sp) printf ("(sp)");
+        printf("\n");
+    }
+}
+
+//========================================================================
+// Tracing policies 
+// the engines are templates on one of these. the release instantiation 
+// calls empty inline functions so its loop has no debug branches at all,
+// and -d picks the traced instantiation once at startup 
+
+// release - traces nothing 
+struct NoTrace 
+{
+    // fuse common instruction sequences into superinstructions 
+    static const bool fuse = true; 
+    // count block entries for the tiered engine 
+    static const bool profile = false; 
+    static void instruction (byte*, unsigned int) {}
+    static void registers (int32_t*) {}
+    static void outputBegin () {}
+    static void outputEnd () {}
+};
+
+// debug (-d) - prints each instruction, its output, and the register 
+// file after it executes 
+struct DebugTrace 
+{
+    // the trace shows every instruction and register file on its own 
+    static const bool fuse = false; 
+    static const bool profile = false; 
+    static void instruction (byte* memory, unsigned int address)
+    {
+        printInstruction (address, fetchInstruction (memory, address));
+    }
+    static void registers (int32_t* registers) { printRegisters (registers); }
+    static void outputBegin () { printf ("Output = '"); }
+    static void outputEnd () { printf ("'\n"); }
+};
+
+// tiered - traces nothing, and counts how often each block is entered 
+// so the threaded engine can hand hot blocks to the JIT 
+struct ProfileTrace : NoTrace 
+{
+    static const bool profile = true; 
+};
+
+//========================================================================
+// Input 
+
+// GETCHAR - the next queued input byte, or EOF (-1) once the input is 
+// closed and fully read 
+inline int 
+readInput (MachineState& state)
+{
+    if (state.inputPosition < state.inputSize)
+        return state.input[state.inputPosition++];
+    return EOF; 
+}
+
+//========================================================================
+// Self-modifying code 
+
+// a store wrote to the program - the predecoded and translated forms of 
+// it are stale 
+inline void 
+programWritten (MachineState& state)
+{
+    state.codeHandlers = nullptr; 
+    ++state.codeVersion; 
+    state.codeWritten = true; 
+}
+
+//========================================================================
+// Guest faults 
+// loads and stores are never range checked. a guarded machine's memory 
+// sits in the middle of a PROT_NONE window covering every address an 
+// access can reach - a signed 32-bit register, a 16-bit offset and the 
+// width of the access - so an access outside of memory faults instead 
+// of touching host memory. the SIGSEGV handler turns that fault into a 
+// guest fault: translated code leaves for the reference engine at the 
+// instruction (see leaveTranslatedCode), and an interpreter jumps back 
+// to where it was entered and stops the machine on the instruction as 
+// if it had not run. memory is mapped in whole pages, so an access 
+// between memorySize and the end of its last page still succeeds on 
+// every engine (see AmyMachine::AmyMachine) 
+
+// what an access can reach past either end of the 32-bit range 
+static const size_t GUARD_SIZE = 64 << 10; 
+// the window reserved around memory 
+static const size_t WINDOW_SIZE = ((size_t)1 << 32) + 2 * GUARD_SIZE; 
+
+// start of the window memory sits in 
+inline byte*
+windowOf (byte* memory)
+{
+    return memory - ((size_t)1 << 31) - GUARD_SIZE; 
+}
+
+// end of the pages memory is mapped in 
+static size_t
+mappedEnd (const MachineState& state)
+{
+    static const size_t pageSize = sysconf (_SC_PAGESIZE); 
+    return (state.memorySize + pageSize - 1) & ~(pageSize - 1); 
+}
+
+// an interpreter running on this thread - it publishes how far it got 
+// before each access that may fault, and a fault sends it back to 
+// resume with the guest address 
+struct FaultScope
+{
+    sigjmp_buf resume; 
+    FaultScope* outer; 
+    uint32_t address; 
+    // reference and switch engine - the instruction and how many 
+    // instructions of the run retired before it 
+    uint32_t pc; 
+    uint64_t retired; 
+    // threaded engine - the record, the budget and the end of its run 
+    // as charged, and where the scratch record was decoded from 
+    const DecodedInstruction* record; 
+    uint64_t budget; 
+    const DecodedInstruction* runEnd; 
+    uint32_t outsideAddress; 
+
+    FaultScope (); 
+    ~FaultScope (); 
+}; 
+
+// the machine running on this thread (null if none) and its innermost 
+// interpreter 
+static thread_local MachineState* runningState = nullptr; 
+static thread_local FaultScope* faultScope = nullptr; 
+
+// nothing is published yet - a fault before the first access finds no 
+// record rather than a stale one 
+FaultScope::FaultScope () : outer (faultScope), address (0), pc (0), retired (0), 
+    record (nullptr), budget (0), runEnd (nullptr), outsideAddress (0)
+{
+    faultScope = this; 
+}
+
+FaultScope::~FaultScope ()
+{
+    faultScope = outer; 
+}
+
+// the published progress has to be in memory before the access 
+#define PUBLISHED() std::atomic_signal_fence (std::memory_order_seq_cst)
+
+// makes state the running machine while it is in scope 
+struct RunningScope
+{
+    MachineState* outer; 
+
+    RunningScope (MachineState& state) : outer (runningState)
+    {
+        runningState = &state; 
+    }
+    ~RunningScope ()
+    {
+        runningState = outer; 
+    }
+}; 
+
+// the SIGSEGV action there was before ours - faults that are not the 
+// guest's are passed on to it 
+static struct sigaction previousAction; 
+
+static void
+handleFault (int signal, siginfo_t* info, void* context)
+{
+    MachineState* state = runningState; 
+    byte* address = (byte*) info->si_addr; 
+    if (state != nullptr && state->guarded && address >= windowOf (state->memory)
+        && address < windowOf (state->memory) + WINDOW_SIZE)
+    {
+        if (leaveTranslatedCode (*state, context)) return; 
+        if (faultScope != nullptr)
+        {
+            faultScope->address = (uint32_t)(address - state->memory); 
+            siglongjmp (faultScope->resume, 1); 
+        }
+    }
+    if (previousAction.sa_flags & SA_SIGINFO) previousAction.sa_sigaction (signal, info, context); 
+    else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN)
+        previousAction.sa_handler (signal); 
+    else
+    {
+        // the access faults again once we return, and kills the process 
+        struct sigaction action; 
+        std::memset (&action, 0, sizeof(action)); 
+        action.sa_handler = SIG_DFL; 
+        sigaction (SIGSEGV, &action, nullptr); 
+    }
+}
+
+// installs handleFault once per process. SA_NODEFER leaves SIGSEGV 
+// unblocked after an interpreter jumps out of the handler 
+static void
+installFaultHandler ()
+{
+    static bool installed = [] {
+        struct sigaction action; 
+        std::memset (&action, 0, sizeof(action)); 
+        action.sa_sigaction = handleFault; 
+        action.sa_flags = SA_SIGINFO | SA_NODEFER; 
+        sigemptyset (&action.sa_mask); 
+        return sigaction (SIGSEGV, &action, &previousAction) == 0; 
+    } (); 
+    (void) installed; 
+}
+
+// the access of the instruction at pc faulted at address with retired 
+// instructions of the run done before it - the machine stops on the 
+// instruction as if it had not run 
+static RunResult
+stopAtFault (MachineState& state, uint32_t address, uint32_t pc, uint64_t retired)
+{
+    // instruction fetches never fault (the reference engine checks the 
+    // last word of memory first), so pc holds the instruction. PUSH and 
+    // CALL move sp before they store 
+    byte opcode = state.memory[pc]; 
+    if (opcode == OPCODE_PUSH || opcode == OPCODE_CALL)
+        state.registers[sp] += 4; 
+    printf ("Invalid address %x\n", address); 
+    state.currentInstructionAddress = pc; 
+    state.instructionsRetired += retired; 
+    state.halted = true; 
+    return RUN_HALTED; 
+}
+
+//========================================================================
+// Reference engine 
+// decodes and executes one instruction at a time by walking an 
+// if/else chain over the opcode. 
+// kept as the baseline to compare the faster engines against 
+
+// executes at most maxInstructions instructions starting from the 
+// state's current instruction 
+template <typename Trace>
+static RunResult 
+executeReference (MachineState& state, uint64_t maxInstructions, FaultScope& fault)
+{
+    byte* memory = state.memory; 
+    int32_t* registers = state.registers; 
+    unsigned int currentInstructionAddress = state.currentInstructionAddress;
+    RunResult result = RUN_BUDGET_EXHAUSTED; 
+    uint64_t executed = 0; 
+
+// publishes the instruction before a load/store that may fault 
+#define ACCESS()                                                            \
+    do {                                                                    \
+        fault.pc = currentInstructionAddress;                               \
+        fault.retired = executed;                                           \
+        PUBLISHED();                                                        \
+    } while (0)
+
+    for (; executed < maxInstructions; ++executed)
+    {
+        // ran off the end of memory 
+        if (currentInstructionAddress >= state.memorySize)
+        {
+            state.halted = true; 
+            result = RUN_HALTED; 
+            break; 
+        }
+        // the last word of memory can reach past its end - its fetch 
+        // stops the machine where it would leave the mapped pages 
+        if ((size_t)currentInstructionAddress + 4 > mappedEnd (state))
+        {
+            printf ("Invalid address %zx\n", mappedEnd (state)); 
+            state.halted = true; 
+            result = RUN_HALTED; 
+            break; 
+        }
+
+        // we have to pack the instruction into the int using big endian 
+        unsigned int instruction = memory[currentInstructionAddress];
+        instruction = instruction << 8; 
+        instruction |= memory[currentInstructionAddress+1];
+        instruction = instruction << 8; 
+        instruction |= memory[currentInstructionAddress+2];
+        instruction = instruction << 8; 
+        instruction |= memory[currentInstructionAddress+3];
+        byte opcode = (0b11111111000000000000000000000000 & instruction) >> 24;
+
+        Trace::instruction (memory, currentInstructionAddress);
+
+
+        // LUI dest, imm        - loads upper immediate 16 bits into given register
+        // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
+        if (opcode == OPCODE_LUI)
+        {
+            byte dest = (0b00000000111100000000000000000000 & instruction) >> 20;
+            // imm acts as the upper 16 bits of the register 
+            // (the first 2 bytes of the register in memory order)
+            registers[dest] = (registers[dest] & 0xffff0000) | *(uint16_t*)&memory[currentInstructionAddress+2]; 
+        }
+        // LLI dest, imm        - loads lower immediate 16 bits into given register
+        // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
+        else if (opcode == OPCODE_LLI)
+        {
+            byte dest = (0b00000000111100000000000000000000 & instruction) >> 20;
+            // imm acts as the lower 16 bits of the register 
+            // (the last 2 bytes of the register in memory order)
+            registers[dest] = (registers[dest] & 0x0000ffff) | (*(uint16_t*)&memory[currentInstructionAddress+2] << 16); 
+        }
+        // LB dest, offset(src) - load byte 
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        // offset should be specified in little endian (least -> most significant byte)
+        else if (opcode == OPCODE_LB)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[src1];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // read in byte 
+            registers[dest] = (unsigned int)memory[address+offset];
+        }
+        // LH dest, offset(src) - load half (2 bytes)
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        else if (opcode == OPCODE_LH)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[src1];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // read in half word (2 bytes) 
+            registers[dest] = (unsigned int)*(short*)&memory[address+offset];
+        }
+        // LW dest, offset(src) - load word (4 bytes)
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        else if (opcode == OPCODE_LW)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[src1];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // read in word (4 bytes) 
+            registers[dest] = (unsigned int)*(int*)&memory[address+offset];
+        }
+        // SB offset(dest), src - store byte
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        else if (opcode == OPCODE_SB)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[dest];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // store byte 
+            *(byte*)&(memory[address+offset]) = (byte)registers[src1];
+            // the threaded engine has to decode the program again 
+            if ((unsigned int)(address+offset) < state.codeSize) programWritten (state); 
+        }
+        // SH offset(dest), src - store half (2 bytes)
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        else if (opcode == OPCODE_SH)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[dest];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // store half word (2 bytes)
+            *(int16_t*)&(memory[address+offset]) = (int16_t)registers[src1];
+            // the threaded engine has to decode the program again 
+            if ((unsigned int)(address+offset) < state.codeSize) programWritten (state); 
+        }
+        // SW offset(dest), src - store word (4 bytes)
+        // XXXXXXXX ddddssss oooooooo oooooooo
+        else if (opcode == OPCODE_SW)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int address = registers[dest];
+            // read offset in little endian
+            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
+            ACCESS();
+            // store half word (2 bytes)
+            *(int*)&(memory[address+offset]) = registers[src1];
+            // the threaded engine has to decode the program again 
+            if ((unsigned int)(address+offset) < state.codeSize) programWritten (state); 
+        }
+
+        // arithmetic instructions
+        // ADD dest, src1, src2 - integer addition
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_ADD)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] + registers[src2];
+        }
+        // SUB dest, src1, src2 - integer subtraction
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_SUB)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] - registers[src2];
+        }
+        // MUL dest, src1, src2 - integer multiplication
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_MUL)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] * registers[src2];
+        }
+        // DIV dest, src1, src2 - integer division
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_DIV)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] / registers[src2];
+        }
+        // MOD dest, src1, src2 - integer division remainder
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_MOD)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] % registers[src2];
+        }
+        // SLL dest, src1, src2 - shift left logical
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_SLL)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] << registers[src2];
+        }
+        // SRL dest, src1, src2 - shift right logical
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_SRL)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = (unsigned int)registers[src1] >> (unsigned int)registers[src2];
+        }
+        // SRA dest, src1, src2 - shift right arithmetic
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_SRA)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] >> registers[src2];
+        }
+        // OR  dest, src1, src2 - bitwise or
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_OR)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] | registers[src2];
+        }
+        // AND dest, src1, src2 - bitwise and
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_AND)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] & registers[src2];
+        }
+        // XOR dest, src1, src2 - bitwise xor 
+        // XXXXXXXX ddddssss ssss0000 00000000
+        else if (opcode == OPCODE_XOR)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] ^ registers[src2];
+        }
+
+        // immediate arithmetic instructions
+        // immediate values are 14-bit signed
+        // ADDI dest, src1, imm - integer addition with immediate
+        // - can be used to load immediate into register 
+        // - that's why there is no load immediate 
+        // - ADDI r0, rzero, 42 : r0 <- 0 + 42
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_ADDI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] + imm;
+        }
+        // SUBI dest, src1, imm - integer subtraction with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_SUBI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] - imm;
+        }
+        // MULI dest, src1, src2 - integer multiplication with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_MULI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] * imm;
+        }
+        // DIVI dest, src1, src2 - integer division with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_DIVI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] / imm;
+        }
+        // MODI dest, src1, src2 - integer division remainder with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_MODI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] % imm;
+        }
+        // SLLI dest, src1, imm - shift left logical with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_SLLI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] << imm;
+        }
+        // SRLI dest, src1, imm - shift right logical with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_SRLI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            unsigned int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = (unsigned int)registers[src1] >> imm;
+        }
+        // SRAI dest, src1, imm - shift right arithmetic with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_SRAI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] >> imm;
+        }
+        // ORI  dest, src1, imm - bitwise or with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_ORI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] | imm;
+        }
+        // ANDI dest, src1, imm - bitwise and with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_ANDI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] & imm;
+        }
+        // XORI dest, src1, imm - bitwise xor  with immediate
+        // XXXXXXXX ddddssss ssssiiii iiiiiiii
+        else if (opcode == OPCODE_XORI)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
+            // read in word (4 bytes) 
+            registers[dest] = registers[src1] ^ imm;
+        }
+
+        // branching
+        // BEQ src1, src2, addr - if src1 == src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BEQ)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] == registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // BNE src1, src2, addr - if src1 != src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BNE)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] != registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // BLT src1, src2, addr - if src1 <  src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BLT)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] < registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // BLE src1, src2, addr - if src1 <= src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BLE)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] <= registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // BGT src1, src2, addr - if src1 >  src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BGT)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] > registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // BGE src1, src2, addr - if src1 >= src2 then pc <- addr
+        // XXXXXXXX ssssssss aaaa0000 00000000
+        else if (opcode == OPCODE_BGE)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
+            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
+            if (registers[src1] >= registers[src2])
+                currentInstructionAddress = (registers[addr])-4;
+        }
+        // JMP addr - pc <- addr
+        // XXXXXXXX aaaa0000 00000000 00000000
+        else if (opcode == OPCODE_JMP)
+        {
+            byte addr   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            currentInstructionAddress = (registers[addr])-4;
+        }
+
+        // function instructions 
+        // CALL addr
+        // 1. pushes return address on to the stack
+        // 2. changes pc to addr
+        // base pointer should be pushed on the stack by the callee
+        // push bp
+        // mov bp, sp
+        // Caller's actions
+        // 1. push caller saved registers
+        // 2. push args in reverse order
+        // 3. call function
+        // Call's actions
+        // 1. push return addr
+        // 2. pc <- addr 
+        // Callee's actions 
+        // 1. push caller's bp 
+        // 2. align our frame's bp and sp (mov bp, sp)
+        // 3. allocate space for local vars (sub sp, sp, <#bytes>)
+        //    local vars can be access with bp - 0, bp - 4, bp - 8, etc
+        // 4. push callee saved registers onto stack 
+        //    these need to be restored because caller 
+        //    expects these values to be unchanged. 
+        // XXXXXXXX aaaa0000 00000000 00000000
+        else if (opcode == OPCODE_CALL)
+        {
+            byte addr   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            // push return address onto stack 
+            registers[sp] -= 4; // stack grows towards 0
+            ACCESS();
+            *(unsigned int*)&memory[registers[sp]] = currentInstructionAddress;
+            if ((unsigned int)registers[sp] < state.codeSize) programWritten (state); 
+            // change program counter to addr 
+            currentInstructionAddress = (registers[addr])-4;
+        }
+        // RET - pc <- [bp]
+        // changes the current pc to the return address pointed to by bp
+        // Callee's actions before returning
+        // 1. store any return value in ra (return value register)
+        // 2. restore callee-saved registers 
+        // 3. pop local vars off of stack (mov sp, bp) (sp <- bp)
+        // 4. restore caller's bp (pop bp)
+        // Return's actions 
+        // 1. pops return address off of stack and stores in pc (pop pc) 
+        // Caller's actions after returning 
+        // 1. pop any arguments that were pushed onto the stack (add sp, sp, <#bytes>)
+        // 2. pop any caller saved registers back into their respective registers (pop r#)
+        // XXXXXXXX 00000000 00000000 00000000
+        else if (opcode == OPCODE_RET)
+        {
+            ACCESS();
+            // pop return address from stack into 
+            currentInstructionAddress = *(unsigned int*)&memory[registers[sp]];
+            registers[sp] += 4; // stack shrinks towards MEM_SIZE
+        }
+        // PUSH src - sp -= 4 ; [sp] <- src
+        // 1. decrements sp by 4 (bytes)
+        // 2. places src onto stack at [sp]
+        // XXXXXXXX ssss0000 00000000 00000000
+        else if (opcode == OPCODE_PUSH)
+        {
+            byte src    = (0b00000000111100000000000000000000 & instruction) >> 20;
+            registers[sp] -= 4; // stack grows towards 0
+            ACCESS();
+            *(int*)&memory[registers[sp]] = registers[src];
+            // the stack can grow down into the program too 
+            if ((unsigned int)registers[sp] < state.codeSize) programWritten (state); 
+        }
+        // POP dest - dest <- [sp] ; sp += 4
+        // 1. moves [sp] into dest 
+        // 2. increments sp by 4 (bytes)
+        // XXXXXXXX dddd0000 00000000 00000000
+        else if (opcode == OPCODE_POP)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            ACCESS();
+            registers[dest] = *(int*)&memory[registers[sp]]; 
+            registers[sp] += 4; // stack shrinks towards MEM_SIZE
+        }
+
+        // NOP - no operation
+        // XXXXXXXX 000000000 00000000 00000000
+        else if (opcode == OPCODE_NOP)
+        {
+            
+        }
+        // other instructions
+        // HLT - halts the computer
+        // XXXXXXXX 000000000 00000000 00000000
+        else if (opcode == OPCODE_HLT)
+        {
+            state.halted = true; 
+            result = RUN_HALTED; 
+            break; 
+        }
+        // GETCHAR - reads (from the queued input) a char (1-byte) and stores it in the 
+        // given register
+        // XXXXXXXX dddd00000 00000000 00000000
+        else if (opcode == OPCODE_GETCHAR)
+        {
+            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            // wait for more input without executing the GETCHAR 
+            if (state.inputPosition == state.inputSize && !state.inputClosed)
+            {
+                result = RUN_WAITING_FOR_INPUT; 
+                break; 
+            }
+            registers[dest] = readInput (state);
+        }
+        // PUTCHAR - outputs (to stdout) a char (1-byte) from the given register
+        // XXXXXXXX ssss00000 00000000 00000000
+        else if (opcode == OPCODE_PUTCHAR)
+        {
+            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
+            Trace::outputBegin ();
+            putchar(registers[src1]);
+            Trace::outputEnd ();
+        }
+        // unknown instruction
+        else
+        {
+            printf ("Invalid opcode %x%x\n", 
+                (0b11110000 & opcode) >> 4,
+                (0b00001111 & opcode) >> 0
+            );
+            state.halted = true; 
+            result = RUN_HALTED; 
+            break; 
+        }
+
+
+
+
+        // go to next instruction 
+        // each instruction is 4 bytes; 
+        currentInstructionAddress += 4; 
+
+        // print register file
+        Trace::registers (registers);
+    }
+
+    state.currentInstructionAddress = currentInstructionAddress; 
+    state.instructionsRetired += executed; 
+    return result; 
+}
+
+#undef ACCESS
+
+template <typename Trace>
+RunResult 
+runReference (MachineState& state, uint64_t maxInstructions)
+{
+    FaultScope fault; 
+    if (sigsetjmp (fault.resume, 0) != 0)
+        return stopAtFault (state, fault.address, fault.pc, fault.retired);
+    return executeReference<Trace> (state, maxInstructions, fault);
+}
+
+// for the JIT, which hands the reference engine what it does not translate 
+RunResult 
+runReferenceUntraced (MachineState& state, uint64_t maxInstructions)
+{
+    return runReference<NoTrace> (state, maxInstructions);
+}
+
+//========================================================================
+// Switch engine 
+// decodes one instruction at a time like the reference engine, but 
+// pulls every field out up front and dispatches with a single switch 
+// (usually a jump table) instead of walking an if/else chain 
+
+template <typename Trace>
+static RunResult 
+executeSwitch (MachineState& state, uint64_t maxInstructions, FaultScope& fault)
+{
+    byte* memory = state.memory; 
+    int32_t* registers = state.registers; 
+    unsigned int pc = state.currentInstructionAddress;
+    RunResult result = RUN_BUDGET_EXHAUSTED; 
+    uint64_t executed = 0; 
+
+// publishes the instruction before a load/store that may fault 
+#define ACCESS()                                                            \
+    do {                                                                    \
+        fault.pc = pc;                                                      \
+        fault.retired = executed;                                           \
+        PUBLISHED();                                                        \
+    } while (0)
+
+    for (; executed < maxInstructions; ++executed)
+    {
+        // ran off the end of memory 
+        if (pc >= state.memorySize)
+        {
+            state.halted = true; 
+            result = RUN_HALTED; 
+            break; 
+        }
+        // the last word of memory may reach past its end - the reference 
+        // engine stops there if it does 
+        if ((size_t)pc + 4 > state.memorySize)
+        {
+            state.currentInstructionAddress = pc; 
+            state.instructionsRetired += executed; 
+            return runReference<Trace> (state, maxInstructions - executed);
+        }
+
+        Trace::instruction (memory, pc);
+
+        unsigned int instruction = fetchInstruction (memory, pc);
+        byte opcode = (0b11111111000000000000000000000000 & instruction) >> 24;
+        byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+        byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
+        byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+        // immediates/offsets are stored in little endian 
+        int  imm    = *(int16_t*)&memory[pc+2];
+        // where the next instruction is 
+        unsigned int next = pc + 4; 
+
+        switch (opcode)
+        {
+            // memory instructions 
+            case OPCODE_LUI: registers[dest] = (registers[dest] & 0xffff0000) | (uint16_t)imm; break; 
+            case OPCODE_LLI: registers[dest] = (registers[dest] & 0x0000ffff) | ((uint32_t)imm << 16); break; 
+            case OPCODE_LB:  ACCESS(); registers[dest] = (unsigned int)memory[registers[src1] + imm]; break; 
+            case OPCODE_LH:  ACCESS(); registers[dest] = (unsigned int)*(short*)&memory[registers[src1] + imm]; break; 
+            case OPCODE_LW:  ACCESS(); registers[dest] = (unsigned int)*(int*)&memory[registers[src1] + imm]; break; 
+            case OPCODE_SB:  
+                ACCESS();
+                *(byte*)&memory[registers[dest] + imm] = (byte)registers[src1];
+                // the threaded engine has to decode the program again 
+                if ((unsigned int)(registers[dest] + imm) < state.codeSize) programWritten (state); 
+                break; 
+            case OPCODE_SH:  
+                ACCESS();
+                *(int16_t*)&memory[registers[dest] + imm] = (int16_t)registers[src1];
+                if ((unsigned int)(registers[dest] + imm) < state.codeSize) programWritten (state); 
+                break; 
+            case OPCODE_SW:  
+                ACCESS();
+                *(int*)&memory[registers[dest] + imm] = registers[src1];
+                if ((unsigned int)(registers[dest] + imm) < state.codeSize) programWritten (state); 
+                break; 
+
+            // arithmetic instructions - computed as the instruction set describes them 
+            case OPCODE_ADD: registers[dest] = instructionSet[OPCODE_ADD].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_SUB: registers[dest] = instructionSet[OPCODE_SUB].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_MUL: registers[dest] = instructionSet[OPCODE_MUL].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_DIV: registers[dest] = instructionSet[OPCODE_DIV].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_MOD: registers[dest] = instructionSet[OPCODE_MOD].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_SLL: registers[dest] = instructionSet[OPCODE_SLL].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_SRL: registers[dest] = instructionSet[OPCODE_SRL].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_SRA: registers[dest] = instructionSet[OPCODE_SRA].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_OR:  registers[dest] = instructionSet[OPCODE_OR].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_AND: registers[dest] = instructionSet[OPCODE_AND].compute (registers[src1], registers[src2]); break; 
+            case OPCODE_XOR: registers[dest] = instructionSet[OPCODE_XOR].compute (registers[src1], registers[src2]); break; 
+
+            // immediate arithmetic instructions
+            case OPCODE_ADDI: registers[dest] = instructionSet[OPCODE_ADDI].compute (registers[src1], imm); break; 
+            case OPCODE_SUBI: registers[dest] = instructionSet[OPCODE_SUBI].compute (registers[src1], imm); break; 
+            case OPCODE_MULI: registers[dest] = instructionSet[OPCODE_MULI].compute (registers[src1], imm); break; 
+            case OPCODE_DIVI: registers[dest] = instructionSet[OPCODE_DIVI].compute (registers[src1], imm); break; 
+            case OPCODE_MODI: registers[dest] = instructionSet[OPCODE_MODI].compute (registers[src1], imm); break; 
+            case OPCODE_SLLI: registers[dest] = instructionSet[OPCODE_SLLI].compute (registers[src1], imm); break; 
+            case OPCODE_SRLI: registers[dest] = instructionSet[OPCODE_SRLI].compute (registers[src1], imm); break; 
+            case OPCODE_SRAI: registers[dest] = instructionSet[OPCODE_SRAI].compute (registers[src1], imm); break; 
+            case OPCODE_ORI:  registers[dest] = instructionSet[OPCODE_ORI].compute (registers[src1], imm); break; 
+            case OPCODE_ANDI: registers[dest] = instructionSet[OPCODE_ANDI].compute (registers[src1], imm); break; 
+            case OPCODE_XORI: registers[dest] = instructionSet[OPCODE_XORI].compute (registers[src1], imm); break; 
+
+            // branching - ssssssss aaaa0000 
+            case OPCODE_BEQ: if (registers[dest] == registers[src1]) next = registers[src2]; break; 
+            case OPCODE_BNE: if (registers[dest] != registers[src1]) next = registers[src2]; break; 
+            case OPCODE_BLT: if (registers[dest] <  registers[src1]) next = registers[src2]; break; 
+            case OPCODE_BLE: if (registers[dest] <= registers[src1]) next = registers[src2]; break; 
+            case OPCODE_BGT: if (registers[dest] >  registers[src1]) next = registers[src2]; break; 
+            case OPCODE_BGE: if (registers[dest] >= registers[src1]) next = registers[src2]; break; 
+            case OPCODE_JMP: next = registers[dest]; break; 
+
+            // function instructions 
+            case OPCODE_CALL:
+                ACCESS();
+                registers[sp] -= 4; // stack grows towards 0
+                *(unsigned int*)&memory[registers[sp]] = pc;
+                if ((unsigned int)registers[sp] < state.codeSize) programWritten (state); 
+                next = registers[dest]; 
+                break; 
+            // the return address is the CALL itself, so move past it 
+            case OPCODE_RET:
+                ACCESS();
+                next = *(unsigned int*)&memory[registers[sp]] + 4;
+                registers[sp] += 4; // stack shrinks towards MEM_SIZE
+                break; 
+            case OPCODE_PUSH:
+                ACCESS();
+                registers[sp] -= 4; // stack grows towards 0
+                *(int*)&memory[registers[sp]] = registers[dest];
+                if ((unsigned int)registers[sp] < state.codeSize) programWritten (state); 
+                break; 
+            case OPCODE_POP:
+                ACCESS();
+                registers[dest] = *(int*)&memory[registers[sp]]; 
+                registers[sp] += 4; // stack shrinks towards MEM_SIZE
+                break; 
+
+            // other instructions
+            case OPCODE_NOP: break; 
+            case OPCODE_HLT:
+                state.halted = true; 
+                result = RUN_HALTED; 
+                break; 
+            case OPCODE_GETCHAR:
+                // wait for more input without executing the GETCHAR 
+                if (state.inputPosition == state.inputSize && !state.inputClosed)
+                {
+                    result = RUN_WAITING_FOR_INPUT; 
+                    break; 
+                }
+                registers[dest] = readInput (state);
+                break; 
+            case OPCODE_PUTCHAR:
+                Trace::outputBegin ();
+                putchar(registers[dest]);
+                Trace::outputEnd ();
+                break; 
+            default:
+                printf ("Invalid opcode %x%x\n", 
+                    (0b11110000 & opcode) >> 4,
+                    (0b00001111 & opcode) >> 0
+                );
+                state.halted = true; 
+                result = RUN_HALTED; 
+                break; 
+        }
+        // stopped on this instruction 
+        if (result != RUN_BUDGET_EXHAUSTED) break; 
+
+        pc = next; 
+        Trace::registers (registers);
+    }
+
+    state.currentInstructionAddress = pc; 
+    state.instructionsRetired += executed; 
+    return result; 
+#undef ACCESS
+}
+
+template <typename Trace>
+RunResult 
+runSwitch (MachineState& state, uint64_t maxInstructions)
+{
+    FaultScope fault; 
+    if (sigsetjmp (fault.resume, 0) != 0)
+        return stopAtFault (state, fault.address, fault.pc, fault.retired);
+    return executeSwitch<Trace> (state, maxInstructions, fault);
+}
+
+//========================================================================
+// Predecoded instructions 
+// the threaded engine decodes the program once into an array with one 
+// record per 4-byte instruction so the steady state never reassembles 
+// instruction words or pulls fields out with masks 
+
+// true for the instructions that end a straight-line run - 
+// anything that can change the pc or stop the machine 
+inline bool 
+endsRun (byte opcode)
+{
+    return hasFlag (opcode, ISA_CONTROL | ISA_HALTS | ISA_INPUT); 
+}
+
+// decodes the instruction at address into out as a run of 1 instruction 
+// handlers maps each defined opcode to its handler label 
+void 
+decodeInstruction (byte* memory, unsigned int address, void* const* handlers, DecodedInstruction* out)
+{
+    unsigned int instruction = fetchInstruction (memory, address);
+    byte opcode  = (0b11111111000000000000000000000000 & instruction) >> 24;
+    out->handler = handlers[opcode < NUM_OPCODES ? opcode : (byte)OPCODE_UNDEFINED];
+    out->dest    = (0b00000000111100000000000000000000 & instruction) >> 20;
+    out->src1    = (0b00000000000011110000000000000000 & instruction) >> 16;
+    out->src2    = (0b00000000000000001111000000000000 & instruction) >> 12;
+    // immediates/offsets are stored in little endian 
+    out->imm     = *(int16_t*)&memory[address+2];
+    out->runLength = 1; 
+}
+
+// Bulk decoding 
+// decodes count whole instructions starting at record first into 
+// out[first..], as runs of 1 instruction. used to decode whole 
+// programs at once - on x86-64 the fields of 8 (AVX2) or 4 (SSE2) 
+// instructions are pulled out at a time. an instruction word loaded 
+// little endian has the opcode in its low byte, so no byte swap is 
+// needed:
+//      bits  0..7   opcode 
+//      bits  8..11  src1 
+//      bits 12..15  dest 
+//      bits 20..23  src2 
+//      bits 16..31  imm 
+
+#if defined(__x86_64__)
+
+// a record past its handler is dest, src1, src2, shift, imm, runLength 
+// and reciprocal - the lanes below build those 16 bytes (shift and 
+// reciprocal are 0 until a record is fused) and store them with one 
+// 16 byte store per record 
+static_assert (offsetof(DecodedInstruction, dest) == 8 && offsetof(DecodedInstruction, src1) == 9 
+    && offsetof(DecodedInstruction, src2) == 10 && offsetof(DecodedInstruction, imm) == 12 
+    && offsetof(DecodedInstruction, runLength) == 16 && offsetof(DecodedInstruction, reciprocal) == 20 
+    && sizeof(DecodedInstruction) == 24,
+    "bulk decoding expects the DecodedInstruction layout");
+
+__attribute__((target("avx2"))) 
+unsigned int 
+decodeBulkAVX2 (byte* memory, unsigned int first, unsigned int count, void* const* handlers, DecodedInstruction* out)
+{
+    const __m256i byteMask   = _mm256_set1_epi32 (0xff);
+    const __m256i nibbleMask = _mm256_set1_epi32 (0xf);
+    const __m256i numOpcodes = _mm256_set1_epi32 (NUM_OPCODES);
+    // runLength 1 and the padding after it 
+    const __m256i tail       = _mm256_set_epi32 (0, 1, 0, 1, 0, 1, 0, 1);
+    alignas(32) int32_t opcodes[8]; 
+    unsigned int i = first; 
+    for (; i + 8 <= first + count; i += 8)
+    {
+        __m256i words  = _mm256_loadu_si256 ((const __m256i*)&memory[i*4]);
+        __m256i opcode = _mm256_and_si256 (words, byteMask);
+        // opcodes past the end of the table are invalid (OPCODE_UNDEFINED)
+        opcode = _mm256_and_si256 (opcode, _mm256_cmpgt_epi32 (numOpcodes, opcode));
+        _mm256_store_si256 ((__m256i*)opcodes, opcode);
+        // dest | src1 << 8 | src2 << 16 
+        __m256i registerFields = _mm256_or_si256 (_mm256_or_si256 (
+            _mm256_and_si256 (_mm256_srli_epi32 (words, 12), nibbleMask),
+            _mm256_and_si256 (words, _mm256_set1_epi32 (0x0f00))),
+            _mm256_and_si256 (_mm256_srli_epi32 (words, 4), _mm256_set1_epi32 (0x0f0000)));
+        __m256i imm = _mm256_srai_epi32 (words, 16);
+        // transpose into {fields, imm, 1, 0} for each record 
+        // (256 bit unpacks work on each 128 bit half, so the high half 
+        // holds records 4..7)
+        __m256i low  = _mm256_unpacklo_epi32 (registerFields, imm);
+        __m256i high = _mm256_unpackhi_epi32 (registerFields, imm);
+        __m256i records[4] = {
+            _mm256_unpacklo_epi64 (low, tail),  _mm256_unpackhi_epi64 (low, tail),
+            _mm256_unpacklo_epi64 (high, tail), _mm256_unpackhi_epi64 (high, tail)
+        };
+        for (int k = 0; k < 4; ++k)
+        {
+            _mm_storeu_si128 ((__m128i*)&out[i+k].dest,   _mm256_castsi256_si128 (records[k]));
+            _mm_storeu_si128 ((__m128i*)&out[i+k+4].dest, _mm256_extracti128_si256 (records[k], 1));
+        }
+        for (int k = 0; k < 8; ++k)
+            out[i+k].handler = handlers[opcodes[k]];
+    }
+    return i; 
+}
+
+unsigned int 
+decodeBulkSSE2 (byte* memory, unsigned int first, unsigned int count, void* const* handlers, DecodedInstruction* out)
+{
+    const __m128i byteMask   = _mm_set1_epi32 (0xff);
+    const __m128i nibbleMask = _mm_set1_epi32 (0xf);
+    const __m128i numOpcodes = _mm_set1_epi32 (NUM_OPCODES);
+    // runLength 1 and the padding after it 
+    const __m128i tail       = _mm_set_epi32 (0, 1, 0, 1);
+    alignas(16) int32_t opcodes[4]; 
+    unsigned int i = first; 
+    for (; i + 4 <= first + count; i += 4)
+    {
+        __m128i words  = _mm_loadu_si128 ((const __m128i*)&memory[i*4]);
+        __m128i opcode = _mm_and_si128 (words, byteMask);
+        // opcodes past the end of the table are invalid (OPCODE_UNDEFINED)
+        opcode = _mm_and_si128 (opcode, _mm_cmpgt_epi32 (numOpcodes, opcode));
+        _mm_store_si128 ((__m128i*)opcodes, opcode);
+        // dest | src1 << 8 | src2 << 16 
+        __m128i registerFields = _mm_or_si128 (_mm_or_si128 (
+            _mm_and_si128 (_mm_srli_epi32 (words, 12), nibbleMask),
+            _mm_and_si128 (words, _mm_set1_epi32 (0x0f00))),
+            _mm_and_si128 (_mm_srli_epi32 (words, 4), _mm_set1_epi32 (0x0f0000)));
+        __m128i imm = _mm_srai_epi32 (words, 16);
+        // transpose into {fields, imm, 1, 0} for each record 
+        __m128i low  = _mm_unpacklo_epi32 (registerFields, imm);
+        __m128i high = _mm_unpackhi_epi32 (registerFields, imm);
+        _mm_storeu_si128 ((__m128i*)&out[i+0].dest, _mm_unpacklo_epi64 (low, tail));
+        _mm_storeu_si128 ((__m128i*)&out[i+1].dest, _mm_unpackhi_epi64 (low, tail));
+        _mm_storeu_si128 ((__m128i*)&out[i+2].dest, _mm_unpacklo_epi64 (high, tail));
+        _mm_storeu_si128 ((__m128i*)&out[i+3].dest, _mm_unpackhi_epi64 (high, tail));
+        for (int k = 0; k < 4; ++k)
+            out[i+k].handler = handlers[opcodes[k]];
+    }
+    return i; 
+}
+
+#endif
+
+void 
+decodeBulk (byte* memory, unsigned int first, unsigned int count, void* const* handlers, DecodedInstruction* out)
+{
+    unsigned int i = first; 
+#if defined(__x86_64__)
+    static const bool hasAVX2 = __builtin_cpu_supports ("avx2");
+    if (hasAVX2) i = decodeBulkAVX2 (memory, i, first + count - i, handlers, out);
+    i = decodeBulkSSE2 (memory, i, first + count - i, handlers, out);
+#endif
+    // the rest one at a time 
+    for (; i < first + count; ++i)
+        decodeInstruction (memory, i*4, handlers, &out[i]);
+}
+
+// recomputes the run lengths of the program's records after records 
+// first..last changed - last and everything before it back to the 
+// start of the run containing first 
+void 
+updateRunLengths (MachineState& state, unsigned int first, unsigned int last)
+{
+    unsigned int numRecords = state.codeSize / 4; 
+    for (unsigned int i = last + 1; i-- > 0; )
+    {
+        bool ends = endsRun (state.memory[i*4]); 
+        // earlier runs are unaffected 
+        if (i < first && ends) break; 
+        state.code[i].runLength = (ends || i + 1 == numRecords) ? 1 : 1 + state.code[i+1].runLength; 
+    }
+}
+
+//========================================================================
+// Verifier 
+// walks every instruction reachable from address 0 before the program 
+// runs. branch/jump/call targets are followed when they are built with 
+// a LUI r ; LLI r pair right before the branch, which is how every 
+// target in the programs we assemble is built. targets in registers 
+// that were loaded or computed cannot be followed 
+
+// the constant a LUI r ; LLI r pair right before address leaves in r, 
+// if there is one 
+inline bool 
+constantBefore (byte* memory, unsigned int address, byte r, uint32_t* value)
+{
+    if (address < 8) return false; 
+    unsigned int lui = fetchInstruction (memory, address - 8);
+    unsigned int lli = fetchInstruction (memory, address - 4);
+    if ((lui >> 24) != OPCODE_LUI || (lli >> 24) != OPCODE_LLI) return false; 
+    if (((lui >> 20) & 0xf) != r || ((lli >> 20) & 0xf) != r) return false; 
+    *value = *(uint16_t*)&memory[address - 6] | ((uint32_t)*(uint16_t*)&memory[address - 2] << 16); 
+    return true; 
+}
+
+// true if the instruction can change register r 
+inline bool 
+writesRegister (byte opcode, byte dest, byte r)
+{
+    if (hasFlag (opcode, ISA_WRITES_SP) && r == sp) return true; 
+    return hasFlag (opcode, ISA_WRITES_DEST) && dest == r; 
+}
+
+// the constant r holds at address if it was last written by a LUI r ; 
+// LLI r pair earlier in the same straight-line run 
+inline bool 
+constantInRun (byte* memory, unsigned int address, byte r, uint32_t* value)
+{
+    for (unsigned int at = address; at >= 4; at -= 4)
+    {
+        byte opcode = memory[at - 4]; 
+        byte dest   = memory[at - 3] >> 4; 
+        if (opcode == OPCODE_LLI && dest == r) 
+            return constantBefore (memory, at, r, value); 
+        if (endsRun (opcode) || writesRegister (opcode, dest, r)) return false; 
+    }
+    return false; 
+}
+
+// returns true if the program has no problems 
+bool 
+verifyProgram (MachineState& state, bool verbose)
+{
+    byte* memory = state.memory; 
+    unsigned int codeSize = state.codeSize; 
+    unsigned int numRecords = codeSize / 4; 
+    bool ok = true; 
+
+    // instructions already queued 
+    byte* seen = (byte*) calloc (numRecords + 1, 1);
+    // addresses still to check, with the instruction that leads to each 
+    uint32_t* pending = (uint32_t*) malloc ((2 * numRecords + 2) * sizeof(uint32_t));
+    size_t numPending = 0; 
+    pending[numPending++] = 0x00; 
+    pending[numPending++] = 0x00; 
+
+    while (numPending > 0)
+    {
+        unsigned int from    = pending[--numPending]; 
+        unsigned int address = pending[--numPending]; 
+        if (address >= codeSize || address % 4 != 0)
+        {
+            printf ("Verifier: 0x%08x continues at 0x%08x, which is not an instruction of the program\n", from, address);
+            ok = false; 
+            continue; 
+        }
+        if (seen[address / 4]) continue; 
+        seen[address / 4] = true; 
+
+        unsigned int instruction = fetchInstruction (memory, address);
+        byte opcode = (0b11111111000000000000000000000000 & instruction) >> 24;
+        byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
+        byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
+        if (opcode == OPCODE_UNDEFINED || opcode >= NUM_OPCODES)
+        {
+            printf ("Verifier: 0x%08x has undefined opcode %02x\n", address, opcode);
+            ok = false; 
+            continue; 
+        }
+
+        // stores to a known address 
+        if (opcode == OPCODE_SB || opcode == OPCODE_SH || opcode == OPCODE_SW)
+        {
+            uint32_t base; 
+            if (constantInRun (memory, address, dest, &base) 
+                && base + *(int16_t*)&memory[address + 2] < codeSize)
+            {
+                printf ("Verifier: 0x%08x writes to the program at 0x%08x\n", address, 
+                    base + *(int16_t*)&memory[address + 2]);
+                ok = false; 
+            }
+        }
+
+        // where execution can go next 
+        // (RET returns past a CALL, which is queued with the CALL)
+        bool fallsThrough = opcode != OPCODE_JMP && opcode != OPCODE_RET && opcode != OPCODE_HLT; 
+        if (fallsThrough)
+        {
+            pending[numPending++] = address + 4; 
+            pending[numPending++] = address; 
+        }
+        if (hasFlag (opcode, ISA_CONTROL) && opcode != OPCODE_RET)
+        {
+            // branches keep their target in src2, jumps and calls in dest 
+            byte r = instructionInfo (opcode).format == FORMAT_BRANCH ? src2 : dest; 
+            uint32_t target; 
+            if (constantBefore (memory, address, r, &target))
+            {
+                pending[numPending++] = target; 
+                pending[numPending++] = address; 
+            }
+            else if (verbose)
+                printf ("Verifier: 0x%08x jumps through r%d, which is not a known constant\n", address, r);
+        }
+    }
+
+    free (seen);
+    free (pending);
+    return ok; 
+}
+
+//========================================================================
+// Superinstructions 
+// common sequences are executed by a single fused handler installed on 
+// the record of their first instruction. the other records of the 
+// sequence keep their own handlers, so jumping into the middle of a 
+// sequence still runs exactly the instructions after the target
+
+enum Superinstruction : byte 
+{
+    // LUI r, lo ; LLI r, hi - imm holds the whole constant 
+    FUSED_CONSTANT,
+    // LUI r, lo ; LLI r, hi ; Bxx a, b, r - imm holds the constant 
+    FUSED_CONSTANT_BEQ,
+    FUSED_CONSTANT_BNE,
+    FUSED_CONSTANT_BLT,
+    FUSED_CONSTANT_BLE,
+    FUSED_CONSTANT_BGT,
+    FUSED_CONSTANT_BGE,
+    // LUI r, lo ; LLI r, hi ; JMP r - imm holds the constant 
+    FUSED_CONSTANT_JMP,
+    // LUI r, lo ; LLI r, hi ; CALL r - imm holds the constant 
+    FUSED_CONSTANT_CALL,
+    // the same 8 for verified programs, where the constant is known to 
+    // be an instruction of the program - the branch goes straight to 
+    // its record 
+    FUSED_DIRECT_BEQ,
+    FUSED_DIRECT_BNE,
+    FUSED_DIRECT_BLT,
+    FUSED_DIRECT_BLE,
+    FUSED_DIRECT_BGT,
+    FUSED_DIRECT_BGE,
+    FUSED_DIRECT_JMP,
+    FUSED_DIRECT_CALL,
+    // ADD r, a, b ; LB d, offset(r) - indexed load 
+    FUSED_INDEXED_LOAD,
+    // PUSH a ; PUSH b ; ... - imm holds the number of PUSHes 
+    FUSED_PUSHES,
+    // POP a ; POP b ; ... - imm holds the number of POPs 
+    FUSED_POPS,
+    // DIVI/MODI by a constant (see divideByReciprocal) 
+    FUSED_DIVIDE,
+    FUSED_REMAINDER,
+    // DIVI q, a, k ; MODI r, a, k and MODI r, a, k ; DIVI q, a, k where 
+    // the first does not write a - one division for both 
+    FUSED_DIVIDE_REMAINDER,
+    FUSED_REMAINDER_DIVIDE,
+    // PUSH bp ; ADDI bp, sp, 0 ; SUBI sp, sp, n - a function's prologue 
+    // (imm holds n, or 0 when there is no SUBI). the PUSHes of the saved 
+    // registers after it are a run of their own 
+    FUSED_ENTER,
+    // ADDI sp, bp, 0 ; POP bp ; RET - a function's epilogue (imm holds 
+    // the number of records before the RET - 1 when it starts at the POP). 
+    // the POPs of the saved registers before it are a run of their own 
+    FUSED_LEAVE,
+    NUM_SUPERINSTRUCTIONS
+};
+
+// Division by constants 
+// DIVI/MODI by a constant multiply by a reciprocal of the divisor kept 
+// in the record instead of dividing. for |n| <= 2^31 and 
+// 2 <= |k| <= 2^15 (every 16-bit immediate but 0, 1 and -1) 
+//      |n| / |k| == (|n| * reciprocal) >> shift 
+// with shift = 31 + ceil(log2 |k|) and reciprocal = ceil(2^shift / |k|), 
+// which fits in 32 bits - so the product fits in 64 
+
+// true if DIVI/MODI by k can use a reciprocal 
+inline bool 
+hasReciprocal (int32_t k)
+{
+    return k < -1 || k > 1; 
+}
+
+// works out the reciprocal of the record's immediate 
+inline void 
+setReciprocal (DecodedInstruction& d)
+{
+    uint32_t magnitude = d.imm < 0 ? 0u - (uint32_t)d.imm : (uint32_t)d.imm; 
+    byte bits = 0; 
+    while ((1u << bits) < magnitude) ++bits; 
+    d.shift = 31 + bits; 
+    d.reciprocal = (uint32_t)(((1ull << d.shift) + magnitude - 1) / magnitude); 
+}
+
+// n / imm of the record, rounded towards 0 like DIVI 
+inline int32_t 
+divideByReciprocal (int32_t n, const DecodedInstruction& d)
+{
+    uint32_t magnitude = n < 0 ? 0u - (uint32_t)n : (uint32_t)n; 
+    uint32_t quotient = (uint32_t)(((uint64_t)magnitude * d.reciprocal) >> d.shift); 
+    return (n ^ d.imm) < 0 ? -(int32_t)quotient : (int32_t)quotient; 
+}
+
+// installs the superinstruction starting at record i, if there is one 
+// the records after i must already be decoded 
+inline void 
+fuseInstruction (MachineState& state, void* const* fused, unsigned int i)
+{
+    byte* memory = state.memory; 
+    DecodedInstruction* code = state.code; 
+    unsigned int numRecords = state.codeSize / 4; 
+    byte opcode = memory[i*4]; 
+
+    if (opcode == OPCODE_LUI && i + 1 < numRecords 
+        && memory[(i+1)*4] == OPCODE_LLI && code[i+1].dest == code[i].dest)
+    {
+        byte r = code[i].dest; 
+        code[i].imm = (int32_t)((uint32_t)(uint16_t)code[i].imm | ((uint32_t)code[i+1].imm << 16)); 
+        code[i].handler = fused[FUSED_CONSTANT];
+        if (i + 2 >= numRecords) return; 
+        byte next = memory[(i+2)*4]; 
+        DecodedInstruction* branch = &code[i+2]; 
+        // the verifier rejected reachable branches to anywhere else, 
+        // this also covers the ones it could not reach 
+        uint32_t target = code[i].imm; 
+        int kind = (state.verified && target < state.codeSize && target % 4 == 0) 
+            ? FUSED_DIRECT_BEQ : FUSED_CONSTANT_BEQ; 
+        if (next >= OPCODE_BEQ && next <= OPCODE_BGE && branch->src2 == r)
+            code[i].handler = fused[kind + (next - OPCODE_BEQ)];
+        else if (next == OPCODE_JMP && branch->dest == r)
+            code[i].handler = fused[kind + (OPCODE_JMP - OPCODE_BEQ)];
+        else if (next == OPCODE_CALL && branch->dest == r)
+            code[i].handler = fused[kind + (OPCODE_CALL - OPCODE_BEQ)];
+    }
+    else if (opcode == OPCODE_ADD && i + 1 < numRecords 
+        && memory[(i+1)*4] == OPCODE_LB && code[i+1].src1 == code[i].dest)
+    {
+        code[i].handler = fused[FUSED_INDEXED_LOAD];
+    }
+    else if ((opcode == OPCODE_PUSH || opcode == OPCODE_POP) && code[i].dest != sp 
+        && i + 1 < numRecords && memory[(i+1)*4] == opcode && code[i+1].dest != sp)
+    {
+        // the next instruction heads the rest of the run 
+        Superinstruction run = opcode == OPCODE_PUSH ? FUSED_PUSHES : FUSED_POPS; 
+        code[i].imm = code[i+1].handler == fused[run] ? code[i+1].imm + 1 : 2; 
+        code[i].handler = fused[run];
+    }
+    else if (opcode == OPCODE_PUSH && code[i].dest == bp && i + 1 < numRecords 
+        && memory[(i+1)*4] == OPCODE_ADDI && code[i+1].dest == bp && code[i+1].src1 == sp 
+        && code[i+1].imm == 0)
+    {
+        // only a SUBI that grows the frame is folded in 
+        bool frame = i + 2 < numRecords && memory[(i+2)*4] == OPCODE_SUBI 
+            && code[i+2].dest == sp && code[i+2].src1 == sp && code[i+2].imm > 0; 
+        code[i].imm = frame ? code[i+2].imm : 0; 
+        code[i].handler = fused[FUSED_ENTER];
+    }
+    else if (opcode == OPCODE_POP && code[i].dest == bp 
+        && i + 1 < numRecords && memory[(i+1)*4] == OPCODE_RET)
+    {
+        code[i].imm = 1; 
+        code[i].handler = fused[FUSED_LEAVE];
+    }
+    else if (opcode == OPCODE_ADDI && code[i].dest == sp && code[i].src1 == bp && code[i].imm == 0 
+        && i + 1 < numRecords && memory[(i+1)*4] == OPCODE_POP && code[i+1].handler == fused[FUSED_LEAVE])
+    {
+        code[i].imm = 2; 
+        code[i].handler = fused[FUSED_LEAVE];
+    }
+    else if ((opcode == OPCODE_DIVI || opcode == OPCODE_MODI) && hasReciprocal (code[i].imm))
+    {
+        setReciprocal (code[i]);
+        byte other = opcode == OPCODE_DIVI ? OPCODE_MODI : OPCODE_DIVI; 
+        bool pair = i + 1 < numRecords && memory[(i+1)*4] == other 
+            && code[i+1].src1 == code[i].src1 && code[i+1].imm == code[i].imm 
+            && code[i].dest != code[i].src1; 
+        if (opcode == OPCODE_DIVI)
+            code[i].handler = fused[pair ? FUSED_DIVIDE_REMAINDER : FUSED_DIVIDE];
+        else 
+            code[i].handler = fused[pair ? FUSED_REMAINDER_DIVIDE : FUSED_REMAINDER];
+    }
+}
+
+// decodes (and fuses) records first..last again, along with the earlier 
+// records whose superinstructions could reach into them 
+// fused is null when superinstructions are not wanted 
+void 
+decodeRecords (MachineState& state, void* const* handlers, void* const* fused, unsigned int first, unsigned int last)
+{
+    unsigned int lowest = last + 1; 
+    while (lowest > 0)
+    {
+        // superinstructions span at most 3 records, except PUSH/POP runs 
+        unsigned int i = lowest - 1; 
+        byte opcode = state.memory[i*4]; 
+        if (i + 2 < first && opcode != OPCODE_PUSH && opcode != OPCODE_POP) break; 
+        decodeInstruction (state.memory, i*4, handlers, &state.code[i]);
+        if (fused != nullptr) 
+            fuseInstruction (state, fused, i);
+        lowest = i; 
+    }
+    updateRunLengths (state, lowest, last);
+}
+
+// saves the decoded program to the cache - handlers are stored as their 
+// opcode or superinstruction since their addresses change from run to run 
+void 
+saveDecodedProgram (MachineState& state, ProgramCache* cache, void* const* handlers, void* const* fused)
+{
+    unsigned int numRecords = state.codeSize / 4; 
+    CachedRecord* records = (CachedRecord*) malloc ((numRecords + 1) * sizeof(CachedRecord));
+    for (unsigned int i = 0; i < numRecords; ++i)
+    {
+        const DecodedInstruction& d = state.code[i]; 
+        // a record is either fused or keeps the handler of its opcode 
+        byte kind = state.memory[i*4] < NUM_OPCODES ? state.memory[i*4] : (byte)OPCODE_UNDEFINED; 
+        if (fused != nullptr && d.handler != handlers[kind])
+            for (int f = 0; f < NUM_SUPERINSTRUCTIONS; ++f)
+                if (d.handler == fused[f]) kind = NUM_OPCODES + f; 
+        records[i] = { kind, d.dest, d.src1, d.src2, d.imm, d.runLength }; 
+    }
+    saveRecords (cache, records, numRecords, state.verified, fused != nullptr);
+    free (records);
+}
+
+// a record decoded from its cached form 
+inline void 
+restoreRecord (const CachedRecord& record, void* const* handlers, void* const* fused, DecodedInstruction* out)
+{
+    out->handler = record.kind < NUM_OPCODES ? handlers[record.kind] : fused[record.kind - NUM_OPCODES]; 
+    out->dest = record.dest; 
+    out->src1 = record.src1; 
+    out->src2 = record.src2; 
+    out->imm = record.imm; 
+    out->runLength = record.runLength; 
+    // the reciprocal is not saved 
+    if (record.kind >= NUM_OPCODES + FUSED_DIVIDE && record.kind <= NUM_OPCODES + FUSED_REMAINDER_DIVIDE)
+        setReciprocal (*out);
+}
+
+// records the superinstruction of a cached record runs - 0 if the 
+// record cannot be from a decode of the program (see validRecords) 
+inline unsigned int 
+fusedSpan (const CachedRecord& record, unsigned int codeSize)
+{
+    int kind = record.kind - NUM_OPCODES; 
+    if (kind == FUSED_CONSTANT || kind == FUSED_INDEXED_LOAD 
+        || kind == FUSED_DIVIDE_REMAINDER || kind == FUSED_REMAINDER_DIVIDE) return 2; 
+    if (kind >= FUSED_CONSTANT_BEQ && kind <= FUSED_CONSTANT_CALL) return 3; 
+    // a direct branch goes straight to the record of its constant 
+    if (kind >= FUSED_DIRECT_BEQ && kind <= FUSED_DIRECT_CALL)
+        return (uint32_t)record.imm < codeSize && record.imm % 4 == 0 ? 3 : 0; 
+    if (kind == FUSED_PUSHES || kind == FUSED_POPS) return record.imm >= 2 ? record.imm : 0; 
+    if (kind == FUSED_DIVIDE || kind == FUSED_REMAINDER) return hasReciprocal (record.imm) ? 1 : 0; 
+    if (kind == FUSED_ENTER) return record.imm > 0 ? 3 : 2; 
+    if (kind == FUSED_LEAVE) return record.imm == 1 || record.imm == 2 ? record.imm + 1 : 0; 
+    return 0; 
+}
+
+// true if the cached records can be restored - the file may be 
+// truncated, stale or written by anyone sharing the cache directory, 
+// so nothing in it that indexes the handler tables, the registers or 
+// the records is trusted 
+static bool 
+validRecords (const CachedRecord* cached, unsigned int numRecords, unsigned int codeSize, bool fused)
+{
+    unsigned int numKinds = fused ? NUM_OPCODES + NUM_SUPERINSTRUCTIONS : NUM_OPCODES; 
+    for (unsigned int i = 0; i < numRecords; ++i)
+    {
+        const CachedRecord& record = cached[i]; 
+        unsigned int left = numRecords - i; 
+        if (record.kind >= numKinds || record.dest >= 16 || record.src1 >= 16 || record.src2 >= 16 
+            || record.runLength == 0 || record.runLength > left) return false; 
+        if (record.kind < NUM_OPCODES) continue; 
+        unsigned int span = fusedSpan (record, codeSize); 
+        if (span == 0 || span > left) return false; 
+    }
+    return true; 
+}
+
+// decodes the whole program into state.code (or restores it from the 
+// cache)
+// the extra record at the end sends execution that runs off the end of 
+// the program to the on-the-fly decoder (outsideHandler) 
+void 
+decodeProgram (MachineState& state, void* const* handlers, void* const* fused, void* outsideHandler)
+{
+    unsigned int numRecords = state.codeSize / 4; 
+    // the records are kept from one decode to the next (until load)
+    if (state.code == nullptr)
+        state.code = (DecodedInstruction*) malloc ((numRecords + 1) * sizeof(DecodedInstruction));
+    DecodedInstruction* code = state.code; 
+    // an earlier process may have decoded this program already 
+    ProgramCache* cache = state.codeWritten ? nullptr : state.cache; 
+    const CachedRecord* cached = cache != nullptr 
+        ? cachedRecords (cache, numRecords, state.verified, fused != nullptr) : nullptr; 
+    // a file that does not hold a decode is replaced by a fresh one 
+    if (cached != nullptr && !validRecords (cached, numRecords, state.codeSize, fused != nullptr))
+        cached = nullptr; 
+    if (cached != nullptr)
+    {
+        for (unsigned int i = 0; i < numRecords; ++i)
+            restoreRecord (cached[i], handlers, fused, &code[i]);
+    }
+    else 
+    {
+        decodeBulk (state.memory, 0, numRecords, handlers, code);
+        // superinstructions and run lengths both look at the records after 
+        // them, so they share one backwards pass 
+        for (unsigned int i = numRecords; i-- > 0; )
+        {
+            if (fused != nullptr)
+                fuseInstruction (state, fused, i);
+            code[i].runLength = (endsRun (state.memory[i*4]) || i + 1 == numRecords) ? 1 : 1 + code[i+1].runLength; 
+        }
+        if (cache != nullptr)
+            saveDecodedProgram (state, cache, handlers, fused);
+    }
+    code[numRecords].handler = outsideHandler; 
+    code[numRecords].runLength = 0; 
+    state.codeHandlers = (void**)handlers; 
+}
+
+// decodes the records overlapping a store of width bytes at address 
+// (which must be inside the program) again 
+void 
+redecodeStore (MachineState& state, void* const* handlers, void* const* fused, unsigned int address, unsigned int width)
+{
+    unsigned int first = address / 4; 
+    unsigned int last  = (address + width - 1) / 4; 
+    if (last >= state.codeSize / 4) last = state.codeSize / 4 - 1; 
+    decodeRecords (state, handlers, fused, first, last);
+    // translated code is stale 
+    ++state.codeVersion; 
+    state.codeWritten = true; 
+}
+
+//========================================================================
+// Threaded engine 
+// executes the predecoded program - every handler ends by jumping 
+// straight to the next record's handler (one indirect jump per 
+// instruction instead of a compare chain)
+// relies on the labels-as-values (computed goto) extension of g++/clang
+// the instruction budget is charged a whole run at a time when a run is 
+// entered (after a branch/jump/call/return, or falling past one). when 
+// the budget cannot cover the next run, the rest of the budget is 
+// stepped through with the reference engine 
+// stores (SB/SH/SW, and PUSH/CALL when the stack reaches the program) 
+// into the program decode the affected records again and re-enter at 
+// the next instruction so the budget stays exact. 
+// code outside of the program is decoded as it is reached
+
+template <typename Trace>
+static RunResult 
+executeThreaded (MachineState& state, uint64_t maxInstructions, FaultScope& fault)
+{
+    // handler for each opcode, in opcode order 
+    static void* const handlers[NUM_OPCODES] = {
+        &&op_invalid,
+        &&op_lui,  &&op_lli,  &&op_lb,   &&op_lh,   &&op_lw,   &&op_sb,   &&op_sh,   &&op_sw,
+        &&op_add,  &&op_sub,  &&op_mul,  &&op_div,  &&op_mod,  &&op_sll,  &&op_srl,  &&op_sra,
+        &&op_or,   &&op_and,  &&op_xor,
+        &&op_addi, &&op_subi, &&op_muli, &&op_divi, &&op_modi, &&op_slli, &&op_srli, &&op_srai,
+        &&op_ori,  &&op_andi, &&op_xori,
+        &&op_beq,  &&op_bne,  &&op_blt,  &&op_ble,  &&op_bgt,  &&op_bge,  &&op_jmp,
+        &&op_call, &&op_ret,  &&op_push, &&op_pop,
+        &&op_nop,  &&op_hlt,  &&op_getchar, &&op_putchar
+    };
+    // handler for each superinstruction, in Superinstruction order 
+    static void* const fusedHandlers[NUM_SUPERINSTRUCTIONS] = {
+        &&op_constant,
+        &&op_constant_beq, &&op_constant_bne, &&op_constant_blt, 
+        &&op_constant_ble, &&op_constant_bgt, &&op_constant_bge,
+        &&op_constant_jmp, &&op_constant_call,
+        &&op_direct_beq, &&op_direct_bne, &&op_direct_blt, 
+        &&op_direct_ble, &&op_direct_bgt, &&op_direct_bge,
+        &&op_direct_jmp, &&op_direct_call,
+        &&op_indexed_load, &&op_pushes, &&op_pops,
+        &&op_divide, &&op_remainder, &&op_divide_remainder, &&op_remainder_divide,
+        &&op_enter, &&op_leave
+    };
+    void* const* fused = Trace::fuse ? fusedHandlers : nullptr; 
+
+    byte* memory = state.memory; 
+    int32_t* registers = state.registers; 
+    unsigned int codeSize = state.codeSize; 
+    unsigned int numRecords = codeSize / 4; 
+
+    // decode the program the first time this engine runs it 
+    if (state.codeHandlers != (void**)handlers)
+        decodeProgram (state, handlers, fused, &&op_outside);
+    DecodedInstruction* code = state.code; 
+
+    // instructions outside of the program (or at unaligned addresses) 
+    // are decoded one at a time into this scratch record 
+    DecodedInstruction outside[2]; 
+    outside[1].handler = &&op_outside; 
+    outside[1].runLength = 0; 
+    unsigned int outsideAddress = 0x00; 
+
+    DecodedInstruction* d = code; 
+    unsigned int address = state.currentInstructionAddress; 
+    // instructions left in the budget after the current run 
+    uint64_t budget = maxInstructions; 
+    // the record after the last one the budget was charged for 
+    DecodedInstruction* runEnd = d; 
+    RunResult result = RUN_HALTED; 
+
+// instruction fields 
+#define REG(r) (registers[r])
+#define DEST   (d->dest)
+#define SRC1   (d->src1)
+#define SRC2   (d->src2)
+#define IMM    (d->imm)
+// address of the current instruction 
+#define PC()   ((d >= code && d < code + numRecords) ? (unsigned int)(d - code) * 4 : outsideAddress)
+// charges the budget for the run starting at the current record 
+// (profiling - counts the entry first, and leaves at a hot block) 
+#define CHARGE()                                                            \
+    do {                                                                    \
+        if (Trace::profile && (unsigned int)(d - code) < numRecords)        \
+        {                                                                   \
+            if (state.hotness[d - code] >= HOT_THRESHOLD) goto promote;     \
+            ++state.hotness[d - code];                                      \
+        }                                                                   \
+        if (d->runLength > budget) goto tail;                               \
+        budget -= d->runLength;                                             \
+        runEnd = d + d->runLength;                                          \
+        fault.budget = budget;                                              \
+        fault.runEnd = runEnd;                                              \
+    } while (0)
+// publishes the current record before a load/store that may fault 
+#define ACCESS()                                                            \
+    do {                                                                    \
+        fault.record = d;                                                   \
+        PUBLISHED();                                                        \
+    } while (0)
+// jumps to the current record's handler 
+#define DISPATCH()                                                          \
+    do {                                                                    \
+        Trace::instruction (memory, PC());                                  \
+        goto *d->handler;                                                   \
+    } while (0)
+// moves on to the following instruction within the same run 
+#define NEXT()                                                              \
+    do {                                                                    \
+        ++d;                                                                \
+        Trace::registers (registers);                                       \
+        DISPATCH();                                                         \
+    } while (0)
+// moves on to the following instruction after the end of a run 
+#define NEXT_RUN()                                                          \
+    do {                                                                    \
+        ++d;                                                                \
+        Trace::registers (registers);                                       \
+        CHARGE();                                                           \
+        DISPATCH();                                                         \
+    } while (0)
+// moves on to the given address 
+#define GOTO_ADDRESS(a)                                                     \
+    do {                                                                    \
+        address = (a);                                                      \
+        Trace::registers (registers);                                       \
+        goto resolve;                                                       \
+    } while (0)
+#define JUMP(addr) GOTO_ADDRESS (REG(addr))
+// profiling - a branch back to address (from the current record) 
+// is a loop, so its target gets hot sooner 
+#define BACKWARD_EDGE()                                                     \
+    do {                                                                    \
+        if (Trace::profile && address <= PC())                              \
+            state.hotness[address / 4] += BACKWARD_WEIGHT;                  \
+    } while (0)
+// handles a store of the given width - a store into the program decodes 
+// the affected records again, refunds the rest of the current run and 
+// re-enters at the next instruction 
+#define STORED(a, width)                                                    \
+    do {                                                                    \
+        if ((unsigned int)(a) < codeSize)                                   \
+        {                                                                   \
+            redecodeStore (state, handlers, fused, (unsigned int)(a), (width)); \
+            budget += runEnd - (d + 1);                                     \
+            GOTO_ADDRESS (PC() + 4);                                        \
+        }                                                                   \
+        NEXT();                                                             \
+    } while (0)
+
+    // finds the record for address, charges its run, and dispatches it 
+resolve:
+    if (address < codeSize && address % 4 == 0)
+    {
+        BACKWARD_EDGE();
+        d = &code[address / 4];
+        CHARGE();
+        DISPATCH();
+    }
+    // ran off the end of memory 
+    if (address >= state.memorySize) 
+    {
+        state.halted = true; 
+        goto done; 
+    }
+    // the last word of memory may reach past its end - the reference 
+    // engine stops there if it does 
+    if (address + 4 > state.memorySize)
+    {
+        state.currentInstructionAddress = address; 
+        state.instructionsRetired += maxInstructions - budget; 
+        return runReference<Trace> (state, budget);
+    }
+    // running outside of the predecoded program 
+    outsideAddress = address; 
+    fault.outsideAddress = address; 
+    decodeInstruction (memory, address, handlers, &outside[0]);
+    d = &outside[0];
+    CHARGE();
+    DISPATCH();
+
+    // fell off the end of the program or the scratch record 
+op_outside:
+    address = (d == &code[numRecords]) ? codeSize : outsideAddress + 4; 
+    goto resolve; 
+
+    // LUI dest, imm - writes the first 2 bytes of dest (in memory order)
+op_lui:
+    REG(DEST) = (REG(DEST) & 0xffff0000) | (uint16_t)IMM; 
+    NEXT();
+    // LLI dest, imm - writes the last 2 bytes of dest (in memory order)
+op_lli:
+    REG(DEST) = (REG(DEST) & 0x0000ffff) | ((uint32_t)IMM << 16); 
+    NEXT();
+    // LB dest, offset(src)
+op_lb:
+    ACCESS();
+    REG(DEST) = (unsigned int)memory[REG(SRC1) + IMM];
+    NEXT();
+    // LH dest, offset(src)
+op_lh:
+    ACCESS();
+    REG(DEST) = (unsigned int)*(short*)&memory[REG(SRC1) + IMM];
+    NEXT();
+    // LW dest, offset(src)
+op_lw:
+    ACCESS();
+    REG(DEST) = (unsigned int)*(int*)&memory[REG(SRC1) + IMM];
+    NEXT();
+    // SB offset(dest), src
+op_sb:
+    ACCESS();
+    *(byte*)&memory[REG(DEST) + IMM] = (byte)REG(SRC1);
+    STORED (REG(DEST) + IMM, 1);
+    // SH offset(dest), src
+op_sh:
+    ACCESS();
+    *(int16_t*)&memory[REG(DEST) + IMM] = (int16_t)REG(SRC1);
+    STORED (REG(DEST) + IMM, 2);
+    // SW offset(dest), src
+op_sw:
+    ACCESS();
+    *(int*)&memory[REG(DEST) + IMM] = REG(SRC1);
+    STORED (REG(DEST) + IMM, 4);
+
+    // arithmetic instructions - computed as the instruction set describes them 
+#define COMPUTE(op,b) REG(DEST) = instructionSet[OPCODE_##op].compute (REG(SRC1), b); NEXT()
+op_add: COMPUTE(ADD, REG(SRC2));
+op_sub: COMPUTE(SUB, REG(SRC2));
+op_mul: COMPUTE(MUL, REG(SRC2));
+op_div: COMPUTE(DIV, REG(SRC2));
+op_mod: COMPUTE(MOD, REG(SRC2));
+op_sll: COMPUTE(SLL, REG(SRC2));
+op_srl: COMPUTE(SRL, REG(SRC2));
+op_sra: COMPUTE(SRA, REG(SRC2));
+op_or:  COMPUTE(OR, REG(SRC2));
+op_and: COMPUTE(AND, REG(SRC2));
+op_xor: COMPUTE(XOR, REG(SRC2));
+
+    // immediate arithmetic instructions
+op_addi: COMPUTE(ADDI, IMM);
+op_subi: COMPUTE(SUBI, IMM);
+op_muli: COMPUTE(MULI, IMM);
+op_divi: COMPUTE(DIVI, IMM);
+op_modi: COMPUTE(MODI, IMM);
+op_slli: COMPUTE(SLLI, IMM);
+op_srli: COMPUTE(SRLI, IMM);
+op_srai: COMPUTE(SRAI, IMM);
+op_ori:  COMPUTE(ORI, IMM);
+op_andi: COMPUTE(ANDI, IMM);
+op_xori: COMPUTE(XORI, IMM);
+#undef COMPUTE
+
+    // branching - ssssssss aaaa0000 
+op_beq: if (REG(DEST) == REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_bne: if (REG(DEST) != REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_blt: if (REG(DEST) <  REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_ble: if (REG(DEST) <= REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_bgt: if (REG(DEST) >  REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_bge: if (REG(DEST) >= REG(SRC1)) JUMP(SRC2); NEXT_RUN();
+op_jmp: JUMP(DEST);
+
+    // function instructions 
+    // CALL addr - push return address ; pc <- addr
+op_call:
+    ACCESS();
+    REG(sp) -= 4; // stack grows towards 0
+    *(unsigned int*)&memory[REG(sp)] = PC();
+    // the target is read first - the push may decode this record again 
+    // (a CALL ends its run, so there is nothing to refund) 
+    address = REG(DEST);
+    if ((unsigned int)REG(sp) < codeSize) redecodeStore (state, handlers, fused, REG(sp), 4);
+    GOTO_ADDRESS (address);
+    // RET - pop pc 
+    // the return address is the CALL itself, so move past it 
+op_ret:
+    ACCESS();
+    address = *(unsigned int*)&memory[REG(sp)];
+    REG(sp) += 4; // stack shrinks towards MEM_SIZE
+    GOTO_ADDRESS (address + 4);
+    // PUSH src - sp -= 4 ; [sp] <- src
+op_push:
+    ACCESS();
+    REG(sp) -= 4; // stack grows towards 0
+    *(int*)&memory[REG(sp)] = REG(DEST);
+    STORED (REG(sp), 4);
+    // POP dest - dest <- [sp] ; sp += 4
+op_pop:
+    ACCESS();
+    REG(DEST) = *(int*)&memory[REG(sp)]; 
+    REG(sp) += 4; // stack shrinks towards MEM_SIZE
+    NEXT();
+
+    // superinstructions 
+    // the constant is written whole, then the last instruction of the 
+    // sequence runs as usual 
+op_constant:
+    REG(DEST) = IMM; 
+    ++d; 
+    NEXT();
+#define CONSTANT_THEN(label)                                                \
+    REG(DEST) = IMM;                                                        \
+    d += 2;                                                                 \
+    goto label
+op_constant_beq:  CONSTANT_THEN (op_beq);
+op_constant_bne:  CONSTANT_THEN (op_bne);
+op_constant_blt:  CONSTANT_THEN (op_blt);
+op_constant_ble:  CONSTANT_THEN (op_ble);
+op_constant_bgt:  CONSTANT_THEN (op_bgt);
+op_constant_bge:  CONSTANT_THEN (op_bge);
+op_constant_jmp:  CONSTANT_THEN (op_jmp);
+op_constant_call: CONSTANT_THEN (op_call);
+#undef CONSTANT_THEN
+    // verified - the constant is an instruction of the program, so the 
+    // branch skips resolve 
+#define DIRECT_IF(cond)                                                     \
+    address = IMM;                                                          \
+    REG(DEST) = address;                                                    \
+    d += 2;                                                                 \
+    if (cond) goto direct;                                                  \
+    NEXT_RUN()
+op_direct_beq: DIRECT_IF (REG(DEST) == REG(SRC1));
+op_direct_bne: DIRECT_IF (REG(DEST) != REG(SRC1));
+op_direct_blt: DIRECT_IF (REG(DEST) <  REG(SRC1));
+op_direct_ble: DIRECT_IF (REG(DEST) <= REG(SRC1));
+op_direct_bgt: DIRECT_IF (REG(DEST) >  REG(SRC1));
+op_direct_bge: DIRECT_IF (REG(DEST) >= REG(SRC1));
+#undef DIRECT_IF
+op_direct_jmp:
+    address = IMM; 
+    REG(DEST) = address; 
+    d += 2; 
+    goto direct; 
+op_direct_call:
+    address = IMM; 
+    REG(DEST) = address; 
+    d += 2; 
+    ACCESS();
+    REG(sp) -= 4; // stack grows towards 0
+    *(unsigned int*)&memory[REG(sp)] = PC();
+    if ((unsigned int)REG(sp) < codeSize) redecodeStore (state, handlers, fused, REG(sp), 4);
+direct:
+    BACKWARD_EDGE();
+    d = &code[address / 4];
+    Trace::registers (registers);
+    CHARGE();
+    DISPATCH();
+    // ADD r, a, b ; LB d, offset(r)
+op_indexed_load:
+    REG(DEST) = REG(SRC1) + REG(SRC2); 
+    ++d; 
+    goto op_lb;
+    // PUSH/POP runs - sp stays in a local for the whole run, and the 
+    // stack window the run touches is checked once up front (in 64 bits, 
+    // so an sp near 2^31 cannot wrap past the check). 
+    // (registers pushed or popped are never sp)
+op_pushes:
+    {
+        int32_t top = REG(sp); 
+        // outside of memory or into the program - go one instruction at 
+        // a time 
+        if ((int64_t)top - 4 * (int64_t)IMM < (int64_t)codeSize || top > (int64_t)state.memorySize) goto op_push; 
+        ACCESS();
+        for (DecodedInstruction* last = d + IMM; d < last; ++d)
+        {
+            top -= 4; // stack grows towards 0
+            *(int*)&memory[top] = REG(DEST);
+        }
+        REG(sp) = top; 
+        --d; 
+    }
+    NEXT();
+op_pops:
+    {
+        int32_t top = REG(sp); 
+        // outside of memory - go one instruction at a time 
+        if (top < 0 || (int64_t)top + 4 * (int64_t)IMM > (int64_t)state.memorySize) goto op_pop; 
+        ACCESS();
+        for (DecodedInstruction* last = d + IMM; d < last; ++d)
+        {
+            REG(DEST) = *(int*)&memory[top]; 
+            top += 4; // stack shrinks towards MEM_SIZE
+        }
+        REG(sp) = top; 
+        --d; 
+    }
+    NEXT();
+    // DIVI/MODI by a constant 
+op_divide:
+    REG(DEST) = divideByReciprocal (REG(SRC1), *d); 
+    NEXT();
+op_remainder:
+    REG(DEST) = REG(SRC1) - divideByReciprocal (REG(SRC1), *d) * IMM; 
+    NEXT();
+    // DIVI q, a, k ; MODI r, a, k (q is not a) 
+op_divide_remainder:
+    {
+        int32_t n = REG(SRC1); 
+        int32_t quotient = divideByReciprocal (n, *d); 
+        REG(DEST) = quotient; 
+        ++d; 
+        REG(DEST) = n - quotient * IMM; 
+    }
+    NEXT();
+    // MODI r, a, k ; DIVI q, a, k (r is not a) 
+op_remainder_divide:
+    {
+        int32_t n = REG(SRC1); 
+        int32_t quotient = divideByReciprocal (n, *d); 
+        REG(DEST) = n - quotient * IMM; 
+        ++d; 
+        REG(DEST) = quotient; 
+    }
+    NEXT();
+    // PUSH bp ; ADDI bp, sp, 0 ; SUBI sp, sp, n
+op_enter:
+    {
+        int32_t top = REG(sp); 
+        // outside of memory or into the program - go one instruction at 
+        // a time 
+        if ((int64_t)top - 4 - IMM < 0 || (int64_t)top - 4 < (int64_t)codeSize || top > (int64_t)state.memorySize) goto op_push; 
+        ACCESS();
+        top -= 4; // stack grows towards 0
+        *(int*)&memory[top] = REG(bp); 
+        REG(bp) = top; 
+        REG(sp) = top - IMM; 
+        d += IMM > 0 ? 2 : 1; 
+    }
+    NEXT();
+    // ADDI sp, bp, 0 ; POP bp ; RET
+op_leave:
+    {
+        int32_t top = IMM == 2 ? REG(bp) : REG(sp); 
+        // outside of memory - go one instruction at a time 
+        // (imm no longer holds the ADDI's 0) 
+        if (top < 0 || (int64_t)top + 8 > (int64_t)state.memorySize)
+        {
+            if (IMM == 1) goto op_pop; 
+            REG(sp) = REG(bp); 
+            NEXT();
+        }
+        ACCESS();
+        REG(bp) = *(int*)&memory[top]; 
+        address = *(unsigned int*)&memory[top + 4]; 
+        REG(sp) = top + 8; // stack shrinks towards MEM_SIZE
+        // the RET's record, as if it had run on its own 
+        d += IMM; 
+    }
+    GOTO_ADDRESS (address + 4);
+
+    // other instructions
+op_nop:
+    NEXT();
+op_hlt:
+    // HLT does not retire - the machine stays on it 
+    budget += 1; 
+    address = PC(); 
+    state.halted = true; 
+    goto done;
+op_getchar:
+    // wait for more input without executing the GETCHAR 
+    if (state.inputPosition == state.inputSize && !state.inputClosed)
+    {
+        budget += 1; 
+        address = PC(); 
+        result = RUN_WAITING_FOR_INPUT; 
+        goto done; 
+    }
+    REG(DEST) = readInput (state);
+    NEXT_RUN();
+op_putchar:
+    Trace::outputBegin ();
+    putchar(REG(DEST));
+    Trace::outputEnd ();
+    NEXT();
+op_invalid:
+    budget += 1; 
+    address = fetchInstruction (memory, PC()) >> 24; 
+    printf ("Invalid opcode %x%x\n", 
+        (0b11110000 & address) >> 4,
+        (0b00001111 & address) >> 0
+    );
+    address = PC(); 
+    state.halted = true; 
+    goto done;
+
+    // not enough budget left for the whole run 
+tail:
+    state.currentInstructionAddress = PC(); 
+    state.instructionsRetired += maxInstructions - budget; 
+    return runReference<Trace> (state, budget);
+
+    // profiling - the next run is hot (and may already be translated), 
+    // so stop before it and let the tiered engine take over 
+promote:
+    state.currentInstructionAddress = PC(); 
+    state.instructionsRetired += maxInstructions - budget; 
+    return RUN_BUDGET_EXHAUSTED; 
+
+done:
+    state.currentInstructionAddress = address; 
+    state.instructionsRetired += maxInstructions - budget; 
+    return result; 
+
+#undef REG
+#undef DEST
+#undef SRC1
+#undef SRC2
+#undef IMM
+#undef PC
+#undef CHARGE
+#undef DISPATCH
+#undef NEXT
+#undef NEXT_RUN
+#undef GOTO_ADDRESS
+#undef JUMP
+#undef BACKWARD_EDGE
+#undef STORED
+#undef ACCESS
+}
+
+template <typename Trace>
+RunResult 
+runThreaded (MachineState& state, uint64_t maxInstructions)
+{
+    FaultScope fault; 
+    if (sigsetjmp (fault.resume, 0) != 0)
+    {
+        // the record's run was charged whole 
+        const DecodedInstruction* code = state.code; 
+        bool inProgram = fault.record >= code && fault.record < code + state.codeSize / 4; 
+        uint32_t pc = inProgram ? (uint32_t)(fault.record - code) * 4 : fault.outsideAddress; 
+        // an access that did not publish its record - there is no 
+        // instruction to stop on, so only halt 
+        if (fault.record == nullptr || pc >= state.memorySize)
+        {
+            printf ("Invalid address %x\n", fault.address); 
+            state.halted = true; 
+            return RUN_HALTED; 
+        }
+        uint64_t retired = maxInstructions - fault.budget - (fault.runEnd - fault.record); 
+        return stopAtFault (state, fault.address, pc, retired);
+    }
+    return executeThreaded<Trace> (state, maxInstructions, fault);
+}
+
+// for the tiered engine - stops early (with RUN_BUDGET_EXHAUSTED) at 
+// the first hot block 
+RunResult 
+runThreadedProfiled (MachineState& state, uint64_t maxInstructions)
+{
+    return runThreaded<ProfileTrace> (state, maxInstructions);
+}
+
+//========================================================================
+// Engines 
+
+static const char* const engineNames[NUM_ENGINES] = {
+    "reference", "switch", "threaded", "jit", "tiered", "opt"
+};
+
+const char* 
+engineName (Engine engine)
+{
+    return engine < NUM_ENGINES ? engineNames[engine] : "unknown"; 
+}
+
+Engine 
+engineByName (const char* name)
+{
+    for (int i = 0; i < NUM_ENGINES; ++i)
+        if (strcmp (name, engineNames[i]) == 0) return (Engine)i; 
+    return NUM_ENGINES; 
+}
+
+//========================================================================
+// AmyMachine 
+// guest memory is an anonymous private mapping - the kernel hands out
+// zeroed pages as the program first touches them, so a machine only
+// costs the pages its program uses and reset can give them back
+// instead of writing zeros over all of memory. it is mapped into the 
+// middle of a PROT_NONE window (see Guest faults) when the address 
+// space has room for one 
+
+// memorySize bytes of zeroed memory (null if the mapping failed) - 
+// guarded is set if it sits in a window 
+static byte* 
+mapMemory (size_t memorySize, bool* guarded)
+{
+    *guarded = false; 
+    // the window is only address space - nothing in it is backed 
+    void* window = mmap (nullptr, WINDOW_SIZE, PROT_NONE, 
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (window != MAP_FAILED)
+    {
+        byte* memory = (byte*) window + ((size_t)1 << 31) + GUARD_SIZE; 
+        if (mmap (memory, memorySize, PROT_READ | PROT_WRITE, 
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) != MAP_FAILED)
+        {
+            installFaultHandler ();
+            *guarded = true; 
+            return memory; 
+        }
+        munmap (window, WINDOW_SIZE);
+    }
+    void* memory = mmap (nullptr, memorySize, PROT_READ | PROT_WRITE, 
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? nullptr : (byte*) memory; 
+}
+
+// zeroes memory by dropping its pages - the next touch of each maps a 
+// fresh zero page 
+static void 
+clearMemory (byte* memory, size_t memorySize)
+{
+    if (memory != nullptr) madvise (memory, memorySize, MADV_DONTNEED);
+}
+
+AmyMachine::AmyMachine (size_t memorySize)
+{
+    debug = false; 
+    engine = ENGINE_TIERED; 
+    image = nullptr; 
+    imageSize = 0; 
+    cfg = nullptr; 
+    // more would not fit in the window reserved for it 
+    state.guarded = false; 
+    state.memory = nullptr; 
+    if (memorySize > MAX_MEMORY_SIZE)
+        printf ("Memory size must be at most %zu bytes\n", MAX_MEMORY_SIZE);
+    else 
+    {
+        state.memory = mapMemory (memorySize, &state.guarded);
+        if (state.memory == nullptr) printf ("Could not map %zu bytes of memory\n", memorySize);
+    }
+    // a machine without memory stays halted, and no program fits in it
+    if (state.memory == nullptr) memorySize = 0; 
+    state.memorySize = memorySize; 
+    state.codeSize = 0; 
+    state.code = nullptr; 
+    state.codeHandlers = nullptr; 
+    state.verified = false; 
+    state.codeVersion = 0; 
+    state.codeWritten = false; 
+    state.jit = nullptr; 
+    state.hotness = nullptr; 
+    state.cache = nullptr; 
+    state.input = nullptr; 
+    state.inputCapacity = 0; 
+    cacheDirectory = nullptr; 
+    reset ();
+}
+
+AmyMachine::~AmyMachine ()
+{
+    releaseJit (state);
+    if (state.guarded)                munmap (windowOf (state.memory), WINDOW_SIZE);
+    else if (state.memory != nullptr) munmap (state.memory, state.memorySize);
+    free (state.code);
+    free (state.hotness);
+    free (state.input);
+    free (image);
+    freeControlFlowGraph (cfg);
+    closeProgramCache (state.cache);
+    free (cacheDirectory);
+}
+
+bool 
+AmyMachine::load (const byte* program, size_t size)
+{
+    if (size > state.memorySize)
+    {
+        printf ("Program of %zu bytes does not fit in %zu bytes of memory\n", size, state.memorySize);
+        return false; 
+    }
+    free (image);
+    image = (byte*) malloc (size);
+    std::memcpy (image, program, size);
+    imageSize = size; 
+    freeControlFlowGraph (cfg);
+    cfg = nullptr; 
+    // only whole instructions are predecoded 
+    state.codeSize = size - (size % 4); 
+    free (state.code);
+    state.code = nullptr; 
+    free (state.hotness);
+    state.hotness = nullptr; 
+    state.verified = false; 
+    closeProgramCache (state.cache);
+    state.cache = nullptr; 
+    if (cacheDirectory != nullptr)
+        state.cache = openProgramCache (cacheDirectory, image, imageSize, state.memorySize);
+    reset ();
+    return true; 
+}
+
+void 
+AmyMachine::reset ()
+{
+    clearMemory (state.memory, state.memorySize);
+    if (imageSize > 0) std::memcpy (state.memory, image, imageSize);
+    // the predecoded and translated program may have been invalidated
+    // by the last run 
+    programWritten (state);
+    state.codeWritten = false; 
+    // and every block starts out cold again 
+    if (state.hotness != nullptr)
+        std::memset (state.hotness, 0, (state.codeSize / 4) * sizeof(uint32_t));
+
+    std::memset (state.registers, 0, sizeof(state.registers));
+    // bp and sp start at the end of memory 
+    state.registers[bp] = state.memorySize - (state.memorySize % 4); 
+    state.registers[sp] = state.memorySize - (state.memorySize % 4); 
+    state.currentInstructionAddress = 0x00; 
+    state.halted = state.memory == nullptr; 
+    state.instructionsRetired = 0; 
+
+    state.inputPosition = 0; 
+    state.inputSize = 0; 
+    state.inputClosed = false; 
+}
+
+RunResult 
+AmyMachine::run (uint64_t maxInstructions)
+{
+    if (state.halted) return RUN_HALTED; 
+    RunningScope running (state);
+    switch (engine)
+    {
+        case ENGINE_REFERENCE:
+            if (debug) return runReference<DebugTrace> (state, maxInstructions);
+            else       return runReference<NoTrace> (state, maxInstructions);
+        case ENGINE_SWITCH:
+            if (debug) return runSwitch<DebugTrace> (state, maxInstructions);
+            else       return runSwitch<NoTrace> (state, maxInstructions);
+        case ENGINE_JIT:
+        case ENGINE_TIERED:
+        case ENGINE_OPT:
+            // tracing needs an interpreter 
+            if (!debug && jitAvailable ())
+            {
+                if (engine == ENGINE_JIT)         return runJit (state, maxInstructions);
+                else if (engine == ENGINE_TIERED) return runTiered (state, maxInstructions);
+                else                              return runOptimized (state, maxInstructions);
+            }
+            // fall through 
+        default:
+            if (debug) return runThreaded<DebugTrace> (state, maxInstructions);
+            else       return runThreaded<NoTrace> (state, maxInstructions);
+    }
+}
+
+RunResult 
+AmyMachine::step (uint64_t n)
+{
+    if (state.halted) return RUN_HALTED; 
+    RunningScope running (state);
+    if (debug) return runReference<DebugTrace> (state, n);
+    else       return runReference<NoTrace> (state, n);
+}
+
+bool 
+AmyMachine::verify ()
+{
+    state.verified = verifyProgram (state, debug);
+    // decode again with the verified superinstructions 
+    state.codeHandlers = nullptr; 
+    return state.verified; 
+}
+
+const ControlFlowGraph* 
+AmyMachine::controlFlow ()
+{
+    if (cfg != nullptr) return cfg; 
+    if (state.cache != nullptr) cfg = cachedControlFlowGraph (state.cache);
+    if (cfg == nullptr) 
+    {
+        cfg = buildControlFlowGraph (image, imageSize, state.memorySize);
+        if (state.cache != nullptr) saveControlFlowGraph (state.cache, cfg);
+    }
+    return cfg; 
+}
+
+bool 
+AmyMachine::compileNative (const char* outputPath)
+{
+    return ::compileNative (outputPath, image, imageSize, state.memorySize, controlFlow ());
+}
+
+void 
+AmyMachine::useCache (const char* directory)
+{
+    free (cacheDirectory);
+    cacheDirectory = strdup (directory);
+    closeProgramCache (state.cache);
+    state.cache = nullptr; 
+    if (image != nullptr)
+        state.cache = openProgramCache (cacheDirectory, image, imageSize, state.memorySize);
+}
+
+void 
+AmyMachine::provideInput (const byte* data, size_t size)
+{
+    // drop what has already been read 
+    std::memmove (state.input, state.input + state.inputPosition, state.inputSize - state.inputPosition);
+    state.inputSize -= state.inputPosition; 
+    state.inputPosition = 0; 
+    if (state.inputSize + size > state.inputCapacity)
+    {
+        state.inputCapacity = (state.inputSize + size) * 2; 
+        state.input = (byte*) realloc (state.input, state.inputCapacity);
+    }
+    std::memcpy (state.input + state.inputSize, data, size);
+    state.inputSize += size; 
+}
+
+void 
+AmyMachine::closeInput ()
+{
+    state.inputClosed = true; 
+}
+
+//========================================================================
@@ -0,0 +1,602 @@
+// AmyMachine 
+// embeddable interpreter for the 32-bit machine language 
+// that uses a RISC-V-like format 
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_MACHINE_H
+#define AMY_MACHINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//========================================================================
+
+typedef unsigned char byte; 
+
+//========================================================================
+// Instructions 
+
+// Using a similar language to RISC-V
+// all instructions are 32-bit
+
+// opcodes are compile-time constants so that the dispatch engines 
+// below can index jump tables with them directly 
+// opcode 0 is not defined 
+// which will halt the program with an error 
+enum Opcode : byte 
+{
+    OPCODE_UNDEFINED = 0b00000000,
+
+    // LUI dest, imm        - loads upper immediate 16 bits into given register
+    // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
+    OPCODE_LUI,
+    // LLI dest, imm        - loads lower immediate 16 bits into given register
+    // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
+    OPCODE_LLI,
+    // LB dest, offset(src) - load byte 
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_LB,
+    // LH dest, offset(src) - load half (2 bytes)
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_LH,
+    // LW dest, offset(src) - load word (4 bytes)
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_LW,
+    // SB offset(dest), src - store byte
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_SB,
+    // SH offset(dest), src - store half (2 bytes)
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_SH,
+    // SW offset(dest), src - store word (4 bytes)
+    // XXXXXXXX ddddssss oooooooo oooooooo
+    OPCODE_SW,
+
+    // arithmetic instructions
+    // ADD dest, src1, src2 - integer addition
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_ADD,
+    // SUB dest, src1, src2 - integer subtraction
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_SUB,
+    // MUL dest, src1, src2 - integer multiplication
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_MUL,
+    // DIV dest, src1, src2 - integer division
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_DIV,
+    // MOD dest, src1, src2 - integer division remainder
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_MOD,
+    // SLL dest, src1, src2 - shift left logical
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_SLL,
+    // SRL dest, src1, src2 - shift right logical
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_SRL,
+    // SRA dest, src1, src2 - shift right arithmetic
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_SRA,
+    // OR  dest, src1, src2 - bitwise or
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_OR,
+    // AND dest, src1, src2 - bitwise and
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_AND,
+    // XOR dest, src1, src2 - bitwise xor 
+    // XXXXXXXX ddddssss ssss0000 00000000
+    OPCODE_XOR,
+
+    // immediate arithmetic instructions
+    // immediate values are 16-bit signed
+    // ADDI dest, src1, imm - integer addition with immediate
+    // - can be used to load immediate into register 
+    // - that's why there is no load immediate 
+    // - ADDI r0, rzero, 42 : r0 <- 0 + 42
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_ADDI,
+    // SUBI dest, src1, imm - integer subtraction with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_SUBI,
+    // MULI dest, src1, src2 - integer multiplication with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_MULI,
+    // DIVI dest, src1, src2 - integer division with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_DIVI,
+    // MODI dest, src1, src2 - integer division remainder with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_MODI,
+    // SLLI dest, src1, imm - shift left logical with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_SLLI,
+    // SRLI dest, src1, imm - shift right logical with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_SRLI,
+    // SRAI dest, src1, imm - shift right arithmetic with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_SRAI,
+    // ORI  dest, src1, imm - bitwise or with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_ORI,
+    // ANDI dest, src1, imm - bitwise and with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_ANDI,
+    // XORI dest, src1, imm - bitwise xor  with immediate
+    // XXXXXXXX ddddssss iiiiiiii iiiiiiii
+    OPCODE_XORI,
+
+    // branching
+    // BEQ src1, src2, addr - if src1 == src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BEQ,
+    // BNE src1, src2, addr - if src1 != src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BNE,
+    // BLT src1, src2, addr - if src1 <  src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BLT,
+    // BLE src1, src2, addr - if src1 <= src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BLE,
+    // BGT src1, src2, addr - if src1 >  src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BGT,
+    // BGE src1, src2, addr - if src1 >= src2 then pc <- addr
+    // XXXXXXXX ssssssss aaaa0000 00000000
+    OPCODE_BGE,
+    // JMP addr - pc <- addr
+    // XXXXXXXX aaaa0000 00000000 00000000
+    OPCODE_JMP,
+
+    // function instructions
+    // CALL addr
+    // 1. pushes return address on to the stack
+    // 2. changes pc to addr
+    // base pointer should be pushed on the stack by the callee
+    // push bp
+    // mov bp, sp
+    // Caller's actions
+    // 1. push caller saved registers
+    // 2. push args in reverse order (callee can access with arg0 = [bp+8], arg1 = [bp+12])
+    // 3. call function
+    // Call's actions
+    // 1. push return addr
+    // 2. pc <- addr 
+    // Callee's actions 
+    // 1. push caller's bp 
+    // 2. align our frame's bp and sp (mov bp, sp)
+    // 3. allocate space for local vars (sub sp, sp, <#bytes>)
+    //    local vars can be access with bp - 0, bp - 4, bp - 8, etc
+    // 4. push callee saved registers onto stack 
+    //    these need to be restored because caller 
+    //    expects these values to be unchanged. 
+    // XXXXXXXX aaaa0000 00000000 00000000
+    OPCODE_CALL,
+    // RET - pc <- [bp]
+    // changes the current pc to the return address pointed to by bp
+    // Callee's actions before returning
+    // 1. store any return value in ra (return value register)
+    // 2. restore callee-saved registers 
+    // 3. pop local vars off of stack (mov sp, bp) (sp <- bp)
+    // 4. restore caller's bp (pop bp)
+    // Return's actions 
+    // 1. pops return address off of stack and stores in pc (pop pc) 
+    // Caller's actions after returning 
+    // 1. pop any arguments that were pushed onto the stack (add sp, sp, <#bytes>)
+    // 2. pop any caller saved registers back into their respective registers (pop r#)
+    // XXXXXXXX 00000000 00000000 00000000
+    OPCODE_RET,
+    // PUSH src - sp -= 4 ; [sp] <- src
+    // 1. decrements sp by 4 (bytes)
+    // 2. places src onto stack at [sp]
+    // XXXXXXXX ssss0000 00000000 00000000
+    OPCODE_PUSH,
+    // POP dest - dest <- [sp] ; sp += 4
+    // 1. moves [sp] into dest 
+    // 2. increments sp by 4 (bytes)
+    // XXXXXXXX dddd0000 00000000 00000000
+    OPCODE_POP,
+
+    // other instructions
+    // NOP - no operation
+    // XXXXXXXX 000000000 00000000 00000000
+    OPCODE_NOP,
+    // HLT - halts the computer
+    // XXXXXXXX 000000000 00000000 00000000
+    OPCODE_HLT,
+    // GETCHAR - reads (from stdin) a char (1-byte) and stores it in the 
+    // given register
+    // XXXXXXXX dddd00000 00000000 00000000
+    OPCODE_GETCHAR,
+    // PUTCHAR - outputs (to stdout) a char (1-byte) from the given register
+    // XXXXXXXX ssss00000 00000000 00000000
+    OPCODE_PUTCHAR,
+
+    // number of defined opcodes (including the undefined opcode 0)
+    NUM_OPCODES
+};
+
+//========================================================================
+// Instruction set 
+// one row per opcode (in opcode order) describing how the instruction 
+// is written and what it does. the decoders, verifier, control flow 
+// graph, translators, assembler and disassembler classify instructions 
+// through it instead of through opcode ranges of their own 
+
+// which fields an instruction uses, and how its assembly is written 
+enum InstructionFormat : byte 
+{
+    // NOP, HLT, RET 
+    FORMAT_NONE,
+    // LUI dest, imm 
+    FORMAT_CONSTANT,
+    // LB dest, offset(src) 
+    FORMAT_LOAD,
+    // SB offset(dest), src 
+    FORMAT_STORE,
+    // ADD dest, src1, src2 
+    FORMAT_REGISTERS,
+    // ADDI dest, src1, imm 
+    FORMAT_IMMEDIATE,
+    // BEQ src1, src2, addr 
+    FORMAT_BRANCH,
+    // JMP addr, CALL addr, PUSH src, POP dest, GETCHAR dest, PUTCHAR src 
+    // (all in the dest field) 
+    FORMAT_REGISTER
+};
+
+// what an instruction does besides computing a value 
+enum InstructionFlag : uint16_t 
+{
+    // writes the register in its dest field 
+    ISA_WRITES_DEST = 1 << 0,
+    // moves sp 
+    ISA_WRITES_SP   = 1 << 1,
+    // reads/writes InstructionInfo::width bytes of memory 
+    ISA_LOADS       = 1 << 2,
+    ISA_STORES      = 1 << 3,
+    // can send the pc somewhere other than the next instruction 
+    ISA_CONTROL     = 1 << 4,
+    // ... only when its condition holds 
+    ISA_CONDITIONAL = 1 << 5,
+    // stops the machine 
+    ISA_HALTS       = 1 << 6,
+    // reads input (and may stop the machine to wait for it) 
+    ISA_INPUT       = 1 << 7,
+    // writes output 
+    ISA_OUTPUT      = 1 << 8
+};
+
+// semantics of the operations - shifts use the low 5 bits of their 
+// amount like the host does, and DIV/MOD trap on the host like the 
+// interpreters 
+constexpr int32_t isaAdd (int32_t a, int32_t b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+constexpr int32_t isaSub (int32_t a, int32_t b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+constexpr int32_t isaMul (int32_t a, int32_t b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+constexpr int32_t isaDiv (int32_t a, int32_t b) { return a / b; }
+constexpr int32_t isaMod (int32_t a, int32_t b) { return a % b; }
+constexpr int32_t isaSll (int32_t a, int32_t b) { return (int32_t)((uint32_t)a << (b & 31)); }
+constexpr int32_t isaSrl (int32_t a, int32_t b) { return (int32_t)((uint32_t)a >> (b & 31)); }
+constexpr int32_t isaSra (int32_t a, int32_t b) { return a >> (b & 31); }
+constexpr int32_t isaOr  (int32_t a, int32_t b) { return a | b; }
+constexpr int32_t isaAnd (int32_t a, int32_t b) { return a & b; }
+constexpr int32_t isaXor (int32_t a, int32_t b) { return a ^ b; }
+constexpr int32_t isaEq  (int32_t a, int32_t b) { return a == b; }
+constexpr int32_t isaNe  (int32_t a, int32_t b) { return a != b; }
+constexpr int32_t isaLt  (int32_t a, int32_t b) { return a <  b; }
+constexpr int32_t isaLe  (int32_t a, int32_t b) { return a <= b; }
+constexpr int32_t isaGt  (int32_t a, int32_t b) { return a >  b; }
+constexpr int32_t isaGe  (int32_t a, int32_t b) { return a >= b; }
+
+struct InstructionInfo 
+{
+    Opcode opcode; 
+    // as written in the comments above (assembly is lower case) 
+    const char* mnemonic; 
+    InstructionFormat format; 
+    uint16_t flags; 
+    // loads and stores - bytes accessed 
+    byte width; 
+    // ADD..XORI - the result (of src1 and src2 or imm). BEQ..BGE - 1 if 
+    // the branch is taken. null for the rest 
+    int32_t (*compute) (int32_t a, int32_t b); 
+    // the same as a C++ operator, for generated code (SRL shifts an 
+    // unsigned value) 
+    const char* symbol; 
+};
+
+constexpr InstructionInfo instructionSet[NUM_OPCODES] = {
+    { OPCODE_UNDEFINED, "UNDEFINED", FORMAT_NONE,      ISA_HALTS,                                   0, nullptr, nullptr },
+    { OPCODE_LUI,       "LUI",       FORMAT_CONSTANT,  ISA_WRITES_DEST,                             0, nullptr, nullptr },
+    { OPCODE_LLI,       "LLI",       FORMAT_CONSTANT,  ISA_WRITES_DEST,                             0, nullptr, nullptr },
+    { OPCODE_LB,        "LB",        FORMAT_LOAD,      ISA_WRITES_DEST | ISA_LOADS,                 1, nullptr, nullptr },
+    { OPCODE_LH,        "LH",        FORMAT_LOAD,      ISA_WRITES_DEST | ISA_LOADS,                 2, nullptr, nullptr },
+    { OPCODE_LW,        "LW",        FORMAT_LOAD,      ISA_WRITES_DEST | ISA_LOADS,                 4, nullptr, nullptr },
+    { OPCODE_SB,        "SB",        FORMAT_STORE,     ISA_STORES,                                  1, nullptr, nullptr },
+    { OPCODE_SH,        "SH",        FORMAT_STORE,     ISA_STORES,                                  2, nullptr, nullptr },
+    { OPCODE_SW,        "SW",        FORMAT_STORE,     ISA_STORES,                                  4, nullptr, nullptr },
+    { OPCODE_ADD,       "ADD",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaAdd,  "+" },
+    { OPCODE_SUB,       "SUB",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaSub,  "-" },
+    { OPCODE_MUL,       "MUL",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaMul,  "*" },
+    { OPCODE_DIV,       "DIV",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaDiv,  "/" },
+    { OPCODE_MOD,       "MOD",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaMod,  "%" },
+    { OPCODE_SLL,       "SLL",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaSll,  "<<" },
+    { OPCODE_SRL,       "SRL",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaSrl,  ">>" },
+    { OPCODE_SRA,       "SRA",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaSra,  ">>" },
+    { OPCODE_OR,        "OR",        FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaOr,   "|" },
+    { OPCODE_AND,       "AND",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaAnd,  "&" },
+    { OPCODE_XOR,       "XOR",       FORMAT_REGISTERS, ISA_WRITES_DEST,                             0, isaXor,  "^" },
+    { OPCODE_ADDI,      "ADDI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaAdd,  "+" },
+    { OPCODE_SUBI,      "SUBI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaSub,  "-" },
+    { OPCODE_MULI,      "MULI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaMul,  "*" },
+    { OPCODE_DIVI,      "DIVI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaDiv,  "/" },
+    { OPCODE_MODI,      "MODI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaMod,  "%" },
+    { OPCODE_SLLI,      "SLLI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaSll,  "<<" },
+    { OPCODE_SRLI,      "SRLI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaSrl,  ">>" },
+    { OPCODE_SRAI,      "SRAI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaSra,  ">>" },
+    { OPCODE_ORI,       "ORI",       FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaOr,   "|" },
+    { OPCODE_ANDI,      "ANDI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaAnd,  "&" },
+    { OPCODE_XORI,      "XORI",      FORMAT_IMMEDIATE, ISA_WRITES_DEST,                             0, isaXor,  "^" },
+    { OPCODE_BEQ,       "BEQ",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaEq,   "==" },
+    { OPCODE_BNE,       "BNE",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaNe,   "!=" },
+    { OPCODE_BLT,       "BLT",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaLt,   "<" },
+    { OPCODE_BLE,       "BLE",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaLe,   "<=" },
+    { OPCODE_BGT,       "BGT",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaGt,   ">" },
+    { OPCODE_BGE,       "BGE",       FORMAT_BRANCH,    ISA_CONTROL | ISA_CONDITIONAL,               0, isaGe,   ">=" },
+    { OPCODE_JMP,       "JMP",       FORMAT_REGISTER,  ISA_CONTROL,                                 0, nullptr, nullptr },
+    { OPCODE_CALL,      "CALL",      FORMAT_REGISTER,  ISA_CONTROL | ISA_WRITES_SP | ISA_STORES,    4, nullptr, nullptr },
+    { OPCODE_RET,       "RET",       FORMAT_NONE,      ISA_CONTROL | ISA_WRITES_SP | ISA_LOADS,     4, nullptr, nullptr },
+    { OPCODE_PUSH,      "PUSH",      FORMAT_REGISTER,  ISA_WRITES_SP | ISA_STORES,                  4, nullptr, nullptr },
+    { OPCODE_POP,       "POP",       FORMAT_REGISTER,  ISA_WRITES_DEST | ISA_WRITES_SP | ISA_LOADS, 4, nullptr, nullptr },
+    { OPCODE_NOP,       "NOP",       FORMAT_NONE,      0,                                           0, nullptr, nullptr },
+    { OPCODE_HLT,       "HLT",       FORMAT_NONE,      ISA_HALTS,                                   0, nullptr, nullptr },
+    { OPCODE_GETCHAR,   "GETCHAR",   FORMAT_REGISTER,  ISA_WRITES_DEST | ISA_INPUT,                 0, nullptr, nullptr },
+    { OPCODE_PUTCHAR,   "PUTCHAR",   FORMAT_REGISTER,  ISA_OUTPUT,                                  0, nullptr, nullptr },
+};
+
+// true if every row is at its opcode 
+constexpr bool 
+isInstructionSetOrdered (unsigned int i = 0)
+{
+    return i == NUM_OPCODES || (instructionSet[i].opcode == i && isInstructionSetOrdered (i + 1));
+}
+static_assert (isInstructionSetOrdered (), "instructionSet rows must be in opcode order");
+
+// the row of an opcode (undefined opcodes share row 0) 
+constexpr const InstructionInfo& 
+instructionInfo (byte opcode)
+{
+    return instructionSet[opcode < NUM_OPCODES ? opcode : (byte)OPCODE_UNDEFINED]; 
+}
+
+constexpr bool 
+hasFlag (byte opcode, uint16_t flag)
+{
+    return (instructionInfo (opcode).flags & flag) != 0; 
+}
+
+// writes the assembly of the 4-byte instruction at address into text 
+// (at most size bytes) - e.g. "lw r1, -4(bp)" 
+void formatInstruction (const byte* memory, unsigned int address, char* text, size_t size);
+
+
+//========================================================================
+// Registers 
+
+// 2^4 32-bit (4-byte) registers
+// r0-r12  - general purpose registers (Callee Saved - saved on stack)
+// r13    0xd - return value  (ra)
+const byte ra = 13; 
+// r14    0xe - base pointer  (bp)
+const byte bp = 14;
+// r15    0xf - stack pointer (sp)
+const byte sp = 15; 
+
+//========================================================================
+// Machine state 
+
+// one instruction in the predecoded form the threaded engine executes 
+struct DecodedInstruction 
+{
+    // label of the handler that executes this instruction 
+    void* handler; 
+    // register fields (by position: dddd ssss ssss) 
+    byte dest; 
+    byte src1; 
+    byte src2; 
+    // DIVI/MODI by a constant - shift of the reciprocal below 
+    byte shift; 
+    // sign-extended 16-bit immediate/offset 
+    int imm; 
+    // number of instructions from this one to the end of its straight-line
+    // run (up to and including the next branch, CALL, RET, HLT or GETCHAR).
+    // the instruction budget is charged this much when a run is entered 
+    uint32_t runLength; 
+    // DIVI/MODI by a constant - the divisor's reciprocal, worked out once 
+    // for the record (see divideByReciprocal) 
+    uint32_t reciprocal; 
+};
+
+// why a call to run/step returned 
+enum RunResult : byte 
+{
+    // HLT, an invalid opcode, a load/store outside of memory, or ran 
+    // off the end of memory 
+    RUN_HALTED,
+    // retired the requested number of instructions 
+    RUN_BUDGET_EXHAUSTED,
+    // GETCHAR found no queued input - the GETCHAR runs again when 
+    // the machine resumes after provideInput/closeInput 
+    RUN_WAITING_FOR_INPUT
+};
+
+// the ways run can execute a program - all share MachineState and 
+// produce the same output, so they can be swapped between calls 
+enum Engine : byte 
+{
+    // decodes each instruction and walks an if/else chain 
+    ENGINE_REFERENCE,
+    // decodes each instruction and dispatches with a switch 
+    ENGINE_SWITCH,
+    // runs the predecoded program with computed gotos 
+    ENGINE_THREADED,
+    // translates basic blocks to x86-64 as they are reached (falls back 
+    // to the threaded engine on other hosts and with -d)
+    ENGINE_JIT,
+    // starts in the threaded engine and moves each block to the JIT once
+    // it has run often enough (falls back like ENGINE_JIT)
+    ENGINE_TIERED,
+    // compiles whole functions through the optimizing tier as they are 
+    // entered, and the blocks outside of them like ENGINE_JIT (falls back 
+    // like ENGINE_JIT)
+    ENGINE_OPT,
+    NUM_ENGINES
+};
+
+// the name of an engine as given to --engine= 
+const char* engineName (Engine engine);
+// the engine with the given name, or NUM_ENGINES if there is none 
+Engine engineByName (const char* name);
+
+// everything an executing program touches, kept in one struct with the 
+// register file and instruction register first so they share a cache line 
+struct MachineState 
+{
+    // 2^4 32-bit (4-byte) registers
+    int32_t registers[16]; 
+    // 4 byte (32-bit) instruction register - address of the next instruction 
+    uint32_t currentInstructionAddress; 
+    // set by HLT, an invalid opcode, a load/store outside of memory, or 
+    // running off the end of memory 
+    bool halted; 
+    // total instructions executed since the last reset 
+    uint64_t instructionsRetired; 
+    // guest memory 
+    byte* memory; 
+    size_t memorySize; 
+    // memory sits in a reserved window of everything a guest address can 
+    // reach, so accesses outside of it fault (see AmyMachine in 
+    // amyMachine.cpp) - false if the window could not be had 
+    bool guarded; 
+    // number of bytes at the start of memory holding the loaded program 
+    uint32_t codeSize; 
+    // program predecoded by the threaded engine (one record per word of
+    // the program) and the handler table it was decoded with 
+    DecodedInstruction* code; 
+    void** codeHandlers; 
+    // the loaded program passed verify - the threaded engine may jump 
+    // straight to the branch targets built by LUI/LLI pairs 
+    bool verified; 
+    // bumped whenever a store writes to the program or it is reloaded 
+    uint32_t codeVersion; 
+    // a store has written to the program since the last reset - it no 
+    // longer matches the image the cache describes 
+    bool codeWritten; 
+    // code translated by the JIT engine (null until it first runs)
+    struct JitState* jit; 
+    // block entries counted by the tiered engine (one per word of the 
+    // program, null until it first runs)
+    uint32_t* hotness; 
+    // per-program work saved on disk for the loaded image (null unless 
+    // AmyMachine::useCache gave a directory)
+    struct ProgramCache* cache; 
+    // bytes queued for GETCHAR - input[inputPosition..inputSize) are unread 
+    byte* input; 
+    size_t inputPosition; 
+    size_t inputSize; 
+    size_t inputCapacity; 
+    // no more input is coming - GETCHAR reads EOF (-1) once input runs out 
+    bool inputClosed; 
+};
+
+//========================================================================
+// AmyMachine 
+// a reentrant machine - load a program image once, then run and reset 
+// it as many times as needed without reallocating guest memory 
+
+// largest guest memory - addresses are signed 32-bit offsets, so sp has
+// to start below 2^31. memory is mapped demand-zero, so a large memory
+// only costs the pages the program touches
+const size_t MAX_MEMORY_SIZE = INT32_MAX; 
+
+class AmyMachine 
+{
+public:
+
+    MachineState state; 
+    // print each instruction and the register file as it executes 
+    bool debug; 
+    // which engine run uses (tiered by default)
+    Engine engine; 
+
+    // bp and sp start at the end of memory (rounded down to 4 bytes).
+    // memory is mapped in whole pages, so the rest of its last page 
+    // (memorySize up to the next multiple of the page size) can be read 
+    // and written like memory too - only accesses past that page stop 
+    // the machine with "Invalid address" (with 4 KB pages the default 
+    // 1000000 bytes, 0xf4240, can be accessed up to 0xf5000). 
+    // if memorySize is over MAX_MEMORY_SIZE or cannot be mapped the
+    // machine says so and has no memory - it stays halted 
+    AmyMachine (size_t memorySize = 1000000);
+    ~AmyMachine ();
+
+    AmyMachine (const AmyMachine&) = delete; 
+    AmyMachine& operator= (const AmyMachine&) = delete; 
+
+    // copies a program image to address 0 and resets the machine. 
+    // returns false (and keeps what was loaded) if the image does not 
+    // fit in memory 
+    bool load (const byte* image, size_t size);
+    // returns the machine to how it was right after load - 
+    // zeroed memory and registers with the image back in place 
+    void reset ();
+    // runs with the selected engine until the program halts, GETCHAR
+    // needs input, or maxInstructions instructions have retired. 
+    // the machine can be resumed by calling run again 
+    RunResult run (uint64_t maxInstructions = UINT64_MAX);
+    // executes at most n instructions with the reference engine 
+    RunResult step (uint64_t n = 1);
+    // checks the loaded program before it runs - every instruction 
+    // reachable from address 0 must have a defined opcode, every branch
+    // target built with a LUI/LLI pair must be an instruction of the 
+    // program, and no store may be known to write to the program. 
+    // prints each problem (and, with debug, what could not be followed)
+    // and lets run use the unchecked fast path if there are none 
+    bool verify ();
+    // the blocks and functions of the loaded program, found by following
+    // the constants that build branch targets (built on first use)
+    const struct ControlFlowGraph* controlFlow ();
+    // translates the loaded program into C++ and compiles it with g++
+    // into a native executable at outputPath (see amyAot.h)
+    bool compileNative (const char* outputPath);
+    // keeps the predecoded program and the control flow graph in a file 
+    // in directory named after a hash of the image (see amyCache.h), so 
+    // later processes loading the same image skip that work. covers the 
+    // loaded program and every one loaded after 
+    void useCache (const char* directory);
+
+    // queues bytes for GETCHAR to read 
+    void provideInput (const byte* data, size_t size);
+    // marks the end of the input - GETCHAR reads EOF from then on 
+    void closeInput ();
+
+private:
+
+    // copy of the loaded image for reset 
+    byte* image; 
+    size_t imageSize; 
+    // control flow graph of image (null until asked for)
+    struct ControlFlowGraph* cfg; 
+    // directory given to useCache (null if there is none)
+    char* cacheDirectory; 
+};
+
+//========================================================================
+
+void printMemory (byte* memory, size_t memory_size, int bytesPerLine=4);
+
+//========================================================================
+
+#endif
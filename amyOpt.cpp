@@ -0,0 +1,3290 @@
+// AmyMachine optimizing tier
+// compiles whole functions of the program (as the control flow graph
+// finds them) through an SSA form - constants are folded, dead register
+// writes dropped, stack slots kept in host registers and pushes/pops
+// that only save and restore a register forwarded - and emits x86-64
+// code that runs alongside the JIT's blocks and traces
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstring>   //memset
+#include <algorithm> //sort
+
+#include "amyOpt.h"
+#include "amyCfg.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+//========================================================================
+// Overview
+// a function is compiled from the blocks the control flow graph finds
+// reachable from its entry (following branches and jumps, not calls).
+// the dispatcher can enter it at the entry, after each CALL (where the
+// callee returns to) and after each GETCHAR/PUTCHAR (which are left to
+// the interpreter) - each of these gets an entry block that checks what
+// the code assumes about the frame and loads what it uses.
+// the instructions are lifted to SSA values on the fly, in reverse
+// postorder (Braun et al.'s construction):
+//  - guest registers are variables, and so are stack slots - aligned
+//    words at a fixed offset from the frame an entry finds (sp at the
+//    function entry, bp everywhere else). a slot is read from memory at
+//    most once, at the entry, and then lives in a host register
+//  - LUI/LLI, the immediate forms and anything built from constants
+//    fold away. values carry their known bits, so an LUI/LLI pair is a
+//    constant even when the register's old value was not
+//  - a variable is only written back where something can see it - at
+//    exits (registers and slots) and where control leaves the region of
+//    the entry a slot belongs to. nothing else reads them, so writes
+//    overwritten before any of those points never happen. a load or
+//    store through any other address checks it misses the region's
+//    slots, and leaves to have the JIT run it if it does not. in a
+//    loop whose addresses move by a constant step, that check (and the
+//    one a store makes for writes to the program) is made once, before
+//    the loop (see Loops)
+//  - popped slots are written back like any other slot - a program may
+//    read below sp, and the other engines leave what was pushed there.
+//    the push of a callee-saved register that is popped unchanged costs
+//    one store at the exit, and the pop gets the value the register
+//    still has
+// the values left are given host registers by linear scan (with the
+// JitContext's spills for the rest) and compiled like the JIT's blocks -
+// each block charges the budget on entry and every exit writes back
+// what it has to and goes on through the dispatcher
+
+// a function needing more than these is left to the JIT
+const unsigned int MAX_OPT_INSTRUCTIONS = 4096;
+const unsigned int MAX_OPT_BLOCKS = 2048;
+const unsigned int MAX_OPT_ENTRIES = 256;
+const unsigned int MAX_OPT_SLOTS = 32;
+const unsigned int MAX_OPT_VALUES = 1 << 17;
+const unsigned int MAX_OPT_INPUTS = 1 << 18;
+const unsigned int MAX_OPT_EXITS = 1 << 15;
+const unsigned int MAX_OPT_FLUSHES = 1 << 18;
+const unsigned int MAX_OPT_RANGES = 1024;
+const unsigned int MAX_OPT_BYTE_LOOPS = 256;
+// room a function may need, and the most one op (with its write backs
+// or moves) compiles to
+const size_t MAX_OPT_BYTES = 8 << 20;
+const size_t MAX_OPT_OP_BYTES = 4096;
+// registers, then slots
+const unsigned int NUM_VARS = 16 + MAX_OPT_SLOTS;
+const uint32_t NONE = 0xffffffff;
+// what memory holds at the end of a block not looked at yet
+const uint32_t UNSEEN = 0xfffffffe;
+// the root of the dominator tree, above every entry block
+const uint32_t ROOT = 0xfffffffd;
+
+// host registers values can live in - esi, edi, r8d-r11d. a location
+// below NUM_OPT_HOSTS is one of these, IN_ECX is the scratch register
+// ecx and SPILLED + i is the JitContext's spill i
+static const byte optHosts[] = { 6, 7, 8, 9, 10, 11 };
+const uint32_t NUM_OPT_HOSTS = sizeof(optHosts);
+const uint32_t IN_ECX = 8;
+const uint32_t SPILLED = 16;
+
+//========================================================================
+// IR
+
+enum OptOp : byte
+{
+    // values
+    OP_CONST,
+    // a variable's value where an entry block is entered (a register
+    // from the frame, a slot from memory)
+    OP_ENTRY,
+    OP_PHI,
+    // a <opcode> b for ADD..XOR
+    OP_BINARY,
+    // [a + imm] for LB/LH/LW
+    OP_LOAD,
+    // the iterations of a byte loop entered after the block that can be
+    // run at once - a is the address its first load reads, b the one its
+    // first store writes (or NONE), imm its OptByteLoop (see Byte loops)
+    OP_BYTE_LOOP,
+    // the rest have no value
+    // var <- a - where a variable is written
+    OP_SET,
+    // [a + imm] <- b for SB/SH/SW, leaving with EXIT_STORE if it wrote
+    // to the program (extra is the exit, or NONE if it cannot)
+    OP_STORE,
+    // checks what an entry block assumes
+    OP_GUARD,
+    // checks the loads/stores of the loop after the block from where
+    // a + b (b may be NONE) starts - imm is its OptRange (see Loops)
+    OP_RANGE_CHECK,
+    // leaves if a <opcode> b for BEQ..BGE
+    OP_EXIT_IF,
+    // these end a block
+    OP_EXIT,
+    // goes to successor opcode
+    OP_JUMP,
+    // goes to successor 1 if a <opcode> b, and to successor 0 otherwise
+    OP_BRANCH
+};
+
+struct OptValue
+{
+    OptOp op;
+    byte opcode;
+    byte var;
+    bool live;
+    // phis - inputs still to be added when the block is sealed
+    bool incomplete;
+    uint32_t block;
+    uint32_t a;
+    uint32_t b;
+    int32_t imm;
+    // bits known at compile time, and their values
+    uint32_t knownBits;
+    uint32_t bits;
+    // phis - the first of their inputs (one per predecessor). exits,
+    // flushes, guards and checked stores - their OptExit
+    uint32_t extra;
+    // the next phi of the block
+    uint32_t next;
+    // a trivial phi - the value it stands for
+    uint32_t replacement;
+    // loads and stores in a region - the OptExit taken before they touch
+    // one of its slots, or NONE
+    uint32_t alias;
+    // loads and stores - the OptExit taken if the access faults (see
+    // leaveTranslatedCode)
+    uint32_t fault;
+    // allocation - the value's index among the allocated ones, where it
+    // lives, and the positions it is live between
+    uint32_t index;
+    uint32_t location;
+    uint32_t from;
+    uint32_t to;
+};
+
+// where the dispatcher is sent - also used for the write backs of
+// flushes and edges leaving a region
+struct OptExit
+{
+    // the next pc - the value pcValue, or pc if that is NONE
+    uint32_t pcValue;
+    uint32_t pc;
+    uint32_t refund;
+    JitExit reason;
+    // variables to write back first (into Optimizer::flushes)
+    uint32_t flushes;
+    uint32_t numFlushes;
+    // its code, once compiled out of line
+    byte* code;
+};
+
+struct OptFlush
+{
+    uint32_t var;
+    uint32_t value;
+};
+
+// what the addresses of a loop are kept clear of
+enum RangeKind : byte
+{
+    // the slots of the region
+    RANGE_SLOTS,
+    // the program (stores)
+    RANGE_PROGRAM
+};
+
+// the loads/stores of a loop through one induction variable, checked
+// where the loop is entered (see Loops)
+struct OptRange
+{
+    RangeKind kind;
+    // the direction the addresses move in, and the log2 of the most
+    // they move by in an iteration (rounded up)
+    bool up;
+    byte shift;
+    // the lowest and highest offset of the accesses from the variable
+    int32_t lowest;
+    int32_t highest;
+    // instructions the budget is charged for every iteration
+    uint32_t perIteration;
+};
+
+// a loop that walks a string a byte at a time (see Byte loops)
+struct OptByteLoop
+{
+    // stores each byte it loads
+    bool copy;
+    // leaves at the first byte that is terminator, or at the first that
+    // is not
+    bool untilEqual;
+    byte terminator;
+    // instructions the budget is charged for every iteration
+    uint32_t perIteration;
+};
+
+enum BlockKind : byte
+{
+    // instructions of the function
+    BLOCK_CODE,
+    // the taken side of a branch - goes on to where the control flow
+    // graph says the branch goes if the target register agrees
+    BLOCK_TARGET,
+    // where the dispatcher enters the function
+    BLOCK_ENTRY
+};
+
+// how a code block ends
+enum BlockEnd : byte
+{
+    // falls through to successor 0
+    END_FALL,
+    // its last instruction branches, jumps, calls or returns
+    END_CONTROL,
+    // the instruction after it is left to the interpreter
+    END_STOP
+};
+
+struct OptBlock
+{
+    BlockKind kind;
+    BlockEnd end;
+    // target blocks - the register holding the branch target
+    byte target;
+    byte numSuccessors;
+    // code blocks - the first instruction. entry blocks - the pc they
+    // are entered at
+    uint32_t start;
+    // instructions (charged on entry)
+    uint32_t length;
+    uint32_t successors[2];
+    // into Optimizer::predecessors
+    uint32_t predecessors;
+    uint32_t numPredecessors;
+    // entry blocks - their entry. code blocks ending in a CALL or before
+    // a GETCHAR/PUTCHAR - the entry the function is resumed at after it
+    uint32_t entry;
+    // the entry whose block dominates it (every path to it comes through
+    // there), or NONE
+    uint32_t region;
+    // position in reverse postorder (NONE if it cannot be reached) and
+    // immediate dominator
+    uint32_t order;
+    uint32_t idom;
+    // into Optimizer::ops
+    uint32_t firstOp;
+    uint32_t numOps;
+    uint32_t phis;
+    uint32_t budgetExit;
+    // write backs of edges leaving its region, for each successor
+    uint32_t edgeFlushes[2];
+    bool filled;
+    bool sealed;
+    // code generation
+    byte* code;
+    uint32_t startPosition;
+    uint32_t endPosition;
+};
+
+struct OptEntry
+{
+    uint32_t pc;
+    uint32_t block;
+    // register the entry's slots are relative to
+    byte frame;
+    // sp is bp + relation here (after a CALL whose frame says so)
+    bool related;
+    int32_t relation;
+    // the frame register's value at the entry
+    uint32_t frameValue;
+    // the lowest and highest offset of its slots, if it has any
+    bool hasSlots;
+    int32_t lowest;
+    int32_t highest;
+};
+
+// a jump to a block or an out of line exit, patched once that is compiled
+struct Fixup
+{
+    byte* displacement;
+    uint32_t target;
+};
+
+struct Optimizer
+{
+    // the program's control flow graph, from state.codeVersion
+    // cfgVersion
+    ControlFlowGraph* cfg;
+    uint32_t cfgVersion;
+    uint32_t codeSize;
+    // 1 for each word of the program that enters a function not tried
+    // since the translated code was last thrown away
+    byte* candidates;
+    // block of the function being compiled starting at each word
+    uint32_t* blockAt;
+    // control flow graph blocks of the function
+    byte* cfgSeen;
+    uint32_t* cfgList;
+
+    // the function being compiled
+    JitState* jit;
+    byte* memory;
+    size_t memorySize;
+    bool failed;
+    OptBlock blocks[MAX_OPT_BLOCKS];
+    uint32_t numBlocks;
+    uint32_t predecessors[2 * MAX_OPT_BLOCKS];
+    uint32_t order[MAX_OPT_BLOCKS];
+    uint32_t numOrdered;
+    OptEntry entries[MAX_OPT_ENTRIES];
+    uint32_t numEntries;
+    // each slot - its entry and offset from the entry's frame
+    uint32_t slotEntry[MAX_OPT_SLOTS];
+    int32_t slotOffset[MAX_OPT_SLOTS];
+    uint32_t numSlots;
+    bool slotsChanged;
+
+    OptValue values[MAX_OPT_VALUES];
+    uint32_t numValues;
+    uint32_t ops[MAX_OPT_VALUES];
+    uint32_t numOps;
+    uint32_t inputs[MAX_OPT_INPUTS];
+    uint32_t numInputs;
+    OptExit exits[MAX_OPT_EXITS];
+    uint32_t numExits;
+    OptFlush flushes[MAX_OPT_FLUSHES];
+    uint32_t numFlushes;
+    OptRange ranges[MAX_OPT_RANGES];
+    uint32_t numRanges;
+    OptByteLoop byteLoops[MAX_OPT_BYTE_LOOPS];
+    uint32_t numByteLoops;
+    // block being filled
+    uint32_t current;
+    // each block's variables - at its start, as it is filled (and at its
+    // end once it is), and what memory holds for them at its end
+    uint32_t inDefs[MAX_OPT_BLOCKS * NUM_VARS];
+    uint32_t defs[MAX_OPT_BLOCKS * NUM_VARS];
+    uint32_t memOut[MAX_OPT_BLOCKS * NUM_VARS];
+
+    // code generation
+    Emitter e;
+    byte* limit;
+    uint32_t positions[MAX_OPT_VALUES];
+    Fixup fixups[4 * MAX_OPT_BLOCKS];
+    uint32_t numFixups;
+    Fixup exitJumps[MAX_OPT_EXITS];
+    uint32_t numExitJumps;
+};
+
+//========================================================================
+// Values
+
+inline uint32_t
+find (Optimizer& c, uint32_t v)
+{
+    while (c.values[v].replacement != NONE) v = c.values[v].replacement;
+    return v;
+}
+
+inline bool
+isConstant (Optimizer& c, uint32_t v)
+{
+    return c.values[v].knownBits == 0xffffffff;
+}
+
+uint32_t
+newValue (Optimizer& c, OptOp op)
+{
+    if (c.numValues == MAX_OPT_VALUES)
+    {
+        c.failed = true;
+        return 0;
+    }
+    uint32_t v = c.numValues++;
+    OptValue& x = c.values[v];
+    std::memset (&x, 0, sizeof(x));
+    x.op = op;
+    x.block = c.current;
+    x.a = x.b = x.extra = x.next = x.replacement = x.alias = x.fault = x.location = NONE;
+    return v;
+}
+
+// appends op to the block being filled
+void
+addOp (Optimizer& c, uint32_t v)
+{
+    if (c.numOps == MAX_OPT_VALUES) c.failed = true;
+    else c.ops[c.numOps++] = v;
+}
+
+uint32_t
+constant (Optimizer& c, uint32_t k)
+{
+    uint32_t v = newValue (c, OP_CONST);
+    c.values[v].knownBits = 0xffffffff;
+    c.values[v].bits = k;
+    c.values[v].imm = k;
+    return v;
+}
+
+// the known bits of a <opcode> b from the known bits of a and b
+void
+knownBitsOf (Optimizer& c, byte opcode, uint32_t a, uint32_t b, uint32_t* known, uint32_t* bits)
+{
+    const OptValue& x = c.values[a];
+    const OptValue& y = c.values[b];
+    uint32_t ones = 0;
+    uint32_t zeros = 0;
+    switch (opcode)
+    {
+        case OPCODE_AND:
+            ones = (x.knownBits & x.bits) & (y.knownBits & y.bits);
+            zeros = (x.knownBits & ~x.bits) | (y.knownBits & ~y.bits);
+            break;
+        case OPCODE_OR:
+            ones = (x.knownBits & x.bits) | (y.knownBits & y.bits);
+            zeros = (x.knownBits & ~x.bits) & (y.knownBits & ~y.bits);
+            break;
+        case OPCODE_XOR:
+            ones = x.knownBits & y.knownBits & (x.bits ^ y.bits);
+            zeros = x.knownBits & y.knownBits & ~(x.bits ^ y.bits);
+            break;
+        case OPCODE_SLL:
+        case OPCODE_SRL:
+        case OPCODE_SRA:
+        {
+            if (y.knownBits != 0xffffffff) break;
+            uint32_t count = y.bits & 31;
+            if (opcode == OPCODE_SLL)
+            {
+                ones = (x.knownBits & x.bits) << count;
+                zeros = ((x.knownBits & ~x.bits) << count) | ((1u << count) - 1);
+            }
+            else
+            {
+                ones = (x.knownBits & x.bits) >> count;
+                zeros = (x.knownBits & ~x.bits) >> count;
+                uint32_t high = ~(0xffffffffu >> count);
+                if (opcode == OPCODE_SRL) zeros |= high;
+                else if (x.knownBits & 0x80000000)
+                {
+                    // the sign is known, and so are the bits it fills
+                    if (x.bits & 0x80000000) ones |= high;
+                    else                     zeros |= high;
+                }
+            }
+            break;
+        }
+    }
+    *known = ones | zeros;
+    *bits = ones;
+}
+
+// the value of a <opcode> b for ADD..XOR - folded where the known bits
+// or the identities of the operation allow
+uint32_t
+binary (Optimizer& c, byte opcode, uint32_t a, uint32_t b)
+{
+    a = find (c, a);
+    b = find (c, b);
+    uint32_t result;
+    if (isConstant (c, a) && isConstant (c, b) && evaluate (opcode, c.values[a].bits, c.values[b].bits, &result))
+        return constant (c, result);
+    // constants go on the right of commutative operations
+    bool commutative = opcode == OPCODE_ADD || opcode == OPCODE_MUL || opcode == OPCODE_OR
+        || opcode == OPCODE_AND || opcode == OPCODE_XOR;
+    if (commutative && isConstant (c, a) && !isConstant (c, b))
+    {
+        uint32_t swap = a;
+        a = b;
+        b = swap;
+    }
+    if (isConstant (c, b))
+    {
+        uint32_t k = c.values[b].bits;
+        // subtracting a constant is adding its negation, so offsets from
+        // a base all look alike
+        if (opcode == OPCODE_SUB)
+        {
+            opcode = OPCODE_ADD;
+            k = 0 - k;
+            b = constant (c, k);
+        }
+        switch (opcode)
+        {
+            case OPCODE_ADD:
+            case OPCODE_OR:
+            case OPCODE_XOR:
+                if (k == 0) return a;
+                break;
+            case OPCODE_SLL:
+            case OPCODE_SRL:
+            case OPCODE_SRA:
+                if ((k & 31) == 0) return a;
+                break;
+            case OPCODE_AND:
+                if (k == 0xffffffff) return a;
+                if (k == 0) return constant (c, 0);
+                break;
+            case OPCODE_MUL:
+                if (k == 1) return a;
+                if (k == 0) return constant (c, 0);
+                break;
+            case OPCODE_DIV:
+                if (k == 1) return a;
+                break;
+        }
+        // a chain of constant additions is one
+        const OptValue& x = c.values[a];
+        if (opcode == OPCODE_ADD && x.op == OP_BINARY && x.opcode == OPCODE_ADD && isConstant (c, find (c, x.b)))
+            return binary (c, OPCODE_ADD, x.a, constant (c, k + c.values[find (c, x.b)].bits));
+    }
+
+    uint32_t known;
+    uint32_t bits;
+    knownBitsOf (c, opcode, a, b, &known, &bits);
+    if (known == 0xffffffff) return constant (c, bits);
+    uint32_t v = newValue (c, OP_BINARY);
+    OptValue& x = c.values[v];
+    x.opcode = opcode;
+    x.a = a;
+    x.b = b;
+    x.knownBits = known;
+    x.bits = bits;
+    addOp (c, v);
+    return v;
+}
+
+// the value v is a constant offset from - *offset is the offset
+uint32_t
+baseOf (Optimizer& c, uint32_t v, int32_t* offset)
+{
+    int32_t total = 0;
+    v = find (c, v);
+    while (c.values[v].op == OP_BINARY && c.values[v].opcode == OPCODE_ADD && isConstant (c, find (c, c.values[v].b)))
+    {
+        total += c.values[find (c, c.values[v].b)].bits;
+        v = find (c, c.values[v].a);
+    }
+    if (isConstant (c, v))
+    {
+        *offset = total + c.values[v].bits;
+        return NONE;
+    }
+    *offset = total;
+    return v;
+}
+
+// the entry whose frame v is at *offset from, or NONE
+uint32_t
+frameOf (Optimizer& c, uint32_t v, int32_t* offset)
+{
+    uint32_t base = baseOf (c, v, offset);
+    if (base == NONE || c.values[base].op != OP_ENTRY) return NONE;
+    uint32_t e = c.blocks[c.values[base].block].entry;
+    return c.values[base].var == c.entries[e].frame ? e : NONE;
+}
+
+//========================================================================
+// SSA construction
+// Braun et al., "Simple and Efficient Construction of Static Single
+// Assignment Form" - a variable read in a block with several
+// predecessors becomes a phi, which is removed again if all of its
+// inputs turn out to be the same value. blocks are sealed once all of
+// their predecessors are filled
+
+uint32_t readVariable (Optimizer& c, uint32_t var, uint32_t b);
+
+inline void
+writeVariable (Optimizer& c, uint32_t var, uint32_t b, uint32_t v)
+{
+    c.defs[b * NUM_VARS + var] = v;
+}
+
+uint32_t
+newPhi (Optimizer& c, uint32_t var, uint32_t b)
+{
+    uint32_t saved = c.current;
+    c.current = b;
+    uint32_t v = newValue (c, OP_PHI);
+    c.current = saved;
+    OptBlock& block = c.blocks[b];
+    OptValue& x = c.values[v];
+    x.var = var;
+    if (c.numInputs + block.numPredecessors > MAX_OPT_INPUTS)
+    {
+        c.failed = true;
+        x.extra = 0;
+    }
+    else
+    {
+        x.extra = c.numInputs;
+        c.numInputs += block.numPredecessors;
+    }
+    x.next = block.phis;
+    block.phis = v;
+    return v;
+}
+
+// the phi's only input other than itself, or NONE
+uint32_t
+trivialInput (Optimizer& c, uint32_t phi)
+{
+    OptValue& x = c.values[phi];
+    uint32_t same = NONE;
+    for (uint32_t i = 0; i < c.blocks[x.block].numPredecessors; ++i)
+    {
+        uint32_t input = find (c, c.inputs[x.extra + i]);
+        if (input == same || input == phi) continue;
+        if (same != NONE) return NONE;
+        same = input;
+    }
+    return same;
+}
+
+uint32_t
+tryRemoveTrivialPhi (Optimizer& c, uint32_t phi)
+{
+    uint32_t same = trivialInput (c, phi);
+    if (same == NONE) return phi;
+    c.values[phi].replacement = same;
+    return same;
+}
+
+uint32_t
+addPhiOperands (Optimizer& c, uint32_t phi)
+{
+    OptValue& x = c.values[phi];
+    OptBlock& block = c.blocks[x.block];
+    for (uint32_t i = 0; i < block.numPredecessors; ++i)
+        c.inputs[x.extra + i] = readVariable (c, x.var, c.predecessors[block.predecessors + i]);
+    return tryRemoveTrivialPhi (c, phi);
+}
+
+// the value of var where entry block b is entered
+uint32_t
+entryValue (Optimizer& c, uint32_t var, uint32_t b)
+{
+    OptBlock& block = c.blocks[b];
+    if (block.kind != BLOCK_ENTRY || (var >= 16 && c.slotEntry[var - 16] != block.entry))
+    {
+        c.failed = true;
+        return 0;
+    }
+    uint32_t saved = c.current;
+    c.current = b;
+    uint32_t v = newValue (c, OP_ENTRY);
+    c.current = saved;
+    c.values[v].var = var;
+    return v;
+}
+
+uint32_t
+readVariable (Optimizer& c, uint32_t var, uint32_t b)
+{
+    uint32_t v = c.defs[b * NUM_VARS + var];
+    if (v != NONE) return find (c, v);
+    OptBlock& block = c.blocks[b];
+    if (!block.sealed)
+    {
+        v = newPhi (c, var, b);
+        c.values[v].incomplete = true;
+    }
+    else if (block.numPredecessors == 0) v = entryValue (c, var, b);
+    else if (block.numPredecessors == 1) v = readVariable (c, var, c.predecessors[block.predecessors]);
+    else
+    {
+        // written first so a loop back to b finds it
+        v = newPhi (c, var, b);
+        writeVariable (c, var, b, v);
+        v = addPhiOperands (c, v);
+    }
+    writeVariable (c, var, b, v);
+    return v;
+}
+
+void
+sealBlock (Optimizer& c, uint32_t b)
+{
+    for (uint32_t phi = c.blocks[b].phis; phi != NONE; phi = c.values[phi].next)
+    {
+        if (!c.values[phi].incomplete) continue;
+        c.values[phi].incomplete = false;
+        addPhiOperands (c, phi);
+    }
+    c.blocks[b].sealed = true;
+}
+
+// removes phis that only became trivial after they were made (when
+// their inputs were removed)
+void
+removeTrivialPhis (Optimizer& c)
+{
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t v = 0; v < c.numValues; ++v)
+        {
+            if (c.values[v].op != OP_PHI || c.values[v].replacement != NONE) continue;
+            if (tryRemoveTrivialPhi (c, v) != v) changed = true;
+        }
+    }
+}
+
+//========================================================================
+// Lifting
+
+inline bool
+inScope (Optimizer& c, uint32_t b, uint32_t var)
+{
+    return var < 16 || (c.blocks[b].region != NONE && c.slotEntry[var - 16] == c.blocks[b].region);
+}
+
+inline uint32_t
+read (Optimizer& c, uint32_t var)
+{
+    return readVariable (c, var, c.current);
+}
+
+void
+write (Optimizer& c, uint32_t var, uint32_t v)
+{
+    writeVariable (c, var, c.current, v);
+    uint32_t set = newValue (c, OP_SET);
+    c.values[set].var = var;
+    c.values[set].a = v;
+    addOp (c, set);
+}
+
+uint32_t
+newExit (Optimizer& c, uint32_t pcValue, uint32_t pc, uint32_t refund, JitExit reason)
+{
+    if (c.numExits == MAX_OPT_EXITS)
+    {
+        c.failed = true;
+        return 0;
+    }
+    OptExit& x = c.exits[c.numExits];
+    x.pcValue = pcValue;
+    x.pc = pc;
+    x.refund = refund;
+    x.reason = reason;
+    x.flushes = 0;
+    x.numFlushes = 0;
+    x.code = nullptr;
+    return c.numExits++;
+}
+
+// an op with no value
+uint32_t
+addControl (Optimizer& c, OptOp op, byte opcode, uint32_t a, uint32_t b, uint32_t extra)
+{
+    uint32_t v = newValue (c, op);
+    OptValue& x = c.values[v];
+    x.opcode = opcode;
+    x.a = a;
+    x.b = b;
+    x.extra = extra;
+    addOp (c, v);
+    return v;
+}
+
+// the slot at v + offset, or NONE if it is not one
+uint32_t
+slotAt (Optimizer& c, uint32_t v, int32_t offset)
+{
+    int32_t frameOffset;
+    uint32_t e = frameOf (c, v, &frameOffset);
+    if (e == NONE || e != c.blocks[c.current].region) return NONE;
+    frameOffset += offset;
+    if (frameOffset % 4 != 0) return NONE;
+    for (uint32_t s = 0; s < c.numSlots; ++s)
+        if (c.slotEntry[s] == e && c.slotOffset[s] == frameOffset) return s;
+    if (c.numSlots == MAX_OPT_SLOTS) return NONE;
+    c.slotEntry[c.numSlots] = e;
+    c.slotOffset[c.numSlots] = frameOffset;
+    c.slotsChanged = true;
+    return c.numSlots++;
+}
+
+uint32_t entryAt (Optimizer& c, uint32_t pc);
+
+// the exit taken before a load/store at pc that touches one of the
+// slots of the block's region - slots live in host registers, so the
+// access is left to the JIT with everything written back. at an entry
+// the dispatcher would come straight back here, so the interpreter
+// runs it instead
+uint32_t
+aliasExit (Optimizer& c, uint32_t pc, uint32_t refund)
+{
+    if (c.blocks[c.current].region == NONE) return NONE;
+    JitExit reason = entryAt (c, pc) != NONE ? EXIT_INTERPRET : EXIT_LOOKUP;
+    return newExit (c, NONE, pc, refund + 1, reason);
+}
+
+// the exit taken if a load/store at pc faults - the instruction runs
+// again in the interpreter, which stops the machine on it
+inline uint32_t
+faultExit (Optimizer& c, uint32_t pc, uint32_t refund)
+{
+    return newExit (c, NONE, pc, refund + 1, EXIT_INTERPRET);
+}
+
+// true for a load or store that checks it misses the slots of its
+// region
+inline bool
+isAliasChecked (Optimizer& c, const OptValue& x)
+{
+    return x.alias != NONE && c.entries[c.blocks[x.block].region].hasSlots;
+}
+
+// [address + offset] for LB/LH/LW at pc
+uint32_t
+load (Optimizer& c, byte opcode, uint32_t address, int32_t offset, uint32_t pc, uint32_t refund)
+{
+    if (opcode == OPCODE_LW)
+    {
+        uint32_t s = slotAt (c, address, offset);
+        if (s != NONE) return read (c, 16 + s);
+    }
+    uint32_t v = newValue (c, OP_LOAD);
+    c.values[v].opcode = opcode;
+    c.values[v].a = find (c, address);
+    c.values[v].imm = offset;
+    c.values[v].alias = aliasExit (c, pc, refund);
+    c.values[v].fault = faultExit (c, pc, refund);
+    // LB zero-extends
+    if (opcode == OPCODE_LB) c.values[v].knownBits = 0xffffff00;
+    addOp (c, v);
+    return v;
+}
+
+// [address + offset] <- value for SB/SH/SW at pc. checked stores leave
+// if they wrote to the program. returns false if it wrote a slot
+bool
+store (Optimizer& c, byte opcode, uint32_t address, int32_t offset, uint32_t value, bool checked, uint32_t pc, uint32_t refund)
+{
+    if (opcode == OPCODE_SW)
+    {
+        uint32_t s = slotAt (c, address, offset);
+        if (s != NONE)
+        {
+            write (c, 16 + s, value);
+            return false;
+        }
+    }
+    uint32_t exit = checked ? newExit (c, NONE, pc + 4, refund, EXIT_STORE) : NONE;
+    uint32_t v = addControl (c, OP_STORE, opcode, find (c, address), find (c, value), exit);
+    c.values[v].imm = offset;
+    c.values[v].alias = aliasExit (c, pc, refund);
+    c.values[v].fault = faultExit (c, pc, refund);
+    return true;
+}
+
+// leaves for pcValue (or pc) with EXIT_STORE if a PUSH/CALL that missed
+// the slots wrote to the program - it leaves once sp has moved, which a
+// store's own exit cannot (its fault exit needs the old sp). slots are
+// above the program, the entry guard checks that
+void
+checkPush (Optimizer& c, uint32_t top, uint32_t pcValue, uint32_t pc, uint32_t refund)
+{
+    top = find (c, top);
+    if (isConstant (c, top) && (int32_t)c.values[top].bits >= (int32_t)c.codeSize) return;
+    if (pcValue != NONE && isConstant (c, find (c, pcValue)))
+    {
+        pc = c.values[find (c, pcValue)].bits;
+        pcValue = NONE;
+    }
+    if (pcValue != NONE) pcValue = find (c, pcValue);
+    addControl (c, OP_EXIT_IF, OPCODE_BLT, top, constant (c, c.codeSize),
+        newExit (c, pcValue, pc, refund, EXIT_STORE));
+}
+
+void
+exitTo (Optimizer& c, uint32_t pcValue, uint32_t pc, uint32_t refund)
+{
+    if (pcValue != NONE && isConstant (c, find (c, pcValue)))
+    {
+        pc = c.values[find (c, pcValue)].bits;
+        pcValue = NONE;
+    }
+    if (pcValue != NONE) pcValue = find (c, pcValue);
+    addControl (c, OP_EXIT, 0, NONE, NONE, newExit (c, pcValue, pc, refund, EXIT_LOOKUP));
+}
+
+// goes to the block's successor 0 if target is where the control flow
+// graph says it goes, and leaves otherwise
+void
+goTo (Optimizer& c, uint32_t target, uint32_t refund)
+{
+    OptBlock& block = c.blocks[c.current];
+    target = find (c, target);
+    bool internal = block.numSuccessors > 0;
+    uint32_t expected = internal ? c.blocks[block.successors[0]].start : 0;
+    if (isConstant (c, target))
+    {
+        if (internal && c.values[target].bits == expected) addControl (c, OP_JUMP, 0, NONE, NONE, NONE);
+        else exitTo (c, NONE, c.values[target].bits, refund);
+    }
+    else if (internal)
+    {
+        addControl (c, OP_EXIT_IF, OPCODE_BNE, target, constant (c, expected),
+            newExit (c, target, 0, refund, EXIT_LOOKUP));
+        addControl (c, OP_JUMP, 0, NONE, NONE, NONE);
+    }
+    else exitTo (c, target, 0, refund);
+}
+
+// the entry resumed at after the block, once sp and bp are known there
+void
+relateEntry (Optimizer& c, uint32_t e)
+{
+    // (sp is the function entry's frame)
+    if (e == NONE || c.entries[e].frame != bp) return;
+    int32_t spOffset;
+    int32_t bpOffset;
+    uint32_t spBase = baseOf (c, read (c, sp), &spOffset);
+    uint32_t bpBase = baseOf (c, read (c, bp), &bpOffset);
+    c.entries[e].related = spBase == bpBase;
+    c.entries[e].relation = spOffset - bpOffset;
+}
+
+// lifts the instruction at address - refund is how many instructions of
+// the block come after it
+void
+liftInstruction (Optimizer& c, uint32_t address, uint32_t refund)
+{
+    byte* memory = c.memory;
+    byte opcode = memory[address];
+    byte dest   = memory[address+1] >> 4;
+    byte src1   = memory[address+1] & 0xf;
+    byte src2   = memory[address+2] >> 4;
+    // immediates/offsets are stored in little endian
+    int32_t imm = *(int16_t*)&memory[address+2];
+
+    switch (opcode)
+    {
+        // LUI/LLI write the first/last 2 bytes of dest
+        case OPCODE_LUI:
+            write (c, dest, binary (c, OPCODE_OR, binary (c, OPCODE_AND, read (c, dest), constant (c, 0xffff0000)),
+                constant (c, (uint16_t)imm)));
+            break;
+        case OPCODE_LLI:
+            write (c, dest, binary (c, OPCODE_OR, binary (c, OPCODE_AND, read (c, dest), constant (c, 0x0000ffff)),
+                constant (c, (uint32_t)imm << 16)));
+            break;
+
+        case OPCODE_LB:
+        case OPCODE_LH:
+        case OPCODE_LW:
+            write (c, dest, load (c, opcode, read (c, src1), imm, address, refund));
+            break;
+        case OPCODE_SB:
+        case OPCODE_SH:
+        case OPCODE_SW:
+            store (c, opcode, read (c, dest), imm, read (c, src1), true, address, refund);
+            break;
+
+        case OPCODE_ADD: case OPCODE_SUB: case OPCODE_MUL: case OPCODE_DIV:
+        case OPCODE_MOD: case OPCODE_SLL: case OPCODE_SRL: case OPCODE_SRA:
+        case OPCODE_OR:  case OPCODE_AND: case OPCODE_XOR:
+            write (c, dest, binary (c, opcode, read (c, src1), read (c, src2)));
+            break;
+        // immediate forms are in the same order as the register forms
+        case OPCODE_ADDI: case OPCODE_SUBI: case OPCODE_MULI: case OPCODE_DIVI:
+        case OPCODE_MODI: case OPCODE_SLLI: case OPCODE_SRLI: case OPCODE_SRAI:
+        case OPCODE_ORI:  case OPCODE_ANDI: case OPCODE_XORI:
+            write (c, dest, binary (c, opcode - OPCODE_ADDI + OPCODE_ADD, read (c, src1), constant (c, imm)));
+            break;
+
+        // the taken side is a target block of its own
+        case OPCODE_BEQ:
+        case OPCODE_BNE:
+        case OPCODE_BLT:
+        case OPCODE_BLE:
+        case OPCODE_BGT:
+        case OPCODE_BGE:
+        {
+            uint32_t left = read (c, dest);
+            uint32_t right = read (c, src1);
+            if (isConstant (c, left) && isConstant (c, right))
+            {
+                bool taken = branchTaken (opcode, c.values[left].bits, c.values[right].bits);
+                addControl (c, OP_JUMP, taken ? 1 : 0, NONE, NONE, NONE);
+            }
+            else addControl (c, OP_BRANCH, opcode, left, right, NONE);
+            break;
+        }
+        case OPCODE_JMP:
+            goTo (c, read (c, dest), refund);
+            break;
+
+        // CALL pushes its own address and leaves for the callee - the
+        // function goes on at the entry after it. sp is written after the
+        // push, which may leave to run the whole instruction elsewhere
+        case OPCODE_CALL:
+        {
+            uint32_t target = read (c, dest);
+            relateEntry (c, c.blocks[c.current].entry);
+            uint32_t top = binary (c, OPCODE_ADD, read (c, sp), constant (c, -4));
+            bool stored = store (c, OPCODE_SW, top, 0, constant (c, address), false, address, refund);
+            write (c, sp, top);
+            if (stored) checkPush (c, top, target, 0, refund);
+            exitTo (c, target, 0, refund);
+            break;
+        }
+        // RET continues past the CALL
+        case OPCODE_RET:
+        {
+            uint32_t top = read (c, sp);
+            uint32_t returnAddress = load (c, OPCODE_LW, top, 0, address, refund);
+            write (c, sp, binary (c, OPCODE_ADD, top, constant (c, 4)));
+            exitTo (c, binary (c, OPCODE_ADD, returnAddress, constant (c, 4)), 0, refund);
+            break;
+        }
+        case OPCODE_PUSH:
+        {
+            uint32_t top = binary (c, OPCODE_ADD, read (c, sp), constant (c, -4));
+            // the value is read after sp moves, like the interpreters (PUSH sp)
+            bool stored = store (c, OPCODE_SW, top, 0, dest == sp ? top : read (c, dest), false, address, refund);
+            write (c, sp, top);
+            if (stored) checkPush (c, top, NONE, address + 4, refund);
+            break;
+        }
+        case OPCODE_POP:
+            write (c, dest, load (c, OPCODE_LW, read (c, sp), 0, address, refund));
+            // sp moves after dest is written, like the interpreters (POP sp)
+            write (c, sp, binary (c, OPCODE_ADD, read (c, sp), constant (c, 4)));
+            break;
+
+        case OPCODE_NOP:
+            break;
+    }
+}
+
+// fills block b with its ops
+void
+fillBlock (Optimizer& c, uint32_t b)
+{
+    OptBlock& block = c.blocks[b];
+    c.current = b;
+    block.firstOp = c.numOps;
+    if (block.kind == BLOCK_ENTRY)
+    {
+        OptEntry& entry = c.entries[block.entry];
+        entry.frameValue = read (c, entry.frame);
+        addControl (c, OP_GUARD, 0, NONE, NONE, newExit (c, NONE, entry.pc, 0, EXIT_INTERPRET));
+        // the guard checks sp is where the CALL left it
+        if (entry.related)
+            writeVariable (c, sp, b, binary (c, OPCODE_ADD, entry.frameValue, constant (c, entry.relation)));
+    }
+    // every variable in scope is read at the start, for the write backs
+    for (uint32_t var = 0; var < NUM_VARS; ++var)
+    {
+        uint32_t v = NONE;
+        if (inScope (c, b, var)) v = read (c, var);
+        c.inDefs[b * NUM_VARS + var] = v;
+    }
+
+    switch (block.kind)
+    {
+        case BLOCK_ENTRY:
+            addControl (c, OP_JUMP, 0, NONE, NONE, NONE);
+            break;
+        case BLOCK_TARGET:
+            goTo (c, read (c, block.target), 0);
+            break;
+        case BLOCK_CODE:
+            if (block.length > 0) block.budgetExit = newExit (c, NONE, block.start, 0, EXIT_BUDGET);
+            for (uint32_t i = 0; i < block.length; ++i)
+                liftInstruction (c, block.start + i*4, block.length - i - 1);
+            if (block.end == END_FALL) addControl (c, OP_JUMP, 0, NONE, NONE, NONE);
+            else if (block.end == END_STOP)
+            {
+                relateEntry (c, block.entry);
+                exitTo (c, NONE, block.start + block.length*4, 0);
+            }
+            break;
+    }
+    block.numOps = c.numOps - block.firstOp;
+    block.filled = true;
+
+    for (uint32_t i = 0; i < block.numSuccessors; ++i)
+    {
+        OptBlock& next = c.blocks[block.successors[i]];
+        if (next.sealed) continue;
+        bool ready = true;
+        for (uint32_t p = 0; p < next.numPredecessors; ++p)
+            ready = ready && c.blocks[c.predecessors[next.predecessors + p]].filled;
+        if (ready) sealBlock (c, block.successors[i]);
+    }
+}
+
+// lifts the whole function with what is known of its slots
+void
+lift (Optimizer& c)
+{
+    c.numValues = 0;
+    c.numOps = 0;
+    c.numInputs = 0;
+    c.numExits = 0;
+    c.numFlushes = 0;
+    c.failed = false;
+    c.slotsChanged = false;
+    c.current = 0;
+    // value 0 is what a failed allocation returns
+    constant (c, 0);
+    std::memset (c.defs, 0xff, c.numBlocks * NUM_VARS * sizeof(uint32_t));
+    for (uint32_t b = 0; b < c.numBlocks; ++b)
+    {
+        OptBlock& block = c.blocks[b];
+        block.phis = NONE;
+        block.budgetExit = NONE;
+        block.edgeFlushes[0] = block.edgeFlushes[1] = NONE;
+        block.filled = false;
+        block.sealed = block.kind == BLOCK_ENTRY;
+        block.numOps = 0;
+    }
+    for (uint32_t e = 0; e < c.numEntries; ++e) c.entries[e].related = false;
+    for (uint32_t i = 0; i < c.numOrdered && !c.failed; ++i)
+        fillBlock (c, c.order[i]);
+
+    for (uint32_t e = 0; e < c.numEntries; ++e) c.entries[e].hasSlots = false;
+    for (uint32_t s = 0; s < c.numSlots; ++s)
+    {
+        OptEntry& entry = c.entries[c.slotEntry[s]];
+        if (!entry.hasSlots || c.slotOffset[s] < entry.lowest) entry.lowest = c.slotOffset[s];
+        if (!entry.hasSlots || c.slotOffset[s] > entry.highest) entry.highest = c.slotOffset[s];
+        entry.hasSlots = true;
+    }
+}
+
+//========================================================================
+// The function's blocks
+
+// the entry at pc, or NONE
+uint32_t
+entryAt (Optimizer& c, uint32_t pc)
+{
+    for (uint32_t e = 0; e < c.numEntries; ++e)
+        if (c.entries[e].pc == pc) return e;
+    return NONE;
+}
+
+uint32_t
+addEntry (Optimizer& c, uint32_t pc)
+{
+    uint32_t e = entryAt (c, pc);
+    if (e != NONE) return e;
+    if (c.numEntries == MAX_OPT_ENTRIES)
+    {
+        c.failed = true;
+        return NONE;
+    }
+    OptEntry& entry = c.entries[c.numEntries];
+    entry.pc = pc;
+    entry.block = NONE;
+    // the function entry's slots are relative to sp, before the
+    // prologue moves it. everywhere else it is the frame bp sets up
+    entry.frame = c.numEntries == 0 ? sp : bp;
+    return c.numEntries++;
+}
+
+uint32_t
+addBlock (Optimizer& c, BlockKind kind, uint32_t start, uint32_t length)
+{
+    if (c.numBlocks == MAX_OPT_BLOCKS)
+    {
+        c.failed = true;
+        return 0;
+    }
+    OptBlock& block = c.blocks[c.numBlocks];
+    std::memset (&block, 0, sizeof(block));
+    block.kind = kind;
+    block.start = start;
+    block.length = length;
+    block.entry = NONE;
+    block.region = NONE;
+    block.order = NONE;
+    if (kind == BLOCK_CODE) c.blockAt[start / 4] = c.numBlocks;
+    return c.numBlocks++;
+}
+
+// splits the control flow graph blocks of the function at pc where
+// instructions are left to the interpreter, and links them up
+bool
+buildBlocks (Optimizer& c, uint32_t pc)
+{
+    const ControlFlowGraph* cfg = c.cfg;
+    c.numBlocks = 0;
+    c.numEntries = 0;
+    c.failed = false;
+    uint32_t first = cfg->blockAt[pc / 4];
+    if (first == CFG_NONE) return false;
+    addEntry (c, pc);
+
+    // the graph's blocks reachable without following calls
+    uint32_t numListed = 0;
+    uint32_t numInstructions = 0;
+    c.cfgList[numListed++] = first;
+    c.cfgSeen[first] = 1;
+    for (uint32_t i = 0; i < numListed && !c.failed; ++i)
+    {
+        const CfgBlock& from = cfg->blocks[c.cfgList[i]];
+        numInstructions += (from.end - from.start) / 4;
+        if (numInstructions > MAX_OPT_INSTRUCTIONS) c.failed = true;
+        uint32_t begin = from.start;
+        for (uint32_t address = from.start; address < from.end; address += 4)
+        {
+            byte opcode = c.memory[address];
+            if (isTranslatable (opcode)) continue;
+            uint32_t b = addBlock (c, BLOCK_CODE, begin, (address - begin) / 4);
+            c.blocks[b].end = END_STOP;
+            if ((opcode == OPCODE_GETCHAR || opcode == OPCODE_PUTCHAR) && address + 4 < c.codeSize)
+                c.blocks[b].entry = addEntry (c, address + 4);
+            begin = address + 4;
+        }
+        if (begin < from.end)
+        {
+            byte last = c.memory[from.end - 4];
+            uint32_t b = addBlock (c, BLOCK_CODE, begin, (from.end - begin) / 4);
+            c.blocks[b].end = last >= OPCODE_BEQ && last <= OPCODE_RET ? END_CONTROL : END_FALL;
+            if (last == OPCODE_CALL && from.end < c.codeSize) c.blocks[b].entry = addEntry (c, from.end);
+        }
+        for (uint32_t s = 0; s < from.numSuccessors; ++s)
+        {
+            uint32_t next = from.successors[s];
+            if (c.cfgSeen[next]) continue;
+            c.cfgSeen[next] = 1;
+            c.cfgList[numListed++] = next;
+        }
+    }
+    for (uint32_t i = 0; i < numListed; ++i) c.cfgSeen[c.cfgList[i]] = 0;
+    if (c.failed) return false;
+
+    // successors
+    uint32_t numCode = c.numBlocks;
+    for (uint32_t b = 0; b < numCode && !c.failed; ++b)
+    {
+        uint32_t next = c.blocks[b].start + c.blocks[b].length * 4;
+        if (c.blocks[b].end == END_FALL)
+        {
+            if (next >= c.codeSize || c.blockAt[next / 4] == NONE) return false;
+            c.blocks[b].successors[c.blocks[b].numSuccessors++] = c.blockAt[next / 4];
+        }
+        if (c.blocks[b].end != END_CONTROL) continue;
+        uint32_t last = next - 4;
+        byte opcode = c.memory[last];
+        uint32_t target = cfg->targets[last / 4];
+        uint32_t targetBlock = target != CFG_NONE && target < c.codeSize ? c.blockAt[target / 4] : NONE;
+        if (hasFlag (opcode, ISA_CONDITIONAL))
+        {
+            if (next >= c.codeSize || c.blockAt[next / 4] == NONE) return false;
+            uint32_t taken = addBlock (c, BLOCK_TARGET, last, 0);
+            c.blocks[taken].target = c.memory[last + 2] >> 4;
+            if (targetBlock != NONE) c.blocks[taken].successors[c.blocks[taken].numSuccessors++] = targetBlock;
+            c.blocks[b].successors[0] = c.blockAt[next / 4];
+            c.blocks[b].successors[1] = taken;
+            c.blocks[b].numSuccessors = 2;
+        }
+        else if (opcode == OPCODE_JMP && targetBlock != NONE)
+            c.blocks[b].successors[c.blocks[b].numSuccessors++] = targetBlock;
+    }
+    for (uint32_t e = 0; e < c.numEntries && !c.failed; ++e)
+    {
+        OptEntry& entry = c.entries[e];
+        if (c.blockAt[entry.pc / 4] == NONE) return false;
+        entry.block = addBlock (c, BLOCK_ENTRY, entry.pc, 0);
+        c.blocks[entry.block].entry = e;
+        c.blocks[entry.block].successors[0] = c.blockAt[entry.pc / 4];
+        c.blocks[entry.block].numSuccessors = 1;
+    }
+    return !c.failed;
+}
+
+// orders the blocks in reverse postorder - following the successors and
+// from each block that leaves the function to the entry it comes back
+// at, so that entry is filled after it (and knows its frame) - finds the
+// predecessors, and the region of each block
+void
+orderBlocks (Optimizer& c)
+{
+    // depth first, with the index of the next edge of each block on the
+    // stack - edge 2 is the entry it resumes at. entries not reached
+    // that way (after a CALL the function entry cannot reach) are ordered
+    // after it, each in reverse postorder of its own
+    uint32_t stack[MAX_OPT_BLOCKS];
+    byte nextEdge[MAX_OPT_BLOCKS];
+    uint32_t postorder[MAX_OPT_BLOCKS];
+    uint32_t numPostorder = 0;
+    bool* visited = (bool*) calloc (c.numBlocks, sizeof(bool));
+    for (uint32_t i = 0; i < c.numEntries; ++i)
+    {
+        uint32_t root = c.entries[i].block;
+        if (visited[root]) continue;
+        uint32_t first = numPostorder;
+        uint32_t depth = 0;
+        stack[depth] = root;
+        nextEdge[depth++] = 0;
+        visited[root] = true;
+        while (depth > 0)
+        {
+            uint32_t b = stack[depth - 1];
+            OptBlock& block = c.blocks[b];
+            byte edge = nextEdge[depth - 1]++;
+            uint32_t next = NONE;
+            if (edge < block.numSuccessors) next = block.successors[edge];
+            else if (edge == 2 && block.kind == BLOCK_CODE && block.entry != NONE) next = c.entries[block.entry].block;
+            else if (edge > 2)
+            {
+                postorder[numPostorder++] = b;
+                --depth;
+                continue;
+            }
+            if (next == NONE || visited[next]) continue;
+            visited[next] = true;
+            stack[depth] = next;
+            nextEdge[depth++] = 0;
+        }
+        for (uint32_t i = first; i < numPostorder; ++i)
+            c.order[i] = postorder[numPostorder - 1 - (i - first)];
+    }
+    free (visited);
+    c.numOrdered = numPostorder;
+    for (uint32_t i = 0; i < numPostorder; ++i) c.blocks[c.order[i]].order = i;
+
+    // predecessors, from reachable blocks only
+    uint32_t numEdges = 0;
+    for (uint32_t b = 0; b < c.numBlocks; ++b) c.blocks[b].numPredecessors = 0;
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        for (uint32_t s = 0; s < block.numSuccessors; ++s) ++c.blocks[block.successors[s]].numPredecessors;
+    }
+    for (uint32_t b = 0; b < c.numBlocks; ++b)
+    {
+        c.blocks[b].predecessors = numEdges;
+        numEdges += c.blocks[b].numPredecessors;
+        c.blocks[b].numPredecessors = 0;
+    }
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        for (uint32_t s = 0; s < block.numSuccessors; ++s)
+        {
+            OptBlock& next = c.blocks[block.successors[s]];
+            c.predecessors[next.predecessors + next.numPredecessors++] = c.order[i];
+        }
+    }
+
+    // dominators (Cooper, Harvey and Kennedy) - entry blocks hang off
+    // the root
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        block.idom = block.kind == BLOCK_ENTRY ? ROOT : NONE;
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t i = 0; i < c.numOrdered; ++i)
+        {
+            OptBlock& block = c.blocks[c.order[i]];
+            if (block.kind == BLOCK_ENTRY) continue;
+            uint32_t idom = NONE;
+            for (uint32_t p = 0; p < block.numPredecessors; ++p)
+            {
+                uint32_t other = c.predecessors[block.predecessors + p];
+                if (c.blocks[other].idom == NONE) continue;
+                if (idom == NONE)
+                {
+                    idom = other;
+                    continue;
+                }
+                // walk both up to where they meet
+                while (idom != other)
+                {
+                    while (idom != ROOT && (other == ROOT || c.blocks[idom].order > c.blocks[other].order))
+                        idom = c.blocks[idom].idom;
+                    while (other != ROOT && (idom == ROOT || c.blocks[other].order > c.blocks[idom].order))
+                        other = c.blocks[other].idom;
+                }
+            }
+            if (idom != block.idom)
+            {
+                block.idom = idom;
+                changed = true;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        if (block.kind == BLOCK_ENTRY) block.region = block.entry;
+        else if (block.idom == ROOT || block.idom == NONE) block.region = NONE;
+        else block.region = c.blocks[block.idom].region;
+    }
+}
+
+// which predecessor of b from is
+uint32_t
+predecessorIndex (Optimizer& c, uint32_t b, uint32_t from)
+{
+    for (uint32_t p = 0; p < c.blocks[b].numPredecessors; ++p)
+        if (c.predecessors[c.blocks[b].predecessors + p] == from) return p;
+    return 0;
+}
+
+//========================================================================
+// Loops
+// a load or store that runs on every iteration of a loop often has an
+// address that moves by a constant step each time - an induction
+// variable, plus something the loop does not change. where the loop is
+// entered, the first address says how many iterations can run before
+// one of them could reach the slots of the region (or, for a store, the
+// program) - none ever do if it moves away from them, since it would
+// have to wrap around through the negative addresses, which are outside
+// of memory. every iteration charges the budget for at least the blocks
+// it always runs, so holding the budget back to what those iterations
+// cost (JitContext::reserve) makes the loop leave before it runs any
+// further. the checks of its loads and stores are then made once, and
+// a loop that starts too close is left to the JIT
+
+// the most a step or an offset from an induction variable may be - far
+// less than the negative addresses an address cannot jump over
+const int32_t MAX_STEP = 1 << 16;
+const int32_t MAX_RANGE_OFFSET = 1 << 24;
+// induction variables checked before one loop
+const unsigned int MAX_INDUCTIONS = 16;
+
+// the accesses of a loop through one induction variable
+struct Induction
+{
+    // the variable (a phi of the header) and what is added to it (or
+    // NONE)
+    uint32_t phi;
+    uint32_t invariant;
+    int32_t step;
+    // the range of each kind, if some access needs it
+    bool needs[2];
+    OptRange ranges[2];
+};
+
+// true if every path to block b comes through block a
+bool
+dominates (Optimizer& c, uint32_t a, uint32_t b)
+{
+    while (b != a && b != ROOT && b != NONE) b = c.blocks[b].idom;
+    return b == a;
+}
+
+// the largest step v moves by on a way around the loop with header h
+// (all have the same sign), if it is one of h's phis - 0 if it is not
+// an induction variable
+int32_t
+stepOf (Optimizer& c, uint32_t h, uint32_t v, const byte* inLoop)
+{
+    const OptValue& x = c.values[v];
+    if (x.op != OP_PHI || x.block != h || x.replacement != NONE) return 0;
+    int32_t step = 0;
+    for (uint32_t p = 0; p < c.blocks[h].numPredecessors; ++p)
+    {
+        if (!inLoop[c.predecessors[c.blocks[h].predecessors + p]]) continue;
+        int32_t offset;
+        if (baseOf (c, c.inputs[x.extra + p], &offset) != v) return 0;
+        if (offset == 0 || offset <= -MAX_STEP || offset >= MAX_STEP) return 0;
+        if (step != 0 && (offset > 0) != (step > 0)) return 0;
+        if (offset > 0 ? offset > step : offset < step) step = offset;
+    }
+    return step;
+}
+
+// the induction variable the address a + offset of an access in the
+// loop with header h walks with - a phi of h (*phi), plus a value from
+// outside the loop (*invariant, or NONE) and a constant (*total). returns
+// its step, or 0 if there is none
+int32_t
+inductionOf (Optimizer& c, uint32_t h, uint32_t a, int32_t offset, const byte* inLoop, uint32_t* phi, uint32_t* invariant,
+    int32_t* total)
+{
+    int32_t baseOffset;
+    uint32_t base = baseOf (c, a, &baseOffset);
+    int64_t sum = (int64_t)baseOffset + offset;
+    if (base == NONE) return 0;
+    *phi = base;
+    *invariant = NONE;
+    int32_t step = stepOf (c, h, base, inLoop);
+    const OptValue& x = c.values[base];
+    if (step == 0 && x.op == OP_BINARY && x.opcode == OPCODE_ADD)
+    {
+        for (uint32_t k = 0; k < 2 && step == 0; ++k)
+        {
+            *phi = baseOf (c, k == 0 ? x.a : x.b, &baseOffset);
+            *invariant = find (c, k == 0 ? x.b : x.a);
+            if (*phi != NONE && !inLoop[c.values[*invariant].block]) step = stepOf (c, h, *phi, inLoop);
+        }
+        sum += baseOffset;
+    }
+    if (sum <= -MAX_RANGE_OFFSET || sum >= MAX_RANGE_OFFSET) return 0;
+    *total = (int32_t)sum;
+    return step;
+}
+
+// makes op v the one before the last of block b
+void
+insertBeforeEnd (Optimizer& c, uint32_t b, uint32_t v)
+{
+    OptBlock& block = c.blocks[b];
+    if (c.numOps + block.numOps + 1 > MAX_OPT_VALUES)
+    {
+        c.failed = true;
+        return;
+    }
+    uint32_t first = c.numOps;
+    for (uint32_t i = 0; i + 1 < block.numOps; ++i) c.ops[c.numOps++] = c.ops[block.firstOp + i];
+    c.ops[c.numOps++] = v;
+    c.ops[c.numOps++] = c.ops[block.firstOp + block.numOps - 1];
+    block.firstOp = first;
+    ++block.numOps;
+}
+
+// the natural loop with header h - what reaches a back edge (from a
+// block h dominates) without passing h. marks its blocks in inLoop and
+// lists them, the latches (the blocks with a back edge) first. the one
+// block outside it that enters it is *preheader (NONE if there is not
+// exactly one). inLoop and list have room for a flag and an entry for
+// each block
+uint32_t
+findLoop (Optimizer& c, uint32_t h, byte* inLoop, uint32_t* list, uint32_t* numLatches, uint32_t* preheader)
+{
+    const OptBlock& header = c.blocks[h];
+    uint32_t numLoop = 0;
+    uint32_t numOutside = 0;
+    *preheader = NONE;
+    for (uint32_t p = 0; p < header.numPredecessors; ++p)
+    {
+        uint32_t from = c.predecessors[header.predecessors + p];
+        if (!dominates (c, h, from))
+        {
+            *preheader = from;
+            ++numOutside;
+        }
+        else if (!inLoop[from])
+        {
+            inLoop[from] = 1;
+            list[numLoop++] = from;
+        }
+    }
+    if (numOutside != 1) *preheader = NONE;
+    *numLatches = numLoop;
+    if (numLoop > 0 && !inLoop[h])
+    {
+        inLoop[h] = 1;
+        list[numLoop++] = h;
+    }
+    for (uint32_t i = 0; i < numLoop; ++i)
+    {
+        if (list[i] == h) continue;
+        const OptBlock& block = c.blocks[list[i]];
+        for (uint32_t p = 0; p < block.numPredecessors; ++p)
+        {
+            uint32_t from = c.predecessors[block.predecessors + p];
+            if (inLoop[from]) continue;
+            inLoop[from] = 1;
+            list[numLoop++] = from;
+        }
+    }
+    return numLoop;
+}
+
+// true if every iteration of a loop with the latches listed runs block b
+inline bool
+isAlwaysRun (Optimizer& c, uint32_t b, const uint32_t* list, uint32_t numLatches)
+{
+    for (uint32_t l = 0; l < numLatches; ++l)
+        if (!dominates (c, b, list[l])) return false;
+    return true;
+}
+
+// instructions the budget is charged for every iteration of a loop
+uint32_t
+perIterationOf (Optimizer& c, const uint32_t* list, uint32_t numLoop, uint32_t numLatches)
+{
+    uint32_t perIteration = 0;
+    for (uint32_t i = 0; i < numLoop; ++i)
+        if (isAlwaysRun (c, list[i], list, numLatches)) perIteration += c.blocks[list[i]].length;
+    return perIteration;
+}
+
+// true if the loop can be entered through a check added to preheader -
+// it has to go on to the loop unconditionally
+inline bool
+isPreheader (Optimizer& c, uint32_t preheader)
+{
+    if (preheader == NONE) return false;
+    const OptBlock& block = c.blocks[preheader];
+    return block.numSuccessors == 1 && block.numOps > 0
+        && c.values[c.ops[block.firstOp + block.numOps - 1]].op == OP_JUMP;
+}
+
+// moves the checks of the loads and stores of the loop with header h
+// into the block it is entered from
+void
+hoistLoopChecks (Optimizer& c, uint32_t h, byte* inLoop, uint32_t* list)
+{
+    OptBlock& header = c.blocks[h];
+    // (a check failing at an entry would leave for itself)
+    if (header.kind != BLOCK_CODE || entryAt (c, header.start) != NONE) return;
+
+    uint32_t numLatches;
+    uint32_t preheader;
+    uint32_t numLoop = findLoop (c, h, inLoop, list, &numLatches, &preheader);
+    uint32_t perIteration = perIterationOf (c, list, numLoop, numLatches);
+
+    Induction inductions[MAX_INDUCTIONS];
+    uint32_t numInductions = 0;
+    bool hoistable = numLatches > 0 && perIteration > 0 && isPreheader (c, preheader);
+    for (uint32_t i = 0; i < numLoop && hoistable; ++i)
+    {
+        // only accesses made on every iteration
+        uint32_t b = list[i];
+        if (!isAlwaysRun (c, b, list, numLatches) || c.blocks[b].region != c.blocks[preheader].region) continue;
+        for (uint32_t j = 0; j < c.blocks[b].numOps; ++j)
+        {
+            OptValue& x = c.values[c.ops[c.blocks[b].firstOp + j]];
+            if (x.op != OP_LOAD && x.op != OP_STORE) continue;
+            bool checks[2] = { isAliasChecked (c, x), x.op == OP_STORE && x.extra != NONE };
+            if (!checks[RANGE_SLOTS] && !checks[RANGE_PROGRAM]) continue;
+            uint32_t phi;
+            uint32_t invariant;
+            int32_t total;
+            int32_t step = inductionOf (c, h, x.a, x.imm, inLoop, &phi, &invariant, &total);
+            if (step == 0) continue;
+
+            uint32_t n = 0;
+            while (n < numInductions && (inductions[n].phi != phi || inductions[n].invariant != invariant)) ++n;
+            if (n == MAX_INDUCTIONS) continue;
+            Induction& induction = inductions[n];
+            if (n == numInductions)
+            {
+                ++numInductions;
+                induction.phi = phi;
+                induction.invariant = invariant;
+                induction.step = step;
+                induction.needs[0] = induction.needs[1] = false;
+            }
+            for (uint32_t kind = 0; kind < 2; ++kind)
+            {
+                if (!checks[kind]) continue;
+                OptRange& range = induction.ranges[kind];
+                if (!induction.needs[kind] || total < range.lowest) range.lowest = total;
+                if (!induction.needs[kind] || total > range.highest) range.highest = total;
+                induction.needs[kind] = true;
+            }
+            if (checks[RANGE_SLOTS]) x.alias = NONE;
+            if (checks[RANGE_PROGRAM]) x.extra = NONE;
+        }
+    }
+
+    // the checks, from the first value of each variable
+    uint32_t saved = c.current;
+    c.current = preheader;
+    for (uint32_t n = 0; n < numInductions; ++n)
+    {
+        Induction& induction = inductions[n];
+        uint32_t first = find (c, c.inputs[c.values[induction.phi].extra + predecessorIndex (c, h, preheader)]);
+        uint32_t magnitude = induction.step > 0 ? induction.step : -induction.step;
+        byte shift = 0;
+        while ((1u << shift) < magnitude) ++shift;
+        for (uint32_t kind = 0; kind < 2; ++kind)
+        {
+            if (!induction.needs[kind]) continue;
+            if (c.numRanges == MAX_OPT_RANGES)
+            {
+                c.failed = true;
+                break;
+            }
+            OptRange& range = c.ranges[c.numRanges];
+            range = induction.ranges[kind];
+            range.kind = (RangeKind)kind;
+            range.up = induction.step > 0;
+            range.shift = shift;
+            range.perIteration = perIteration;
+            uint32_t v = newValue (c, OP_RANGE_CHECK);
+            OptValue& x = c.values[v];
+            x.a = first;
+            x.b = induction.invariant;
+            x.imm = c.numRanges++;
+            x.extra = newExit (c, NONE, header.start, 0, EXIT_LOOKUP);
+            insertBeforeEnd (c, preheader, v);
+        }
+    }
+    c.current = saved;
+    for (uint32_t i = 0; i < numLoop; ++i) inLoop[list[i]] = 0;
+}
+
+// hoists the checks out of every loop of the function
+void
+hoistChecks (Optimizer& c)
+{
+    c.numRanges = 0;
+    byte* inLoop = (byte*) calloc (c.numBlocks, 1);
+    uint32_t* list = (uint32_t*) malloc (c.numBlocks * sizeof(uint32_t));
+    for (uint32_t i = 0; i < c.numOrdered && !c.failed; ++i)
+        hoistLoopChecks (c, c.order[i], inLoop, list);
+    free (inLoop);
+    free (list);
+}
+
+//========================================================================
+// Byte loops
+// a loop that walks a string a byte at a time - scanning it for a byte
+// (or for the first byte that is not that one), or copying it up to
+// one - is run by a host kernel before it is entered, looking at 16
+// bytes at a time (32 with AVX2). the kernel finds how many iterations
+// run before the one that leaves, makes the stores they would have made
+// and moves the loop's induction variables on by that many - the loop
+// itself then only runs its last iteration, which leaves every register
+// as the interpreters would. the other variables the loop carries from
+// one iteration to the next are not brought up to date, so it has to be
+// a chain of blocks whose only exit is the branch on the byte, and the
+// values carried must not reach anything but themselves - nothing in
+// between could see them: the kernel skips nothing unless the budget
+// covers the iterations it skips and the last one. it only looks at
+// bytes inside memory and below what the budget lets the loop reach
+// (the loop's range checks keep the slots and the program beyond that),
+// and a copy whose stores would reach bytes it has still to read is left
+// to the loop
+
+// a <opcode> b, computed before the last op of block b - values are
+// added to a block after it is filled
+uint32_t
+binaryBeforeEnd (Optimizer& c, uint32_t b, byte opcode, uint32_t x, uint32_t y)
+{
+    uint32_t saved = c.current;
+    uint32_t numOps = c.numOps;
+    c.current = b;
+    uint32_t v = binary (c, opcode, x, y);
+    if (c.numOps != numOps)
+    {
+        c.numOps = numOps;
+        insertBeforeEnd (c, b, v);
+    }
+    c.current = saved;
+    return v;
+}
+
+// the address the access x in the loop with header h makes on the
+// first iteration, computed before the last op of the preheader - NONE
+// if it does not walk forwards a byte at a time
+uint32_t
+firstAddress (Optimizer& c, uint32_t h, uint32_t preheader, const OptValue& x, const byte* inLoop)
+{
+    uint32_t phi;
+    uint32_t invariant;
+    int32_t total;
+    if (inductionOf (c, h, x.a, x.imm, inLoop, &phi, &invariant, &total) != 1) return NONE;
+    uint32_t v = c.inputs[c.values[phi].extra + predecessorIndex (c, h, preheader)];
+    if (invariant != NONE) v = binaryBeforeEnd (c, preheader, OPCODE_ADD, v, invariant);
+    return binaryBeforeEnd (c, preheader, OPCODE_ADD, v, constant (c, total));
+}
+
+// runs the loop with header h through a kernel if it is a byte loop.
+// inLoop and list have room for a flag and an entry for each block, and
+// stale for a flag for each value
+void
+vectorizeLoop (Optimizer& c, uint32_t h, byte* inLoop, uint32_t* list, byte* stale, uint32_t numStale)
+{
+    OptBlock& header = c.blocks[h];
+    if (header.kind != BLOCK_CODE) return;
+    uint32_t numLatches;
+    uint32_t preheader;
+    uint32_t numLoop = findLoop (c, h, inLoop, list, &numLatches, &preheader);
+    uint32_t perIteration = perIterationOf (c, list, numLoop, numLatches);
+    bool vectorizable = numLatches == 1 && perIteration > 0 && isPreheader (c, preheader);
+    for (uint32_t i = 0; i < numLoop && vectorizable; ++i)
+        vectorizable = isAlwaysRun (c, list[i], list, 1) && c.blocks[list[i]].region == c.blocks[preheader].region;
+    if (!vectorizable)
+    {
+        for (uint32_t i = 0; i < numLoop; ++i) inLoop[list[i]] = 0;
+        return;
+    }
+    // the blocks in the order every iteration runs them
+    std::sort (list, list + numLoop, [&] (uint32_t a, uint32_t b) {
+        return c.blocks[a].order < c.blocks[b].order;
+    });
+
+    // the variables carried that are not induction variables are stale
+    // once the kernel has run, and so is everything computed from them
+    // (values made after the pass started are neither)
+    auto isStale = [&] (uint32_t v) {
+        v = find (c, v);
+        return v < numStale && stale[v];
+    };
+    uint32_t inductions[MAX_INDUCTIONS];
+    int32_t steps[MAX_INDUCTIONS];
+    uint32_t numInductions = 0;
+    for (uint32_t phi = header.phis; phi != NONE; phi = c.values[phi].next)
+    {
+        if (c.values[phi].replacement != NONE) continue;
+        int32_t step = stepOf (c, h, phi, inLoop);
+        if (phi >= numStale || (step != 0 && numInductions == MAX_INDUCTIONS)) vectorizable = false;
+        else if (step == 0) stale[phi] = 1;
+        else
+        {
+            inductions[numInductions] = phi;
+            steps[numInductions++] = step;
+        }
+    }
+
+    // one LB, maybe one SB of what it loaded, and the branch on it
+    uint32_t load = NONE;
+    uint32_t store = NONE;
+    uint32_t branch = NONE;
+    for (uint32_t i = 0; i < numLoop && vectorizable; ++i)
+    {
+        const OptBlock& block = c.blocks[list[i]];
+        for (uint32_t j = 0; j < block.numOps && vectorizable; ++j)
+        {
+            uint32_t v = c.ops[block.firstOp + j];
+            const OptValue& x = c.values[v];
+            switch (x.op)
+            {
+                case OP_SET:
+                case OP_JUMP:
+                    break;
+                case OP_BINARY:
+                    // (divisions may trap)
+                    vectorizable = x.opcode != OPCODE_DIV && x.opcode != OPCODE_MOD;
+                    if (v < numStale) stale[v] = isStale (x.a) || isStale (x.b);
+                    break;
+                case OP_LOAD:
+                    vectorizable = load == NONE && x.opcode == OPCODE_LB && !isAliasChecked (c, x) && !isStale (x.a);
+                    load = v;
+                    break;
+                case OP_STORE:
+                    vectorizable = store == NONE && load != NONE && x.opcode == OPCODE_SB && !isAliasChecked (c, x)
+                        && x.extra == NONE && find (c, x.b) == load && !isStale (x.a);
+                    store = v;
+                    break;
+                case OP_BRANCH:
+                    vectorizable = branch == NONE;
+                    branch = v;
+                    break;
+                default:
+                    vectorizable = false;
+                    break;
+            }
+        }
+    }
+    vectorizable = vectorizable && load != NONE && branch != NONE;
+
+    // the branch leaves when the byte is (or is not) a constant
+    OptByteLoop loop;
+    if (vectorizable)
+    {
+        const OptValue& x = c.values[branch];
+        const OptBlock& block = c.blocks[x.block];
+        uint32_t a = find (c, x.a);
+        uint32_t b = find (c, x.b);
+        uint32_t terminator = a == load ? b : a;
+        bool leavesTaken = !inLoop[block.successors[1]];
+        vectorizable = (x.opcode == OPCODE_BEQ || x.opcode == OPCODE_BNE) && inLoop[block.successors[leavesTaken ? 0 : 1]]
+            && !inLoop[block.successors[leavesTaken ? 1 : 0]] && (a == load || b == load)
+            && isConstant (c, terminator) && c.values[terminator].bits <= 0xff;
+        loop.copy = store != NONE;
+        loop.untilEqual = (x.opcode == OPCODE_BEQ) == leavesTaken;
+        loop.terminator = c.values[terminator].bits;
+        loop.perIteration = perIteration;
+        // what the loop leaves with
+        for (uint32_t var = 0; var < NUM_VARS && vectorizable; ++var)
+            if (inScope (c, x.block, var)) vectorizable = !isStale (readVariable (c, var, x.block));
+    }
+
+    if (vectorizable && c.numByteLoops < MAX_OPT_BYTE_LOOPS)
+    {
+        uint32_t saved = c.current;
+        c.current = preheader;
+        uint32_t from = firstAddress (c, h, preheader, c.values[load], inLoop);
+        uint32_t to = store == NONE ? NONE : firstAddress (c, h, preheader, c.values[store], inLoop);
+        if (from != NONE && (store == NONE || to != NONE))
+        {
+            c.byteLoops[c.numByteLoops] = loop;
+            uint32_t skipped = newValue (c, OP_BYTE_LOOP);
+            c.values[skipped].a = from;
+            c.values[skipped].b = to;
+            c.values[skipped].imm = c.numByteLoops++;
+            insertBeforeEnd (c, preheader, skipped);
+            uint32_t p = predecessorIndex (c, h, preheader);
+            for (uint32_t n = 0; n < numInductions; ++n)
+            {
+                uint32_t& first = c.inputs[c.values[inductions[n]].extra + p];
+                uint32_t moved = steps[n] == 1 ? skipped
+                    : binaryBeforeEnd (c, preheader, OPCODE_MUL, skipped, constant (c, steps[n]));
+                first = binaryBeforeEnd (c, preheader, OPCODE_ADD, first, moved);
+            }
+        }
+        c.current = saved;
+    }
+    for (uint32_t phi = header.phis; phi != NONE; phi = c.values[phi].next)
+        if (phi < numStale) stale[phi] = 0;
+    for (uint32_t i = 0; i < numLoop; ++i)
+    {
+        const OptBlock& block = c.blocks[list[i]];
+        for (uint32_t j = 0; j < block.numOps; ++j)
+            if (c.ops[block.firstOp + j] < numStale) stale[c.ops[block.firstOp + j]] = 0;
+        inLoop[list[i]] = 0;
+    }
+}
+
+// runs every byte loop of the function through a kernel
+void
+vectorizeLoops (Optimizer& c)
+{
+    c.numByteLoops = 0;
+    uint32_t numStale = c.numValues;
+    byte* inLoop = (byte*) calloc (c.numBlocks, 1);
+    uint32_t* list = (uint32_t*) malloc (c.numBlocks * sizeof(uint32_t));
+    byte* stale = (byte*) calloc (numStale, 1);
+    for (uint32_t i = 0; i < c.numOrdered && !c.failed; ++i)
+        vectorizeLoop (c, c.order[i], inLoop, list, stale, numStale);
+    free (inLoop);
+    free (list);
+    free (stale);
+}
+
+//========================================================================
+// Write backs
+// follows what the frame and memory hold for each variable through the
+// function - the value written there last, or NONE if that depends on
+// the path - and lists at each exit, flush and edge leaving a region the
+// variables whose current value is not there yet
+
+// the variables of block b exit x has to write back. registers are only
+// considered for exits, and update marks the slots written
+void
+listFlushes (Optimizer& c, uint32_t b, uint32_t x, const uint32_t* cur, uint32_t* mem, bool registers, bool update, bool record)
+{
+    if (record) c.exits[x].flushes = c.numFlushes;
+    for (uint32_t var = registers ? 0 : 16; var < NUM_VARS; ++var)
+    {
+        if (!inScope (c, b, var) || cur[var] == mem[var]) continue;
+        if (update) mem[var] = cur[var];
+        if (!record) continue;
+        if (c.numFlushes == MAX_OPT_FLUSHES)
+        {
+            c.failed = true;
+            break;
+        }
+        c.flushes[c.numFlushes].var = var;
+        c.flushes[c.numFlushes++].value = cur[var];
+    }
+    if (record) c.exits[x].numFlushes = c.numFlushes - c.exits[x].flushes;
+}
+
+// follows block b - returns true if what memory holds at its end changed
+bool
+followBlock (Optimizer& c, uint32_t b, bool record)
+{
+    OptBlock& block = c.blocks[b];
+    uint32_t cur[NUM_VARS];
+    uint32_t mem[NUM_VARS];
+    for (uint32_t var = 0; var < NUM_VARS; ++var)
+    {
+        cur[var] = mem[var] = NONE;
+        if (!inScope (c, b, var)) continue;
+        cur[var] = find (c, c.inDefs[b * NUM_VARS + var]);
+        // an entry block finds everything where it belongs (the guard
+        // checks sp is)
+        if (block.kind == BLOCK_ENTRY)
+        {
+            mem[var] = cur[var];
+            continue;
+        }
+        // memory holds the value a variable has in b if it held the one
+        // it had at the end of every predecessor. anything else it holds
+        // is stale - a value from a loop's last iteration looks the same
+        // as the one from this iteration
+        bool clean = true;
+        for (uint32_t p = 0; p < block.numPredecessors && clean; ++p)
+        {
+            uint32_t from = c.predecessors[block.predecessors + p];
+            uint32_t m = c.memOut[from * NUM_VARS + var];
+            clean = m == UNSEEN || m == find (c, c.defs[from * NUM_VARS + var]);
+        }
+        mem[var] = clean ? cur[var] : NONE;
+    }
+
+    if (block.budgetExit != NONE) listFlushes (c, b, block.budgetExit, cur, mem, true, false, record);
+    for (uint32_t i = 0; i < block.numOps; ++i)
+    {
+        const OptValue& x = c.values[c.ops[block.firstOp + i]];
+        switch (x.op)
+        {
+            case OP_SET:
+                cur[x.var] = find (c, x.a);
+                break;
+            case OP_LOAD:
+                if (x.alias != NONE) listFlushes (c, b, x.alias, cur, mem, true, false, record);
+                listFlushes (c, b, x.fault, cur, mem, true, false, record);
+                break;
+            case OP_STORE:
+                if (x.alias != NONE) listFlushes (c, b, x.alias, cur, mem, true, false, record);
+                listFlushes (c, b, x.fault, cur, mem, true, false, record);
+                if (x.extra != NONE) listFlushes (c, b, x.extra, cur, mem, true, false, record);
+                break;
+            case OP_RANGE_CHECK:
+            case OP_EXIT_IF:
+            case OP_EXIT:
+                if (x.extra != NONE) listFlushes (c, b, x.extra, cur, mem, true, false, record);
+                break;
+            case OP_JUMP:
+            case OP_BRANCH:
+                // slots are written back when control leaves their region
+                for (uint32_t s = 0; s < block.numSuccessors && block.region != NONE; ++s)
+                {
+                    if (x.op == OP_JUMP && s != x.opcode) continue;
+                    if (c.blocks[block.successors[s]].region == block.region) continue;
+                    uint32_t saved[NUM_VARS];
+                    std::memcpy (saved, mem, sizeof(mem));
+                    if (record) block.edgeFlushes[s] = newExit (c, NONE, 0, 0, EXIT_LOOKUP);
+                    listFlushes (c, b, block.edgeFlushes[s], cur, saved, false, false, record);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    bool changed = false;
+    for (uint32_t var = 0; var < NUM_VARS; ++var)
+    {
+        if (c.memOut[b * NUM_VARS + var] != mem[var]) changed = true;
+        c.memOut[b * NUM_VARS + var] = mem[var];
+    }
+    return changed;
+}
+
+void
+findFlushes (Optimizer& c)
+{
+    // defs hold what each block ends with - find the ones read through
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+        for (uint32_t var = 0; var < NUM_VARS; ++var)
+            if (inScope (c, c.order[i], var)) readVariable (c, var, c.order[i]);
+    for (uint32_t i = 0; i < c.numBlocks * NUM_VARS; ++i) c.memOut[i] = UNSEEN;
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t i = 0; i < c.numOrdered; ++i)
+            if (followBlock (c, c.order[i], false)) changed = true;
+    }
+    for (uint32_t i = 0; i < c.numOrdered; ++i) followBlock (c, c.order[i], true);
+}
+
+//========================================================================
+// Dead code and allocation
+
+// calls use (value) for each value exit x reads
+template <typename F>
+void
+forExitUses (Optimizer& c, uint32_t x, F use)
+{
+    if (x == NONE) return;
+    const OptExit& exit = c.exits[x];
+    if (exit.pcValue != NONE) use (exit.pcValue);
+    for (uint32_t i = 0; i < exit.numFlushes; ++i)
+    {
+        const OptFlush& flush = c.flushes[exit.flushes + i];
+        use (flush.value);
+        if (flush.var >= 16) use (c.entries[c.slotEntry[flush.var - 16]].frameValue);
+    }
+}
+
+// calls use (value) for each value live op v reads (phis excepted)
+template <typename F>
+void
+forUses (Optimizer& c, uint32_t v, F use)
+{
+    const OptValue& x = c.values[v];
+    if (!x.live) return;
+    if (isAliasChecked (c, x))
+    {
+        use (c.entries[c.blocks[x.block].region].frameValue);
+        forExitUses (c, x.alias, use);
+    }
+    switch (x.op)
+    {
+        case OP_BINARY:
+        case OP_BRANCH:
+            use (x.a);
+            use (x.b);
+            break;
+        case OP_LOAD:
+            use (x.a);
+            forExitUses (c, x.fault, use);
+            break;
+        case OP_BYTE_LOOP:
+            use (x.a);
+            if (x.b != NONE) use (x.b);
+            break;
+        case OP_STORE:
+            forExitUses (c, x.fault, use);
+            // fall through
+        case OP_EXIT_IF:
+            use (x.a);
+            use (x.b);
+            forExitUses (c, x.extra, use);
+            break;
+        case OP_EXIT:
+            forExitUses (c, x.extra, use);
+            break;
+        case OP_RANGE_CHECK:
+            use (x.a);
+            if (x.b != NONE) use (x.b);
+            if (c.ranges[x.imm].kind == RANGE_SLOTS) use (c.entries[c.blocks[x.block].region].frameValue);
+            forExitUses (c, x.extra, use);
+            break;
+        default:
+            break;
+    }
+}
+
+// true for ops that have to run even if nothing uses their value
+inline bool
+hasEffect (Optimizer& c, const OptValue& x)
+{
+    if (x.op == OP_BINARY && (x.opcode == OPCODE_DIV || x.opcode == OPCODE_MOD))
+    {
+        // unless the divisor is known not to trap
+        uint32_t divisor = find (c, x.b);
+        return !isConstant (c, divisor) || c.values[divisor].bits == 0 || c.values[divisor].bits == 0xffffffff;
+    }
+    // loads may fault
+    return x.op == OP_LOAD || x.op >= OP_STORE;
+}
+
+// marks the values something needs
+void
+markLive (Optimizer& c)
+{
+    uint32_t* work = (uint32_t*) malloc (c.numValues * sizeof(uint32_t));
+    uint32_t numWork = 0;
+    auto mark = [&] (uint32_t v) {
+        v = find (c, v);
+        if (c.values[v].live) return;
+        c.values[v].live = true;
+        work[numWork++] = v;
+    };
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        forExitUses (c, block.budgetExit, mark);
+        forExitUses (c, block.edgeFlushes[0], mark);
+        forExitUses (c, block.edgeFlushes[1], mark);
+        for (uint32_t j = 0; j < block.numOps; ++j)
+        {
+            uint32_t v = c.ops[block.firstOp + j];
+            if (hasEffect (c, c.values[v])) mark (v);
+        }
+    }
+    while (numWork > 0)
+    {
+        uint32_t v = work[--numWork];
+        const OptValue& x = c.values[v];
+        if (x.op == OP_PHI)
+            for (uint32_t i = 0; i < c.blocks[x.block].numPredecessors; ++i) mark (c.inputs[x.extra + i]);
+        else forUses (c, v, mark);
+    }
+    free (work);
+}
+
+// true for values that need a location
+inline bool
+isAllocated (Optimizer& c, uint32_t v)
+{
+    const OptValue& x = c.values[v];
+    return x.live && x.replacement == NONE && !isConstant (c, v)
+        && (x.op == OP_ENTRY || x.op == OP_PHI || x.op == OP_BINARY || x.op == OP_LOAD || x.op == OP_BYTE_LOOP);
+}
+
+// calls use (value) for what edge s of block b reads - the phi inputs
+// and the write backs
+template <typename F>
+void
+forEdgeUses (Optimizer& c, uint32_t b, uint32_t s, F use)
+{
+    uint32_t next = c.blocks[b].successors[s];
+    uint32_t p = predecessorIndex (c, next, b);
+    for (uint32_t phi = c.blocks[next].phis; phi != NONE; phi = c.values[phi].next)
+        if (c.values[phi].live && c.values[phi].replacement == NONE) use (c.inputs[c.values[phi].extra + p]);
+    forExitUses (c, c.blocks[b].edgeFlushes[s], use);
+}
+
+// true if control can go from b to its successor s
+inline bool
+isEdgeTaken (Optimizer& c, uint32_t b, uint32_t s)
+{
+    OptBlock& block = c.blocks[b];
+    const OptValue& last = c.values[c.ops[block.firstOp + block.numOps - 1]];
+    return last.op == OP_BRANCH || (last.op == OP_JUMP && last.opcode == s);
+}
+
+// numbers the ops, finds where each value is live and gives it a host
+// register or a spill
+bool
+allocate (Optimizer& c)
+{
+    uint32_t numAllocated = 0;
+    for (uint32_t v = 0; v < c.numValues; ++v)
+        if (isAllocated (c, v)) c.values[v].index = numAllocated++;
+    uint32_t* allocated = (uint32_t*) malloc ((numAllocated + 1) * sizeof(uint32_t));
+    for (uint32_t v = 0; v < c.numValues; ++v)
+        if (isAllocated (c, v)) allocated[c.values[v].index] = v;
+
+    // positions - a block's phis and entry values at its start, then its
+    // ops, then its edges at its end
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        block.startPosition = position;
+        position += 2;
+        for (uint32_t j = 0; j < block.numOps; ++j)
+        {
+            c.positions[block.firstOp + j] = position;
+            position += 2;
+        }
+        block.endPosition = position;
+        position += 2;
+    }
+    for (uint32_t v = 0; v < c.numValues; ++v)
+    {
+        OptValue& x = c.values[v];
+        if (!isAllocated (c, v)) continue;
+        x.from = x.op == OP_ENTRY || x.op == OP_PHI ? c.blocks[x.block].startPosition : 0;
+        x.to = 0;
+    }
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        OptBlock& block = c.blocks[c.order[i]];
+        for (uint32_t j = 0; j < block.numOps; ++j)
+        {
+            uint32_t v = c.ops[block.firstOp + j];
+            if (isAllocated (c, v)) c.values[v].from = c.positions[block.firstOp + j];
+        }
+    }
+    for (uint32_t v = 0; v < c.numValues; ++v)
+        if (isAllocated (c, v)) c.values[v].to = c.values[v].from;
+
+    // liveness - what is live at the start of each block, backwards
+    // until nothing changes
+    uint32_t words = numAllocated / 64 + 1;
+    uint64_t* liveIn = (uint64_t*) calloc ((size_t)c.numBlocks * words, sizeof(uint64_t));
+    uint64_t* liveOut = (uint64_t*) calloc ((size_t)c.numBlocks * words, sizeof(uint64_t));
+    uint64_t* live = (uint64_t*) malloc (words * sizeof(uint64_t));
+    auto add = [&] (uint32_t v) {
+        v = find (c, v);
+        if (isAllocated (c, v)) live[c.values[v].index / 64] |= 1ull << (c.values[v].index % 64);
+    };
+    auto remove = [&] (uint32_t v) {
+        if (isAllocated (c, v)) live[c.values[v].index / 64] &= ~(1ull << (c.values[v].index % 64));
+    };
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t i = c.numOrdered; i-- > 0; )
+        {
+            uint32_t b = c.order[i];
+            OptBlock& block = c.blocks[b];
+            std::memset (live, 0, words * sizeof(uint64_t));
+            for (uint32_t s = 0; s < block.numSuccessors; ++s)
+            {
+                if (!isEdgeTaken (c, b, s)) continue;
+                uint64_t* in = &liveIn[(size_t)block.successors[s] * words];
+                for (uint32_t w = 0; w < words; ++w) live[w] |= in[w];
+                forEdgeUses (c, b, s, add);
+            }
+            std::memcpy (&liveOut[(size_t)b * words], live, words * sizeof(uint64_t));
+            for (uint32_t j = block.numOps; j-- > 0; )
+            {
+                uint32_t v = c.ops[block.firstOp + j];
+                remove (v);
+                forUses (c, v, add);
+            }
+            forExitUses (c, block.budgetExit, add);
+            for (uint32_t phi = block.phis; phi != NONE; phi = c.values[phi].next) remove (phi);
+            uint64_t* in = &liveIn[(size_t)b * words];
+            if (std::memcmp (in, live, words * sizeof(uint64_t)) != 0)
+            {
+                std::memcpy (in, live, words * sizeof(uint64_t));
+                changed = true;
+            }
+        }
+    }
+
+    // each value lives from its definition to its last use, or to the
+    // end of the last block it is live out of
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        uint32_t b = c.order[i];
+        OptBlock& block = c.blocks[b];
+        uint32_t at = block.startPosition;
+        auto extend = [&] (uint32_t v) {
+            v = find (c, v);
+            if (isAllocated (c, v) && c.values[v].to < at) c.values[v].to = at;
+        };
+        forExitUses (c, block.budgetExit, extend);
+        for (uint32_t j = 0; j < block.numOps; ++j)
+        {
+            at = c.positions[block.firstOp + j];
+            forUses (c, c.ops[block.firstOp + j], extend);
+        }
+        at = block.endPosition;
+        for (uint32_t s = 0; s < block.numSuccessors; ++s)
+            if (isEdgeTaken (c, b, s)) forEdgeUses (c, b, s, extend);
+        uint64_t* out = &liveOut[(size_t)b * words];
+        for (uint32_t w = 0; w < words; ++w)
+            for (uint64_t bits = out[w]; bits != 0; bits &= bits - 1)
+                extend (allocated[w * 64 + __builtin_ctzll (bits)]);
+    }
+    free (liveIn);
+    free (liveOut);
+    free (live);
+
+    // linear scan, by start
+    std::sort (allocated, allocated + numAllocated, [&] (uint32_t a, uint32_t b) {
+        return c.values[a].from < c.values[b].from;
+    });
+    uint32_t hostHolds[NUM_OPT_HOSTS];
+    // first position each spill is free from - a value spilled late
+    // still needs its spill from where it started
+    uint32_t spillFree[MAX_OPT_SPILLS];
+    for (uint32_t h = 0; h < NUM_OPT_HOSTS; ++h) hostHolds[h] = NONE;
+    for (uint32_t s = 0; s < MAX_OPT_SPILLS; ++s) spillFree[s] = 0;
+    auto spill = [&] (uint32_t v) {
+        for (uint32_t s = 0; s < MAX_OPT_SPILLS; ++s)
+        {
+            if (spillFree[s] > c.values[v].from) continue;
+            spillFree[s] = c.values[v].to + 1;
+            c.values[v].location = SPILLED + s;
+            return;
+        }
+        c.failed = true;
+    };
+    for (uint32_t i = 0; i < numAllocated && !c.failed; ++i)
+    {
+        uint32_t v = allocated[i];
+        OptValue& x = c.values[v];
+        for (uint32_t h = 0; h < NUM_OPT_HOSTS; ++h)
+            if (hostHolds[h] != NONE && c.values[hostHolds[h]].to < x.from) hostHolds[h] = NONE;
+        uint32_t last = 0;
+        for (uint32_t h = 0; h < NUM_OPT_HOSTS; ++h)
+        {
+            if (hostHolds[h] == NONE)
+            {
+                x.location = h;
+                break;
+            }
+            if (c.values[hostHolds[h]].to > c.values[hostHolds[last]].to) last = h;
+        }
+        if (x.location == NONE)
+        {
+            // the value that lives longest goes to memory
+            if (c.values[hostHolds[last]].to > x.to)
+            {
+                spill (hostHolds[last]);
+                x.location = last;
+            }
+            else spill (v);
+        }
+        if (x.location < NUM_OPT_HOSTS) hostHolds[x.location] = v;
+    }
+    free (allocated);
+    return !c.failed;
+}
+
+//========================================================================
+// Code generation
+// scratch registers are eax, ecx and edx
+
+const byte conditions[] = { CC_E, CC_NE, CC_L, CC_LE, CC_G, CC_GE };
+
+inline uint32_t
+locationOf (Optimizer& c, uint32_t v)
+{
+    return c.values[find (c, v)].location;
+}
+
+// <opcode> reg, location
+void
+emitLocation (Optimizer& c, const char* opcode, int length, byte reg, uint32_t location)
+{
+    byte rex = 0x40;
+    if (reg & 8) rex |= 0x04;
+    if (location < SPILLED)
+    {
+        byte host = location == IN_ECX ? ECX : optHosts[location];
+        if (host & 8) rex |= 0x01;
+        if (rex != 0x40) emit8 (c.e, rex);
+        emitBytes (c.e, opcode, length);
+        emit8 (c.e, 0xc0 | ((reg & 7) << 3) | (host & 7));
+    }
+    else
+    {
+        // [rbp + spill]
+        if (rex != 0x40) emit8 (c.e, rex);
+        emitBytes (c.e, opcode, length);
+        emit8 (c.e, 0x85 | ((reg & 7) << 3));
+        emit32 (c.e, offsetof(JitContext, spills) + 4 * (location - SPILLED));
+    }
+}
+
+// <opcode> reg, guest register r in the frame
+void
+emitFrameRegister (Optimizer& c, byte opcode, byte reg, byte r)
+{
+    if (reg & 8) emit8 (c.e, 0x44);
+    emitFrame (c.e, opcode, reg & 7, r * 4);
+}
+
+// scratch register reg <- v
+void
+emitRead (Optimizer& c, byte reg, uint32_t v)
+{
+    v = find (c, v);
+    if (isConstant (c, v)) emitMoveImmediate (c.e, reg, c.values[v].bits);
+    else emitLocation (c, "\x8b", 1, reg, c.values[v].location);
+}
+
+// v <- scratch register reg
+inline void
+emitWrite (Optimizer& c, byte reg, uint32_t v)
+{
+    emitLocation (c, "\x89", 1, reg, c.values[v].location);
+}
+
+// <op> eax, v for ADD..XOR and CMP, where the op is opcode for a
+// register and 81 /extension for a constant
+void
+emitOperation (Optimizer& c, const char* opcode, byte extension, uint32_t v)
+{
+    v = find (c, v);
+    if (isConstant (c, v)) emitImmediateOp (c.e, extension, c.values[v].bits);
+    else emitLocation (c, opcode, 1, EAX, c.values[v].location);
+}
+
+// eax <- address of frame + offset in slot s's entry
+void
+emitSlotAddress (Optimizer& c, uint32_t s)
+{
+    emitRead (c, EAX, c.entries[c.slotEntry[s]].frameValue);
+    if (c.slotOffset[s] != 0) emitImmediateOp (c.e, 0, c.slotOffset[s]);
+    emitWidenAddress (c.e);
+}
+
+// writes back the variables exit x lists
+void
+emitFlushes (Optimizer& c, uint32_t x)
+{
+    const OptExit& exit = c.exits[x];
+    for (uint32_t i = 0; i < exit.numFlushes; ++i)
+    {
+        const OptFlush& flush = c.flushes[exit.flushes + i];
+        uint32_t v = find (c, flush.value);
+        if (flush.var >= 16)
+        {
+            emitSlotAddress (c, flush.var - 16);
+            emitRead (c, ECX, v);
+            emitGuestMemory (c.e, "\x41\x89", 2, ECX);
+        }
+        else if (isConstant (c, v))
+        {
+            emitFrame (c.e, 0xc7, 0, flush.var * 4);
+            emit32 (c.e, c.values[v].bits);
+        }
+        else if (c.values[v].location < NUM_OPT_HOSTS)
+            emitFrameRegister (c, 0x89, optHosts[c.values[v].location], flush.var);
+        else
+        {
+            emitRead (c, ECX, v);
+            emitStoreGuest (c.e, ECX, flush.var);
+        }
+    }
+}
+
+// the code of exit x - writes back, then leaves with the next pc in eax
+void
+emitExitCode (Optimizer& c, uint32_t x)
+{
+    const OptExit& exit = c.exits[x];
+    emitFlushes (c, x);
+    if (exit.pcValue != NONE) emitRead (c, EAX, exit.pcValue);
+    else emitMoveImmediate (c.e, EAX, exit.pc);
+    if (exit.refund != 0)
+    {
+        // add r13, refund
+        emitBytes (c.e, "\x49\x81\xc5", 3);
+        emit32 (c.e, exit.refund);
+    }
+    if (exit.reason == EXIT_LOOKUP) emitJump (c.e, c.jit->dispatch);
+    else
+    {
+        emitMoveImmediate (c.e, EDX, exit.reason);
+        emitJump (c.e, c.jit->exit);
+    }
+}
+
+// the displacement to exit x, compiled after the blocks
+void
+addExitJump (Optimizer& c, byte* displacement, uint32_t x)
+{
+    if (c.numExitJumps == MAX_OPT_EXITS)
+    {
+        c.failed = true;
+        return;
+    }
+    c.exitJumps[c.numExitJumps].displacement = displacement;
+    c.exitJumps[c.numExitJumps++].target = x;
+}
+
+// jcc to exit x
+void
+emitExitIf (Optimizer& c, byte condition, uint32_t x)
+{
+    emit8 (c.e, 0x0f);
+    emit8 (c.e, 0x80 | condition);
+    emit32 (c.e, 0);
+    addExitJump (c, c.e.at - 4, x);
+}
+
+// jmp (or jcc, for a condition other than 0xff) to block b
+void
+emitJumpToBlock (Optimizer& c, byte condition, uint32_t b)
+{
+    if (condition == 0xff) emit8 (c.e, 0xe9);
+    else
+    {
+        emit8 (c.e, 0x0f);
+        emit8 (c.e, 0x80 | condition);
+    }
+    emit32 (c.e, 0);
+    if (c.numFixups == sizeof(c.fixups) / sizeof(c.fixups[0]))
+    {
+        c.failed = true;
+        return;
+    }
+    c.fixups[c.numFixups].displacement = c.e.at - 4;
+    c.fixups[c.numFixups++].target = b;
+}
+
+struct Move
+{
+    uint32_t to;
+    uint32_t from;
+};
+
+// location to <- location from
+void
+emitMove (Optimizer& c, uint32_t to, uint32_t from)
+{
+    if (to == from) return;
+    if (to < SPILLED) emitLocation (c, "\x8b", 1, to == IN_ECX ? ECX : optHosts[to], from);
+    else if (from < SPILLED) emitLocation (c, "\x89", 1, from == IN_ECX ? ECX : optHosts[from], to);
+    else
+    {
+        emitLocation (c, "\x8b", 1, EAX, from);
+        emitLocation (c, "\x89", 1, EAX, to);
+    }
+}
+
+// the write backs and phi moves of edge s of block b - returns false
+// if there are none
+bool
+emitEdgeMoves (Optimizer& c, uint32_t b, uint32_t s, bool emit)
+{
+    uint32_t next = c.blocks[b].successors[s];
+    uint32_t p = predecessorIndex (c, next, b);
+    uint32_t flushes = c.blocks[b].edgeFlushes[s];
+    bool any = flushes != NONE && c.exits[flushes].numFlushes > 0;
+    if (any && emit) emitFlushes (c, flushes);
+
+    Move moves[NUM_VARS * 4];
+    uint32_t numMoves = 0;
+    for (uint32_t phi = c.blocks[next].phis; phi != NONE; phi = c.values[phi].next)
+    {
+        const OptValue& x = c.values[phi];
+        if (!x.live || x.replacement != NONE) continue;
+        uint32_t input = find (c, c.inputs[x.extra + p]);
+        if (isConstant (c, input))
+        {
+            any = true;
+            if (!emit) continue;
+            // mov location, imm32 - constants go last, they block nothing
+            continue;
+        }
+        if (c.values[input].location == x.location) continue;
+        any = true;
+        if (numMoves < NUM_VARS * 4)
+        {
+            moves[numMoves].to = x.location;
+            moves[numMoves++].from = c.values[input].location;
+        }
+        else c.failed = true;
+    }
+    if (!emit) return any;
+
+    // in an order that reads each location before it is written - a
+    // cycle is broken by saving one of its locations in ecx
+    while (numMoves > 0)
+    {
+        bool progress = false;
+        for (uint32_t i = 0; i < numMoves; ++i)
+        {
+            bool blocked = false;
+            for (uint32_t j = 0; j < numMoves && !blocked; ++j)
+                blocked = j != i && moves[j].from == moves[i].to;
+            if (blocked) continue;
+            emitMove (c, moves[i].to, moves[i].from);
+            moves[i] = moves[--numMoves];
+            progress = true;
+            break;
+        }
+        if (progress) continue;
+        emitMove (c, IN_ECX, moves[0].to);
+        for (uint32_t j = 1; j < numMoves; ++j)
+            if (moves[j].from == moves[0].to) moves[j].from = IN_ECX;
+    }
+    for (uint32_t phi = c.blocks[next].phis; phi != NONE; phi = c.values[phi].next)
+    {
+        const OptValue& x = c.values[phi];
+        if (!x.live || x.replacement != NONE) continue;
+        uint32_t input = find (c, c.inputs[x.extra + p]);
+        if (!isConstant (c, input)) continue;
+        emitLocation (c, "\xc7", 1, 0, x.location);
+        emit32 (c.e, c.values[input].bits);
+    }
+    return any;
+}
+
+// goes along edge s of block b - the jump is left out if the successor
+// comes next
+void
+emitEdge (Optimizer& c, uint32_t b, uint32_t s)
+{
+    emitEdgeMoves (c, b, s, true);
+    uint32_t next = c.blocks[b].successors[s];
+    uint32_t after = c.blocks[b].order + 1;
+    if (after < c.numOrdered && c.order[after] == next) return;
+    emitJumpToBlock (c, 0xff, next);
+}
+
+// leaves for x's alias exit if the access at address eax overlaps
+// the slots of its region - a word at most 3 bytes below the lowest
+// up to the end of the highest
+void
+emitAliasCheck (Optimizer& c, const OptValue& x)
+{
+    if (!isAliasChecked (c, x)) return;
+    const OptEntry& entry = c.entries[c.blocks[x.block].region];
+    // mov ecx, eax ; sub ecx, frame
+    emitBytes (c.e, "\x89\xc1", 2);
+    emitLocation (c, "\x2b", 1, ECX, locationOf (c, entry.frameValue));
+    // add ecx, 3 - lowest ; cmp ecx, highest + 4 - (lowest - 3) ; jb exit
+    emitBytes (c.e, "\x81\xc1", 2);
+    emit32 (c.e, (uint32_t)(3 - entry.lowest));
+    emitBytes (c.e, "\x81\xf9", 2);
+    emit32 (c.e, (uint32_t)(entry.highest + 7 - entry.lowest));
+    emitExitIf (c, CC_B, x.alias);
+}
+
+// holds the budget back to what the number of iterations in rcx
+// (shifted left by the range's shift, plus 1) costs
+void
+emitBudgetLimit (Optimizer& c, const OptRange& range)
+{
+    // shr rcx, shift ; inc rcx ; imul rcx, rcx, perIteration ; dec rcx
+    if (range.shift != 0)
+    {
+        emitBytes (c.e, "\x48\xc1\xe9", 3);
+        emit8 (c.e, range.shift);
+    }
+    emitBytes (c.e, "\x48\xff\xc1\x48\x69\xc9", 6);
+    emit32 (c.e, range.perIteration);
+    emitBytes (c.e, "\x48\xff\xc9", 3);
+    // cmp r13, rcx ; jbe done ; sub r13, rcx ; add [rbp + reserve], r13 ;
+    // mov r13, rcx
+    emitBytes (c.e, "\x49\x39\xcd", 3);
+    byte* done = emitShortJumpIf (c.e, CC_BE);
+    emitBytes (c.e, "\x49\x29\xcd\x4c\x01\x6d", 6);
+    emit8 (c.e, offsetof(JitContext, reserve));
+    emitBytes (c.e, "\x49\x89\xcd", 3);
+    patchShortJump (c.e, done);
+}
+
+// the check of a loop's accesses before it is entered - leaves if the
+// first address is already too close to what they have to keep clear
+// of, and otherwise holds the budget back so the loop cannot get there
+// (unless it moves away from it)
+void
+emitRangeCheck (Optimizer& c, uint32_t b, const OptValue& x)
+{
+    const OptRange& range = c.ranges[x.imm];
+    // edx = a + b
+    emitRead (c, EAX, x.a);
+    if (x.b != NONE) emitOperation (c, "\x03", 0, x.b);
+    emitBytes (c.e, "\x89\xc2", 2);
+    if (range.kind == RANGE_PROGRAM)
+    {
+        // movsxd rax, edx + lowest ; cmp rax, r15 ; jl exit
+        if (range.lowest != 0) emitImmediateOp (c.e, 0, range.lowest);
+        emitWidenAddress (c.e);
+        emitBytes (c.e, "\x4c\x39\xf8", 3);
+        emitExitIf (c, CC_L, x.extra);
+        if (range.up) return;
+        // moving down - mov rcx, rax ; sub rcx, r15
+        emitBytes (c.e, "\x48\x89\xc1\x4c\x29\xf9", 6);
+        emitBudgetLimit (c, range);
+        return;
+    }
+
+    // the slots are from frame + lowest - 3 (where a word would overlap
+    // them) up to frame + highest + 4
+    const OptEntry& entry = c.entries[c.blocks[b].region];
+    int32_t start = entry.lowest - 3;
+    int32_t end = entry.highest + 4;
+    // movsxd rax, edx + the offset nearest to them
+    emitImmediateOp (c.e, 0, range.up ? range.lowest : range.highest);
+    emitWidenAddress (c.e);
+    // movsxd rcx, frame ; add rcx, end (start) ; cmp rax, rcx ; jge (jl) done
+    emitRead (c, ECX, entry.frameValue);
+    emitBytes (c.e, "\x48\x63\xc9\x48\x81\xc1", 6);
+    emit32 (c.e, range.up ? end : start);
+    emitBytes (c.e, "\x48\x39\xc8", 3);
+    byte* done = emitShortJumpIf (c.e, range.up ? CC_GE : CC_L);
+    // coming closer - movsxd rdx, edx + the offset farthest from them
+    emitBytes (c.e, "\x81\xc2", 2);
+    emit32 (c.e, range.up ? range.highest : range.lowest);
+    emitBytes (c.e, "\x48\x63\xd2", 3);
+    if (range.up)
+    {
+        // add rcx, start - 1 - end ; sub rcx, rdx ; jl exit
+        emitBytes (c.e, "\x48\x81\xc1", 3);
+        emit32 (c.e, start - 1 - end);
+        emitBytes (c.e, "\x48\x29\xd1", 3);
+    }
+    else
+    {
+        // add rcx, end - start ; sub rdx, rcx ; mov rcx, rdx ; jl exit
+        emitBytes (c.e, "\x48\x81\xc1", 3);
+        emit32 (c.e, end - start);
+        emitBytes (c.e, "\x48\x29\xca\x48\x89\xd1", 6);
+    }
+    emitExitIf (c, CC_L, x.extra);
+    emitBudgetLimit (c, range);
+    patchShortJump (c.e, done);
+}
+
+// the kernel of a byte loop (see Byte loops) - leaves the iterations it
+// ran in eax and charges the budget for them
+void
+emitByteLoop (Optimizer& c, uint32_t v)
+{
+    const OptValue& x = c.values[v];
+    const OptByteLoop& loop = c.byteLoops[x.imm];
+    bool wide = __builtin_cpu_supports ("avx2");
+    byte width = wide ? 32 : 16;
+    // where it gives up, patched once that is emitted
+    byte* none[8];
+    uint32_t numNone = 0;
+    auto emitGiveUpIf = [&] (byte condition) {
+        emit8 (c.e, 0x0f);
+        emit8 (c.e, 0x80 | condition);
+        emit32 (c.e, 0);
+        none[numNone++] = c.e.at - 4;
+    };
+
+    // push rsi ; push rdi ; movsxd rsi, a (; movsxd rdi, b)
+    emitRead (c, EAX, x.a);
+    if (loop.copy) emitRead (c, ECX, x.b);
+    emitBytes (c.e, "\x56\x57\x48\x63\xf0", 5);
+    if (loop.copy) emitBytes (c.e, "\x48\x63\xf9", 3);
+    // rdx = the bytes it may look at - no more than the budget, nor than
+    // there are in memory after each address:
+    // mov rdx, r13 ; mov rax, memorySize
+    emitBytes (c.e, "\x4c\x89\xea\x48\xb8", 5);
+    uint64_t size = c.memorySize;
+    std::memcpy (c.e.at, &size, 8);
+    c.e.at += 8;
+    for (int i = 0; i < (loop.copy ? 2 : 1); ++i)
+    {
+        // mov rcx, rax ; sub rcx, rsi (rdi) ; jbe none ; cmp rcx, rdx ;
+        // cmovb rdx, rcx
+        emitBytes (c.e, i == 0 ? "\x48\x89\xc1\x48\x29\xf1" : "\x48\x89\xc1\x48\x29\xf9", 6);
+        emitGiveUpIf (CC_BE);
+        emitBytes (c.e, "\x48\x39\xd1\x48\x0f\x42\xd1", 7);
+    }
+    // add rsi, r12 (; add rdi, r12) ; add rdx, rsi ; mov rax, rsi
+    emitBytes (c.e, "\x4c\x01\xe6", 3);
+    if (loop.copy) emitBytes (c.e, "\x4c\x01\xe7", 3);
+    emitBytes (c.e, "\x48\x01\xf2\x48\x89\xf0", 6);
+    // the terminator in every byte of xmm0/ymm0 - mov ecx, terminator *
+    // 0x01010101 ; movd xmm0, ecx ; pshufd xmm0, xmm0, 0 (vmovd xmm0, ecx ;
+    // vpbroadcastb ymm0, xmm0)
+    emitMoveImmediate (c.e, ECX, loop.terminator * 0x01010101u);
+    if (wide) emitBytes (c.e, "\xc5\xf9\x6e\xc1\xc4\xe2\x7d\x78\xc0", 9);
+    else      emitBytes (c.e, "\x66\x0f\x6e\xc1\x66\x0f\x70\xc0\x00", 9);
+
+    // a byte at a time up to an aligned chunk, which cannot reach into a
+    // page the loop would not:
+    // cmp rax, rdx ; jae none ; test al, width - 1 ; jz chunks ;
+    // cmp byte [rax], terminator ; je (jne) found ; inc rax ; jmp bytes
+    byte* bytes = c.e.at;
+    emitBytes (c.e, "\x48\x39\xd0", 3);
+    emitGiveUpIf (CC_AE);
+    emit8 (c.e, 0xa8);
+    emit8 (c.e, width - 1);
+    byte* aligned = emitShortJumpIf (c.e, CC_E);
+    emitBytes (c.e, "\x80\x38", 2);
+    emit8 (c.e, loop.terminator);
+    byte* foundByte = emitShortJumpIf (c.e, loop.untilEqual ? CC_E : CC_NE);
+    emitBytes (c.e, "\x48\xff\xc0", 3);
+    emitJump (c.e, bytes);
+    // chunks - cmp rax, rdx ; jae none ; the bytes of [rax] that are the
+    // terminator in ecx (that are not) ; test ecx, ecx ; jnz found ;
+    // add rax, width ; jmp chunks
+    patchShortJump (c.e, aligned);
+    byte* chunks = c.e.at;
+    emitBytes (c.e, "\x48\x39\xd0", 3);
+    emitGiveUpIf (CC_AE);
+    // movdqa xmm1, [rax] ; pcmpeqb xmm1, xmm0 ; pmovmskb ecx, xmm1 (; xor
+    // ecx, 0xffff) - or their AVX2 forms (; not ecx)
+    if (wide) emitBytes (c.e, "\xc5\xfd\x6f\x08\xc5\xf5\x74\xc8\xc5\xfd\xd7\xc9", 12);
+    else      emitBytes (c.e, "\x66\x0f\x6f\x08\x66\x0f\x74\xc8\x66\x0f\xd7\xc9", 12);
+    if (!loop.untilEqual)
+    {
+        if (wide) emitBytes (c.e, "\xf7\xd1", 2);
+        else      emitBytes (c.e, "\x81\xf1\xff\xff\x00\x00", 6);
+    }
+    emitBytes (c.e, "\x85\xc9", 2);
+    byte* foundChunk = emitShortJumpIf (c.e, CC_NE);
+    emitBytes (c.e, "\x48\x83\xc0", 3);
+    emit8 (c.e, width);
+    emitJump (c.e, chunks);
+    // bsf ecx, ecx ; add rax, rcx
+    patchShortJump (c.e, foundChunk);
+    emitBytes (c.e, "\x0f\xbc\xc9\x48\x01\xc8", 6);
+
+    // found - cmp rax, rdx ; jae none ; sub rax, rsi. the budget has to
+    // cover the iterations before it and the one that leaves:
+    // imul rcx, rax, perIteration ; add rcx, perIteration ; cmp r13, rcx ;
+    // jb none
+    patchShortJump (c.e, foundByte);
+    emitBytes (c.e, "\x48\x39\xd0", 3);
+    emitGiveUpIf (CC_AE);
+    emitBytes (c.e, "\x48\x29\xf0\x48\x69\xc8", 6);
+    emit32 (c.e, loop.perIteration);
+    emitBytes (c.e, "\x48\x81\xc1", 3);
+    emit32 (c.e, loop.perIteration);
+    emitBytes (c.e, "\x49\x39\xcd", 3);
+    emitGiveUpIf (CC_B);
+    byte* copied = nullptr;
+    if (loop.copy)
+    {
+        // test rax, rax ; jz done ; nothing is copied if a store would
+        // reach a byte still to be read - mov rcx, rdi ; sub rcx, rsi ;
+        // jbe copy ; cmp rcx, rax ; jbe none
+        emitBytes (c.e, "\x48\x85\xc0", 3);
+        copied = emitShortJumpIf (c.e, CC_E);
+        emitBytes (c.e, "\x48\x89\xf9\x48\x29\xf1", 6);
+        byte* safe = emitShortJumpIf (c.e, CC_BE);
+        emitBytes (c.e, "\x48\x39\xc1", 3);
+        emitGiveUpIf (CC_BE);
+        patchShortJump (c.e, safe);
+        // mov rdx, rax - then a chunk at a time: cmp rdx, width ; jb tail ;
+        // movdqu xmm1, [rsi] ; movdqu [rdi], xmm1 (or their AVX2 forms) ;
+        // add rsi, width ; add rdi, width ; sub rdx, width ; jmp chunks
+        emitBytes (c.e, "\x48\x89\xc2", 3);
+        byte* copyChunks = c.e.at;
+        emitBytes (c.e, "\x48\x83\xfa", 3);
+        emit8 (c.e, width);
+        byte* tail = emitShortJumpIf (c.e, CC_B);
+        if (wide) emitBytes (c.e, "\xc5\xfe\x6f\x0e\xc5\xfe\x7f\x0f", 8);
+        else      emitBytes (c.e, "\xf3\x0f\x6f\x0e\xf3\x0f\x7f\x0f", 8);
+        const char add[3][3] = { { 0x48, (char)0x83, (char)0xc6 }, { 0x48, (char)0x83, (char)0xc7 },
+            { 0x48, (char)0x83, (char)0xea } };
+        for (int i = 0; i < 3; ++i)
+        {
+            emitBytes (c.e, add[i], 3);
+            emit8 (c.e, width);
+        }
+        emitJump (c.e, copyChunks);
+        // tail - mov rcx, rdx ; rep movsb
+        patchShortJump (c.e, tail);
+        emitBytes (c.e, "\x48\x89\xd1\xf3\xa4", 5);
+    }
+    // jmp done ; none - xor eax, eax
+    emitBytes (c.e, "\xeb\x00", 2);
+    byte* done = c.e.at - 1;
+    for (uint32_t i = 0; i < numNone; ++i)
+    {
+        uint32_t displacement = (uint32_t)(c.e.at - (none[i] + 4));
+        std::memcpy (none[i], &displacement, 4);
+    }
+    emitBytes (c.e, "\x31\xc0", 2);
+    // done - imul rcx, rax, perIteration ; sub r13, rcx (; vzeroupper) ;
+    // pop rdi ; pop rsi
+    patchShortJump (c.e, done);
+    if (copied != nullptr) patchShortJump (c.e, copied);
+    emitBytes (c.e, "\x48\x69\xc8", 3);
+    emit32 (c.e, loop.perIteration);
+    emitBytes (c.e, "\x49\x29\xcd", 3);
+    if (wide) emitBytes (c.e, "\xc5\xf8\x77", 3);
+    emitBytes (c.e, "\x5f\x5e", 2);
+    emitWrite (c, EAX, v);
+}
+
+// checks what entry e assumes, then loads the values it starts with
+void
+emitGuard (Optimizer& c, uint32_t e, uint32_t x)
+{
+    OptEntry& entry = c.entries[e];
+    if (entry.related)
+    {
+        // sp - bp == relation
+        emitLoadGuest (c.e, EAX, sp);
+        emitFrame (c.e, 0x2b, EAX, bp * 4);
+        emitImmediateOp (c.e, 7, entry.relation);
+        emitExitIf (c, CC_NE, x);
+    }
+    // the slots are above the program and inside memory
+    if (entry.hasSlots)
+    {
+        // movsxd rax, [frame] ; add rax, lowest ; cmp rax, r15 ; jl exit
+        emitBytes (c.e, "\x48\x63\x43", 3);
+        emit8 (c.e, entry.frame * 4);
+        emitBytes (c.e, "\x48\x05", 2);
+        emit32 (c.e, entry.lowest);
+        emitBytes (c.e, "\x4c\x39\xf8", 3);
+        emitExitIf (c, CC_L, x);
+        // movsxd rax, [frame] ; add rax, highest + 4 ; mov rcx, memorySize ;
+        // cmp rax, rcx ; jg exit
+        emitBytes (c.e, "\x48\x63\x43", 3);
+        emit8 (c.e, entry.frame * 4);
+        emitBytes (c.e, "\x48\x05", 2);
+        emit32 (c.e, entry.highest + 4);
+        emitBytes (c.e, "\x48\xb9", 2);
+        uint64_t size = c.memorySize;
+        std::memcpy (c.e.at, &size, 8);
+        c.e.at += 8;
+        emitBytes (c.e, "\x48\x39\xc8", 3);
+        emitExitIf (c, CC_G, x);
+    }
+
+    for (uint32_t v = 0; v < c.numValues; ++v)
+    {
+        const OptValue& value = c.values[v];
+        if (value.op != OP_ENTRY || value.block != entry.block || !isAllocated (c, v)) continue;
+        if (value.var < 16)
+        {
+            if (value.location < NUM_OPT_HOSTS) emitFrameRegister (c, 0x8b, optHosts[value.location], value.var);
+            else
+            {
+                emitLoadGuest (c.e, EAX, value.var);
+                emitWrite (c, EAX, v);
+            }
+            continue;
+        }
+        // a slot - [frame + offset]
+        emitLoadGuest (c.e, EAX, entry.frame);
+        int32_t offset = c.slotOffset[value.var - 16];
+        if (offset != 0) emitImmediateOp (c.e, 0, offset);
+        emitWidenAddress (c.e);
+        emitGuestMemory (c.e, "\x41\x8b", 2, EAX);
+        emitWrite (c, EAX, v);
+    }
+}
+
+void
+emitOp (Optimizer& c, uint32_t b, uint32_t v)
+{
+    const OptValue& x = c.values[v];
+    switch (x.op)
+    {
+        case OP_BINARY:
+        {
+            if (!x.live) break;
+            uint32_t k = c.values[find (c, x.b)].bits;
+            bool constantRight = isConstant (c, find (c, x.b));
+            byte result = EAX;
+            emitRead (c, EAX, x.a);
+            switch (x.opcode)
+            {
+                case OPCODE_ADD: emitOperation (c, "\x03", 0, x.b); break;
+                case OPCODE_SUB: emitOperation (c, "\x2b", 5, x.b); break;
+                case OPCODE_OR:  emitOperation (c, "\x0b", 1, x.b); break;
+                case OPCODE_AND: emitOperation (c, "\x23", 4, x.b); break;
+                case OPCODE_XOR: emitOperation (c, "\x33", 6, x.b); break;
+                case OPCODE_MUL:
+                    if (constantRight)
+                    {
+                        // imul eax, eax, imm32
+                        emitBytes (c.e, "\x69\xc0", 2);
+                        emit32 (c.e, k);
+                    }
+                    else emitLocation (c, "\x0f\xaf", 2, EAX, locationOf (c, x.b));
+                    break;
+                case OPCODE_DIV:
+                case OPCODE_MOD:
+                    emitRead (c, ECX, x.b);
+                    // cdq ; idiv ecx
+                    emitBytes (c.e, "\x99\xf7\xf9", 3);
+                    if (x.opcode == OPCODE_MOD) result = EDX;
+                    break;
+                default:
+                {
+                    byte extension = x.opcode == OPCODE_SLL ? 4 : x.opcode == OPCODE_SRL ? 5 : 7;
+                    if (constantRight) emitShiftByImmediate (c.e, extension, k & 31);
+                    else
+                    {
+                        emitRead (c, ECX, x.b);
+                        emitShiftByCl (c.e, extension);
+                    }
+                    break;
+                }
+            }
+            // unused divisions still run (they may trap)
+            if (isAllocated (c, v)) emitWrite (c, result, v);
+            break;
+        }
+        case OP_LOAD:
+            if (!x.live) break;
+            emitRead (c, EAX, x.a);
+            if (x.imm != 0) emitImmediateOp (c.e, 0, x.imm);
+            emitAliasCheck (c, x);
+            emitWidenAddress (c.e);
+            addExitJump (c, emitFaultMarker (c.e), x.fault);
+            if (x.opcode == OPCODE_LB)      emitGuestMemory (c.e, "\x41\x0f\xb6", 3, EAX); // movzx
+            else if (x.opcode == OPCODE_LH) emitGuestMemory (c.e, "\x41\x0f\xbf", 3, EAX); // movsx
+            else                            emitGuestMemory (c.e, "\x41\x8b", 2, EAX);
+            emitWrite (c, EAX, v);
+            break;
+        case OP_STORE:
+            emitRead (c, EAX, x.a);
+            if (x.imm != 0) emitImmediateOp (c.e, 0, x.imm);
+            emitAliasCheck (c, x);
+            emitRead (c, ECX, x.b);
+            emitWidenAddress (c.e);
+            addExitJump (c, emitFaultMarker (c.e), x.fault);
+            if (x.opcode == OPCODE_SB)      emitGuestMemory (c.e, "\x41\x88", 2, ECX);
+            else if (x.opcode == OPCODE_SH) emitGuestMemory (c.e, "\x66\x41\x89", 3, ECX);
+            else                            emitGuestMemory (c.e, "\x41\x89", 2, ECX);
+            if (x.extra != NONE)
+            {
+                // cmp eax, r15d
+                emitBytes (c.e, "\x44\x39\xf8", 3);
+                emitExitIf (c, CC_B, x.extra);
+            }
+            break;
+        case OP_GUARD:
+            emitGuard (c, c.blocks[b].entry, x.extra);
+            break;
+        case OP_RANGE_CHECK:
+            emitRangeCheck (c, b, x);
+            break;
+        case OP_BYTE_LOOP:
+            if (x.live) emitByteLoop (c, v);
+            break;
+        case OP_EXIT_IF:
+            emitRead (c, EAX, x.a);
+            emitOperation (c, "\x3b", 7, x.b);
+            emitExitIf (c, conditions[x.opcode - OPCODE_BEQ], x.extra);
+            break;
+        case OP_EXIT:
+            emitExitCode (c, x.extra);
+            break;
+        case OP_JUMP:
+            emitEdge (c, b, x.opcode);
+            break;
+        case OP_BRANCH:
+        {
+            emitRead (c, EAX, x.a);
+            emitOperation (c, "\x3b", 7, x.b);
+            byte condition = conditions[x.opcode - OPCODE_BEQ];
+            if (!emitEdgeMoves (c, b, 1, false))
+            {
+                emitJumpToBlock (c, condition, c.blocks[b].successors[1]);
+                emitEdge (c, b, 0);
+                break;
+            }
+            // x86 conditions come in pairs - c ^ 1 is the opposite
+            emit8 (c.e, 0x0f);
+            emit8 (c.e, 0x80 | (condition ^ 1));
+            emit32 (c.e, 0);
+            byte* notTaken = c.e.at - 4;
+            emitEdgeMoves (c, b, 1, true);
+            emitJumpToBlock (c, 0xff, c.blocks[b].successors[1]);
+            uint32_t displacement = (uint32_t)(c.e.at - (notTaken + 4));
+            std::memcpy (notTaken, &displacement, 4);
+            emitEdge (c, b, 0);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// compiles the function - returns false if it does not fit
+bool
+emitFunction (Optimizer& c)
+{
+    JitState* jit = c.jit;
+    c.e.at = jit->buffer + jit->used;
+    c.limit = jit->buffer + JIT_BUFFER_SIZE - MAX_OPT_OP_BYTES;
+    c.numFixups = 0;
+    c.numExitJumps = 0;
+    for (uint32_t i = 0; i < c.numOrdered; ++i)
+    {
+        uint32_t b = c.order[i];
+        OptBlock& block = c.blocks[b];
+        block.code = c.e.at;
+        if (block.length > 0)
+        {
+            // cmp r13, length ; jb exit ; sub r13, length
+            emitBytes (c.e, "\x49\x81\xfd", 3);
+            emit32 (c.e, block.length);
+            emitExitIf (c, CC_B, block.budgetExit);
+            emitBytes (c.e, "\x49\x81\xed", 3);
+            emit32 (c.e, block.length);
+        }
+        for (uint32_t j = 0; j < block.numOps; ++j)
+        {
+            if (c.e.at > c.limit || c.failed) return false;
+            emitOp (c, b, c.ops[block.firstOp + j]);
+        }
+    }
+    // exits out of line, each once however many jumps go there
+    for (uint32_t i = 0; i < c.numExitJumps; ++i)
+    {
+        OptExit& exit = c.exits[c.exitJumps[i].target];
+        if (exit.code == nullptr)
+        {
+            if (c.e.at > c.limit) return false;
+            exit.code = c.e.at;
+            emitExitCode (c, c.exitJumps[i].target);
+        }
+        uint32_t displacement = (uint32_t)(exit.code - (c.exitJumps[i].displacement + 4));
+        std::memcpy (c.exitJumps[i].displacement, &displacement, 4);
+    }
+    for (uint32_t i = 0; i < c.numFixups; ++i)
+    {
+        byte* target = c.blocks[c.fixups[i].target].code;
+        uint32_t displacement = (uint32_t)(target - (c.fixups[i].displacement + 4));
+        std::memcpy (c.fixups[i].displacement, &displacement, 4);
+    }
+    return !c.failed;
+}
+
+//========================================================================
+
+bool
+isOptimizable (JitState* jit, MachineState& state, uint32_t pc)
+{
+    if (jit->optimizer == nullptr) jit->optimizer = (Optimizer*) calloc (1, sizeof(Optimizer));
+    Optimizer& c = *jit->optimizer;
+    if (c.cfg == nullptr || c.cfgVersion != state.codeVersion || c.codeSize != state.codeSize)
+    {
+        // the program changed - analyze it again
+        freeControlFlowGraph (c.cfg);
+        free (c.candidates);
+        free (c.blockAt);
+        free (c.cfgSeen);
+        free (c.cfgList);
+        c.cfg = buildControlFlowGraph (state.memory, state.codeSize, state.memorySize);
+        c.cfgVersion = state.codeVersion;
+        c.codeSize = state.codeSize;
+        c.candidates = (byte*) calloc (c.codeSize / 4 + 1, 1);
+        c.blockAt = (uint32_t*) malloc ((c.codeSize / 4 + 1) * sizeof(uint32_t));
+        std::memset (c.blockAt, 0xff, (c.codeSize / 4 + 1) * sizeof(uint32_t));
+        c.cfgSeen = (byte*) calloc (c.cfg->numBlocks + 1, 1);
+        c.cfgList = (uint32_t*) malloc ((c.cfg->numBlocks + 1) * sizeof(uint32_t));
+        resetOptimizer (jit);
+    }
+    return pc < c.codeSize && c.candidates[pc / 4] != 0;
+}
+
+void*
+optimizeFunction (JitState* jit, MachineState& state, uint32_t pc)
+{
+    Optimizer& c = *jit->optimizer;
+    if (!reserveCode (jit, MAX_OPT_BYTES)) return nullptr;
+    // tried once until the translated code is thrown away
+    c.candidates[pc / 4] = 0;
+    c.jit = jit;
+    c.memory = state.memory;
+    c.memorySize = state.memorySize;
+    c.numSlots = 0;
+
+    bool compiled = buildBlocks (c, pc);
+    if (compiled)
+    {
+        orderBlocks (c);
+        // slots found after a block that reads them were not in scope
+        // there - lift again knowing all of them
+        lift (c);
+        if (!c.failed && c.slotsChanged) lift (c);
+        compiled = !c.failed && !c.slotsChanged;
+    }
+    if (compiled)
+    {
+        removeTrivialPhis (c);
+        hoistChecks (c);
+        vectorizeLoops (c);
+        findFlushes (c);
+        markLive (c);
+        compiled = !c.failed && allocate (c) && emitFunction (c);
+    }
+    for (uint32_t b = 0; b < c.numBlocks; ++b)
+        if (c.blocks[b].kind == BLOCK_CODE) c.blockAt[c.blocks[b].start / 4] = NONE;
+    if (!compiled) return nullptr;
+
+    jit->used = c.e.at - jit->buffer;
+    for (uint32_t e = 0; e < c.numEntries; ++e)
+    {
+        // (an entry at an instruction left to the interpreter would only
+        // leave for itself)
+        OptBlock& block = c.blocks[c.entries[e].block];
+        if (block.order != NONE && isTranslatable (c.memory[c.entries[e].pc]))
+            installBlock (jit, c.entries[e].pc, block.code);
+    }
+    return jit->blocks[pc / 4];
+}
+
+void
+resetOptimizer (JitState* jit)
+{
+    Optimizer* c = jit->optimizer;
+    if (c == nullptr || c->cfg == nullptr) return;
+    std::memset (c->candidates, 0, c->codeSize / 4 + 1);
+    for (uint32_t f = 0; f < c->cfg->numFunctions; ++f)
+        c->candidates[c->cfg->functions[f].entry / 4] = 1;
+}
+
+void
+releaseOptimizer (JitState* jit)
+{
+    Optimizer* c = jit->optimizer;
+    if (c == nullptr) return;
+    freeControlFlowGraph (c->cfg);
+    free (c->candidates);
+    free (c->blockAt);
+    free (c->cfgSeen);
+    free (c->cfgList);
+    free (c);
+    jit->optimizer = nullptr;
+}
+
+#endif
+
+//========================================================================
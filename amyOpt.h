@@ -0,0 +1,37 @@
+// AmyMachine optimizing tier
+// compiles whole functions of the program (as the control flow graph
+// finds them) through an SSA form - constants are folded, dead register
+// writes dropped, stack slots kept in host registers and pushes/pops
+// that only save and restore a register forwarded - and emits x86-64
+// code that runs alongside the JIT's blocks and traces
+// By Amy Burnett
+//========================================================================
+
+#ifndef AMY_OPT_H
+#define AMY_OPT_H
+
+#include "amyJitCode.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+//========================================================================
+
+// true if pc is the entry of a function the optimizing tier has not
+// tried to compile yet
+bool isOptimizable (JitState* jit, MachineState& state, uint32_t pc);
+
+// compiles the function entered at pc and returns the code for pc, or
+// null if it cannot be compiled (it is not tried again until the
+// translated code is thrown away)
+void* optimizeFunction (JitState* jit, MachineState& state, uint32_t pc);
+
+// forgets which functions were compiled - called when the translated
+// code is thrown away
+void resetOptimizer (JitState* jit);
+void releaseOptimizer (JitState* jit);
+
+#endif
+
+//========================================================================
+
+#endif
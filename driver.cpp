@@ -11,7 +11,10 @@
 
 typedef unsigned char byte; 
 
-bool DEBUG = false; 
+// driver has no -d flag, so debug output is chosen when compiling. 
+// being a constant lets the compiler drop every debug branch from 
+// the execution loop in the release build 
+const bool DEBUG = false; 
 
 //========================================================================
 // Instructions 
@@ -7,291 +7,24 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>   //memcpy
+#include <unistd.h>  //read
 
-//========================================================================
+#include "amyMachine.h"
+#include "amyCfg.h"
 
-typedef unsigned char byte; 
+//========================================================================
 
 bool DEBUG = false; 
 // 1MB by default 
 size_t MEMORY_SIZE_BYTES = 1000000; 
-
-//========================================================================
-// Instructions 
-
-// Using a similar language to RISC-V
-// all instructions are 32-bit
-
-// makes sure each opcode is unique
-// opcode 0 is not defined 
-// which will halt the program with an error 
-byte opcode_counter = 0b00000001;
-
-// LUI dest, imm        - loads upper immediate 16 bits into given register
-// XXXXXXXX dddd0000 iiiiiiii iiiiiiii
-byte OPCODE_LUI = opcode_counter++;
-// LLI dest, imm        - loads lower immediate 16 bits into given register
-// XXXXXXXX dddd0000 iiiiiiii iiiiiiii
-byte OPCODE_LLI = opcode_counter++;
-// LB dest, offset(src) - load byte 
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_LB = opcode_counter++;
-// LH dest, offset(src) - load half (2 bytes)
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_LH = opcode_counter++;
-// LW dest, offset(src) - load word (4 bytes)
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_LW = opcode_counter++;
-// SB offset(dest), src - store byte
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_SB = opcode_counter++;
-// SH offset(dest), src - store half (2 bytes)
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_SH = opcode_counter++;
-// SW offset(dest), src - store word (4 bytes)
-// XXXXXXXX ddddssss oooooooo oooooooo
-byte OPCODE_SW = opcode_counter++;
-
-// arithmetic instructions
-// ADD dest, src1, src2 - integer addition
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_ADD = opcode_counter++;
-// SUB dest, src1, src2 - integer subtraction
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_SUB = opcode_counter++;
-// MUL dest, src1, src2 - integer multiplication
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_MUL = opcode_counter++;
-// DIV dest, src1, src2 - integer division
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_DIV = opcode_counter++;
-// MOD dest, src1, src2 - integer division remainder
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_MOD = opcode_counter++;
-// SLL dest, src1, src2 - shift left logical
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_SLL = opcode_counter++;
-// SRL dest, src1, src2 - shift right logical
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_SRL = opcode_counter++;
-// SRA dest, src1, src2 - shift right arithmetic
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_SRA = opcode_counter++;
-// OR  dest, src1, src2 - bitwise or
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_OR  = opcode_counter++;
-// AND dest, src1, src2 - bitwise and
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_AND = opcode_counter++;
-// XOR dest, src1, src2 - bitwise xor 
-// XXXXXXXX ddddssss ssss0000 00000000
-byte OPCODE_XOR = opcode_counter++;
-
-// immediate arithmetic instructions
-// immediate values are 16-bit signed
-// ADDI dest, src1, imm - integer addition with immediate
-// - can be used to load immediate into register 
-// - that's why there is no load immediate 
-// - ADDI r0, rzero, 42 : r0 <- 0 + 42
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_ADDI = opcode_counter++;
-// SUBI dest, src1, imm - integer subtraction with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_SUBI = opcode_counter++;
-// MULI dest, src1, src2 - integer multiplication with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_MULI = opcode_counter++;
-// DIVI dest, src1, src2 - integer division with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_DIVI = opcode_counter++;
-// MODI dest, src1, src2 - integer division remainder with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_MODI = opcode_counter++;
-// SLLI dest, src1, imm - shift left logical with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_SLLI = opcode_counter++;
-// SRLI dest, src1, imm - shift right logical with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_SRLI = opcode_counter++;
-// SRAI dest, src1, imm - shift right arithmetic with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_SRAI = opcode_counter++;
-// ORI  dest, src1, imm - bitwise or with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_ORI  = opcode_counter++;
-// ANDI dest, src1, imm - bitwise and with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_ANDI = opcode_counter++;
-// XORI dest, src1, imm - bitwise xor  with immediate
-// XXXXXXXX ddddssss iiiiiiii iiiiiiii
-byte OPCODE_XORI = opcode_counter++;
-
-// branching
-// BEQ src1, src2, addr - if src1 == src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BEQ = opcode_counter++;
-// BNE src1, src2, addr - if src1 != src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BNE = opcode_counter++;
-// BLT src1, src2, addr - if src1 <  src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BLT = opcode_counter++;
-// BLE src1, src2, addr - if src1 <= src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BLE = opcode_counter++;
-// BGT src1, src2, addr - if src1 >  src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BGT = opcode_counter++;
-// BGE src1, src2, addr - if src1 >= src2 then pc <- addr
-// XXXXXXXX ssssssss aaaa0000 00000000
-byte OPCODE_BGE = opcode_counter++;
-// JMP addr - pc <- addr
-// XXXXXXXX aaaa0000 00000000 00000000
-byte OPCODE_JMP = opcode_counter++;
-
-// function instructions
-// CALL addr
-// 1. pushes return address on to the stack
-// 2. changes pc to addr
-// base pointer should be pushed on the stack by the callee
-// push bp
-// mov bp, sp
-// Caller's actions
-// 1. push caller saved registers
-// 2. push args in reverse order (callee can access with arg0 = [bp+8], arg1 = [bp+12])
-// 3. call function
-// Call's actions
-// 1. push return addr
-// 2. pc <- addr 
-// Callee's actions 
-// 1. push caller's bp 
-// 2. align our frame's bp and sp (mov bp, sp)
-// 3. allocate space for local vars (sub sp, sp, <#bytes>)
-//    local vars can be access with bp - 0, bp - 4, bp - 8, etc
-// 4. push callee saved registers onto stack 
-//    these need to be restored because caller 
-//    expects these values to be unchanged. 
-// XXXXXXXX aaaa0000 00000000 00000000
-byte OPCODE_CALL = opcode_counter++;
-// RET - pc <- [bp]
-// changes the current pc to the return address pointed to by bp
-// Callee's actions before returning
-// 1. store any return value in ra (return value register)
-// 2. restore callee-saved registers 
-// 3. pop local vars off of stack (mov sp, bp) (sp <- bp)
-// 4. restore caller's bp (pop bp)
-// Return's actions 
-// 1. pops return address off of stack and stores in pc (pop pc) 
-// Caller's actions after returning 
-// 1. pop any arguments that were pushed onto the stack (add sp, sp, <#bytes>)
-// 2. pop any caller saved registers back into their respective registers (pop r#)
-// XXXXXXXX 00000000 00000000 00000000
-byte OPCODE_RET = opcode_counter++;
-// PUSH src - sp -= 4 ; [sp] <- src
-// 1. decrements sp by 4 (bytes)
-// 2. places src onto stack at [sp]
-// XXXXXXXX ssss0000 00000000 00000000
-byte OPCODE_PUSH = opcode_counter++;
-// POP dest - dest <- [sp] ; sp += 4
-// 1. moves [sp] into dest 
-// 2. increments sp by 4 (bytes)
-// XXXXXXXX dddd0000 00000000 00000000
-byte OPCODE_POP = opcode_counter++;
-
-// other instructions
-// NOP - no operation
-// XXXXXXXX 000000000 00000000 00000000
-byte OPCODE_NOP = opcode_counter++;
-// HLT - halts the computer
-// XXXXXXXX 000000000 00000000 00000000
-byte OPCODE_HLT = opcode_counter++;
-// GETCHAR - reads (from stdin) a char (1-byte) and stores it in the 
-// given register
-// XXXXXXXX dddd00000 00000000 00000000
-byte OPCODE_GETCHAR = opcode_counter++;
-// PUTCHAR - outputs (to stdout) a char (1-byte) from the given register
-// XXXXXXXX ssss00000 00000000 00000000
-byte OPCODE_PUTCHAR = opcode_counter++;
-
-
-//========================================================================
-
-void 
-printMemory (byte* memory, int memory_size, int bytesPerLine=4)
-{
-    printf ("=== MEMORY ===================================================\n");
-    size_t numSameLines = 0; 
-    // start prevLine with something that wont be the same as the first line
-    int prevLine = (*(int*)&memory[0]) - 1; 
-    for (int i = 0; i < memory_size; i+=bytesPerLine)
-    {
-        // ensure line is new - otherwise ignore the line
-        int line = *(int*)&memory[i];
-        if (line == prevLine)
-        {
-            numSameLines++;
-            // ignore the line 
-            continue; 
-        }
-        else if (numSameLines > 0)
-        {
-            printf ("             ^ repeated %lu times\n", numSameLines);
-            numSameLines = 0;
-        }
-        prevLine = line; 
-
-        // print address 
-        printf (
-            "0x%x%x%x%x%x%x%x%x | ", 
-            (0b11110000000000000000000000000000 & i) >> 28,
-            (0b00001111000000000000000000000000 & i) >> 24,
-            (0b00000000111100000000000000000000 & i) >> 20,
-            (0b00000000000011110000000000000000 & i) >> 16,
-            (0b00000000000000001111000000000000 & i) >> 12,
-            (0b00000000000000000000111100000000 & i) >>  8,
-            (0b00000000000000000000000011110000 & i) >>  4,
-            (0b00000000000000000000000000001111 & i) >>  0
-        );
-        // print binary representation (4 bytes per line)
-        for (int j = i; j < i+bytesPerLine; ++j)
-        {
-            printf (
-                "%d%d%d%d%d%d%d%d ",
-                (0b10000000 & memory[j]) >> 7,
-                (0b01000000 & memory[j]) >> 6,
-                (0b00100000 & memory[j]) >> 5,
-                (0b00010000 & memory[j]) >> 4,
-                (0b00001000 & memory[j]) >> 3,
-                (0b00000100 & memory[j]) >> 2,
-                (0b00000010 & memory[j]) >> 1,
-                (0b00000001 & memory[j]) >> 0
-            );
-        }
-        printf ("| ");
-        // print hex representation
-        for (int j = i; j < i+bytesPerLine; ++j)
-        {
-            printf (
-                "%x%x ",
-                (0b11110000 & memory[j]) >> 4,
-                (0b00001111 & memory[j]) >> 0
-            );
-        }
-        printf ("\n");
-    }
-    if (numSameLines > 0)
-    {
-        printf ("             ^ repeated %lu times\n", numSameLines);
-        numSameLines = 0;
-    }
-    printf ("=== END MEMORY ===============================================\n");
-}
+// max instructions to run before giving up (0 means no limit) 
+uint64_t INSTRUCTION_LIMIT = 0; 
 
 //========================================================================
 
 bool isNumber(const char* str)
 {
-    for (int i = 0; i < strlen(str); ++i) {
+    for (size_t i = 0; i < strlen(str); ++i) {
         if (std::isdigit(str[i]) == 0) return false;
     }
     return true;
@@ -300,21 +33,80 @@ bool isNumber(const char* str)
 int 
 main(int argc, char *argv[])
 {
+    Engine engine = ENGINE_TIERED; 
+    bool verify = false; 
+    bool showCfg = false; 
+    const char* aotPath = nullptr; 
+    const char* cachePath = nullptr; 
+    const char* imagePath = nullptr; 
+
     // Parse commandline args 
     if (argc > 1)
     {
         for (int i = 1; i < argc; ++i)
         {
             if (strcmp(argv[i], "-d") == 0) DEBUG = true; 
-            // --size <numBytes>
+            // --engine=<reference|switch|threaded|jit|tiered|opt> - which engine runs the program 
+            if (strncmp(argv[i], "--engine=", 9) == 0) 
+            {
+                engine = engineByName (argv[i] + 9);
+                if (engine == NUM_ENGINES)
+                {
+                    printf ("Unknown engine '%s'\n", argv[i] + 9);
+                    return 1; 
+                }
+            }
+            // --reference - same as --engine=reference 
+            if (strcmp(argv[i], "--reference") == 0) engine = ENGINE_REFERENCE; 
+            // --verify - refuse to run a program that fails verification 
+            if (strcmp(argv[i], "--verify") == 0) verify = true; 
+            // --cfg - print the program's control flow graph instead of running it 
+            if (strcmp(argv[i], "--cfg") == 0) showCfg = true; 
+            // --aot <file> - compile the program into a native executable 
+            // (and <file>.cpp) instead of running it 
+            if (strcmp(argv[i], "--aot") == 0 && i+1 < argc) 
+            {
+                aotPath = argv[i+1];
+                ++i; 
+            }
+            // --cache <dir> - keep the decoded program and its control flow 
+            // graph in dir for the next run of the same image 
+            if (strcmp(argv[i], "--cache") == 0 && i+1 < argc) 
+            {
+                cachePath = argv[i+1];
+                ++i; 
+            }
+            // --image <file> - run a program image from a file instead of 
+            // the built-in program 
+            if (strcmp(argv[i], "--image") == 0 && i+1 < argc) 
+            {
+                imagePath = argv[i+1];
+                ++i;
+            }
+            // --size <numBytes> - up to MAX_MEMORY_SIZE, only the pages 
+            // the program touches are ever allocated 
             if (strcmp(argv[i], "--size") == 0) 
             {
                 // ensure N was provided and is a number
                 if (i+1 < argc && isNumber(argv[i+1]))
                 {
-                    MEMORY_SIZE_BYTES = atoi(argv[i+1]);
+                    MEMORY_SIZE_BYTES = strtoull(argv[i+1], nullptr, 10);
                     // ensure all lines are 4-bytes 
                     MEMORY_SIZE_BYTES = MEMORY_SIZE_BYTES - (MEMORY_SIZE_BYTES % 4) + 4;
+                    if (MEMORY_SIZE_BYTES > MAX_MEMORY_SIZE)
+                    {
+                        printf ("Memory size must be at most %zu bytes\n", MAX_MEMORY_SIZE);
+                        return 1; 
+                    }
+                    ++i;
+                }
+            }
+            // --limit <numInstructions> - stop runaway programs 
+            if (strcmp(argv[i], "--limit") == 0) 
+            {
+                if (i+1 < argc && isNumber(argv[i+1]))
+                {
+                    INSTRUCTION_LIMIT = strtoull(argv[i+1], nullptr, 10);
                     ++i;
                 }
             }
@@ -324,7 +116,10 @@ main(int argc, char *argv[])
 
     // allocate memory for the program 
     if (DEBUG) printf ("Allocating %lu Bytes\n", MEMORY_SIZE_BYTES);
-    byte* memory = (byte*) malloc(MEMORY_SIZE_BYTES);
+    AmyMachine machine (MEMORY_SIZE_BYTES);
+    machine.debug = DEBUG; 
+    machine.engine = engine; 
+    if (cachePath != nullptr) machine.useCache (cachePath);
 
     // define instructions 
     // byte instructions[] = {
@@ -1167,623 +962,82 @@ main(int argc, char *argv[])
     };
 
     // move instructions into memory 
-    std::memcpy (memory, instructions, sizeof(instructions));
-
-    // print bytes 
-    if (DEBUG)
+    if (imagePath == nullptr)
     {
-        printMemory (memory, MEMORY_SIZE_BYTES);
+        if (!machine.load (instructions, sizeof(instructions))) return 1; 
     }
-
-    // execute instructions 
-    if (DEBUG) printf ("Running Program\n");
-
-    unsigned int currentInstructionAddress = 0x00;  // 4 byte (32-bit) instruction register
-    // 2^4 32-bit (4-byte) registers
-    byte* registers = (byte*) malloc (16 * 4);
-    // r0-r12  - general purpose registers (Callee Saved - saved on stack)
-    // r13    0xd - return value  (ra)
-    byte ra = 13; 
-    // r14    0xe - base pointer  (bp)
-    byte bp = 14;
-    // r15    0xf - stack pointer (sp)
-    byte sp = 15; 
-
-    // bp and sp start at the end of memory 
-    *(int*)&registers[bp*4] = MEMORY_SIZE_BYTES - (MEMORY_SIZE_BYTES % 4); 
-    *(int*)&registers[sp*4] = MEMORY_SIZE_BYTES - (MEMORY_SIZE_BYTES % 4); 
-
-    while (currentInstructionAddress < MEMORY_SIZE_BYTES)
+    else 
     {
-        // we have to pack the instruction into the int using big endian 
-        unsigned int instruction = memory[currentInstructionAddress];
-        instruction = instruction << 8; 
-        instruction |= memory[currentInstructionAddress+1];
-        instruction = instruction << 8; 
-        instruction |= memory[currentInstructionAddress+2];
-        instruction = instruction << 8; 
-        instruction |= memory[currentInstructionAddress+3];
-        byte opcode = (0b11111111000000000000000000000000 & instruction) >> 24;
-
-        if (DEBUG)
-        {
-            // print address
-            printf (
-                "0x%x%x%x%x%x%x%x%x | ", 
-                (0b11110000000000000000000000000000 & currentInstructionAddress) >> 28,
-                (0b00001111000000000000000000000000 & currentInstructionAddress) >> 24,
-                (0b00000000111100000000000000000000 & currentInstructionAddress) >> 20,
-                (0b00000000000011110000000000000000 & currentInstructionAddress) >> 16,
-                (0b00000000000000001111000000000000 & currentInstructionAddress) >> 12,
-                (0b00000000000000000000111100000000 & currentInstructionAddress) >>  8,
-                (0b00000000000000000000000011110000 & currentInstructionAddress) >>  4,
-                (0b00000000000000000000000000001111 & currentInstructionAddress) >>  0
-            );
-            // print instruction 
-            printf (
-                "%x%x %x%x %x%x %x%x\n", 
-                (0b11110000000000000000000000000000 & instruction) >> 28,
-                (0b00001111000000000000000000000000 & instruction) >> 24,
-                (0b00000000111100000000000000000000 & instruction) >> 20,
-                (0b00000000000011110000000000000000 & instruction) >> 16,
-                (0b00000000000000001111000000000000 & instruction) >> 12,
-                (0b00000000000000000000111100000000 & instruction) >>  8,
-                (0b00000000000000000000000011110000 & instruction) >>  4,
-                (0b00000000000000000000000000001111 & instruction) >>  0
-            );
-        }
-
-
-        // LUI dest, imm        - loads upper immediate 16 bits into given register
-        // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
-        if (opcode == OPCODE_LUI)
-        {
-            byte dest = (0b00000000111100000000000000000000 & instruction) >> 20;
-            // imm acts as the upper 16 bits of the register 
-            registers[dest*4+0] = (0b00000000000000001111111100000000 & instruction) >> 8; 
-            registers[dest*4+1] = (0b00000000000000000000000011111111 & instruction) >> 0; 
-        }
-        // LLI dest, imm        - loads lower immediate 16 bits into given register
-        // XXXXXXXX dddd0000 iiiiiiii iiiiiiii
-        else if (opcode == OPCODE_LLI)
-        {
-            byte dest = (0b00000000111100000000000000000000 & instruction) >> 20;
-            // imm acts as the lower 16 bits of the register 
-            registers[dest*4+2] = (0b00000000000000001111111100000000 & instruction) >> 8; 
-            registers[dest*4+3] = (0b00000000000000000000000011111111 & instruction) >> 0; 
-        }
-        // LB dest, offset(src) - load byte 
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        // offset should be specified in little endian (least -> most significant byte)
-        else if (opcode == OPCODE_LB)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[src1*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // clear register bytes
-            *(int*)&(registers[dest*4]) = 0; 
-            // read in byte 
-            *(int*)&(registers[dest*4]) = (unsigned int)memory[address+offset];
-        }
-        // LH dest, offset(src) - load half (2 bytes)
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        else if (opcode == OPCODE_LH)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[src1*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // clear register bytes
-            *(int*)&(registers[dest*4]) = 0; 
-            // read in half word (2 bytes) 
-            *(int*)&(registers[dest*4]) = (unsigned int)*(short*)&memory[address+offset];
-        }
-        // LW dest, offset(src) - load word (4 bytes)
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        else if (opcode == OPCODE_LW)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[src1*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // clear register bytes
-            *(int*)&(registers[dest*4]) = 0; 
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = (unsigned int)*(int*)&memory[address+offset];
-        }
-        // SB offset(dest), src - store byte
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        else if (opcode == OPCODE_SB)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[dest*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // store byte 
-            *(byte*)&(memory[address+offset]) = *(byte*)&(registers[src1*4]);
-        }
-        // SH offset(dest), src - store half (2 bytes)
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        else if (opcode == OPCODE_SH)
+        FILE* file = fopen (imagePath, "rb");
+        if (file == nullptr)
         {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[dest*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // store half word (2 bytes)
-            *(int16_t*)&(memory[address+offset]) = *(int16_t*)&(registers[src1*4]);
-        }
-        // SW offset(dest), src - store word (4 bytes)
-        // XXXXXXXX ddddssss oooooooo oooooooo
-        else if (opcode == OPCODE_SW)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int address = *(int*)&registers[dest*4];
-            // read offset in little endian
-            int offset = *(int16_t*)&memory[currentInstructionAddress+2];
-            // store half word (2 bytes)
-            *(int*)&(memory[address+offset]) = *(int*)&(registers[src1*4]);
-        }
-
-        // arithmetic instructions
-        // ADD dest, src1, src2 - integer addition
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_ADD)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] + *(int*)&registers[src2*4];
-        }
-        // SUB dest, src1, src2 - integer subtraction
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_SUB)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] - *(int*)&registers[src2*4];
-        }
-        // MUL dest, src1, src2 - integer multiplication
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_MUL)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] * *(int*)&registers[src2*4];
-        }
-        // DIV dest, src1, src2 - integer division
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_DIV)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] / *(int*)&registers[src2*4];
-        }
-        // MOD dest, src1, src2 - integer division remainder
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_MOD)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] % *(int*)&registers[src2*4];
-        }
-        // SLL dest, src1, src2 - shift left logical
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_SLL)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] << *(int*)&registers[src2*4];
-        }
-        // SRL dest, src1, src2 - shift right logical
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_SRL)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(unsigned int*)&registers[src1*4] >> *(unsigned int*)&registers[src2*4];
-        }
-        // SRA dest, src1, src2 - shift right arithmetic
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_SRA)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] >> *(int*)&registers[src2*4];
-        }
-        // OR  dest, src1, src2 - bitwise or
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_OR)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] | *(int*)&registers[src2*4];
-        }
-        // AND dest, src1, src2 - bitwise and
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_AND)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] & *(int*)&registers[src2*4];
-        }
-        // XOR dest, src1, src2 - bitwise xor 
-        // XXXXXXXX ddddssss ssss0000 00000000
-        else if (opcode == OPCODE_XOR)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte src2   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] ^ *(int*)&registers[src2*4];
-        }
-
-        // immediate arithmetic instructions
-        // immediate values are 14-bit signed
-        // ADDI dest, src1, imm - integer addition with immediate
-        // - can be used to load immediate into register 
-        // - that's why there is no load immediate 
-        // - ADDI r0, rzero, 42 : r0 <- 0 + 42
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_ADDI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] + imm;
-        }
-        // SUBI dest, src1, imm - integer subtraction with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_SUBI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] - imm;
-        }
-        // MULI dest, src1, src2 - integer multiplication with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_MULI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] * imm;
-        }
-        // DIVI dest, src1, src2 - integer division with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_DIVI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] / imm;
-        }
-        // MODI dest, src1, src2 - integer division remainder with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_MODI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] % imm;
-        }
-        // SLLI dest, src1, imm - shift left logical with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_SLLI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] << imm;
-        }
-        // SRLI dest, src1, imm - shift right logical with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_SRLI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            unsigned int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(unsigned int*)&registers[src1*4] >> imm;
-        }
-        // SRAI dest, src1, imm - shift right arithmetic with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_SRAI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] >> imm;
-        }
-        // ORI  dest, src1, imm - bitwise or with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_ORI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] | imm;
-        }
-        // ANDI dest, src1, imm - bitwise and with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_ANDI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] & imm;
-        }
-        // XORI dest, src1, imm - bitwise xor  with immediate
-        // XXXXXXXX ddddssss ssssiiii iiiiiiii
-        else if (opcode == OPCODE_XORI)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src1   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            int  imm    = *(int16_t*)&memory[currentInstructionAddress+2];
-            // read in word (4 bytes) 
-            *(int*)&(registers[dest*4]) = *(int*)&registers[src1*4] ^ imm;
-        }
-
-        // branching
-        // BEQ src1, src2, addr - if src1 == src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BEQ)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] == *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // BNE src1, src2, addr - if src1 != src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BNE)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] != *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // BLT src1, src2, addr - if src1 <  src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BLT)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] < *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // BLE src1, src2, addr - if src1 <= src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BLE)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] <= *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // BGT src1, src2, addr - if src1 >  src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BGT)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] > *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // BGE src1, src2, addr - if src1 >= src2 then pc <- addr
-        // XXXXXXXX ssssssss aaaa0000 00000000
-        else if (opcode == OPCODE_BGE)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            byte src2   = (0b00000000000011110000000000000000 & instruction) >> 16;
-            byte addr   = (0b00000000000000001111000000000000 & instruction) >> 12;
-            if (*(int*)&registers[src1*4] >= *(int*)&registers[src2*4])
-                currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // JMP addr - pc <- addr
-        // XXXXXXXX aaaa0000 00000000 00000000
-        else if (opcode == OPCODE_JMP)
-        {
-            byte addr   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-
-        // function instructions 
-        // CALL addr
-        // 1. pushes return address on to the stack
-        // 2. changes pc to addr
-        // base pointer should be pushed on the stack by the callee
-        // push bp
-        // mov bp, sp
-        // Caller's actions
-        // 1. push caller saved registers
-        // 2. push args in reverse order
-        // 3. call function
-        // Call's actions
-        // 1. push return addr
-        // 2. pc <- addr 
-        // Callee's actions 
-        // 1. push caller's bp 
-        // 2. align our frame's bp and sp (mov bp, sp)
-        // 3. allocate space for local vars (sub sp, sp, <#bytes>)
-        //    local vars can be access with bp - 0, bp - 4, bp - 8, etc
-        // 4. push callee saved registers onto stack 
-        //    these need to be restored because caller 
-        //    expects these values to be unchanged. 
-        // XXXXXXXX aaaa0000 00000000 00000000
-        else if (opcode == OPCODE_CALL)
-        {
-            byte addr   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            // push return address onto stack 
-            *(int*)&registers[sp*4] -= 4; // stack grows towards 0
-            *(unsigned int*)&memory[*(int*)&registers[sp*4]] = currentInstructionAddress;
-            // change program counter to addr 
-            currentInstructionAddress = (*(int*)&registers[addr*4])-4;
-        }
-        // RET - pc <- [bp]
-        // changes the current pc to the return address pointed to by bp
-        // Callee's actions before returning
-        // 1. store any return value in ra (return value register)
-        // 2. restore callee-saved registers 
-        // 3. pop local vars off of stack (mov sp, bp) (sp <- bp)
-        // 4. restore caller's bp (pop bp)
-        // Return's actions 
-        // 1. pops return address off of stack and stores in pc (pop pc) 
-        // Caller's actions after returning 
-        // 1. pop any arguments that were pushed onto the stack (add sp, sp, <#bytes>)
-        // 2. pop any caller saved registers back into their respective registers (pop r#)
-        // XXXXXXXX 00000000 00000000 00000000
-        else if (opcode == OPCODE_RET)
-        {
-            // pop return address from stack into 
-            currentInstructionAddress = *(unsigned int*)&memory[*(int*)&registers[sp*4]];
-            *(int*)&registers[sp*4] += 4; // stack shrinks towards MEM_SIZE
-        }
-        // PUSH src - sp -= 4 ; [sp] <- src
-        // 1. decrements sp by 4 (bytes)
-        // 2. places src onto stack at [sp]
-        // XXXXXXXX ssss0000 00000000 00000000
-        else if (opcode == OPCODE_PUSH)
-        {
-            byte src    = (0b00000000111100000000000000000000 & instruction) >> 20;
-            *(int*)&registers[sp*4] -= 4; // stack grows towards 0
-            *(int*)&memory[*(int*)&registers[sp*4]] = *(int*)&registers[src*4];
-        }
-        // POP dest - dest <- [sp] ; sp += 4
-        // 1. moves [sp] into dest 
-        // 2. increments sp by 4 (bytes)
-        // XXXXXXXX dddd0000 00000000 00000000
-        else if (opcode == OPCODE_POP)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            *(int*)&registers[dest*4] = *(int*)&memory[*(int*)&registers[sp*4]]; 
-            *(int*)&registers[sp*4] += 4; // stack shrinks towards MEM_SIZE
-        }
-
-        // NOP - no operation
-        // XXXXXXXX 000000000 00000000 00000000
-        else if (opcode == OPCODE_NOP)
-        {
-            
-        }
-        // other instructions
-        // HLT - halts the computer
-        // XXXXXXXX 000000000 00000000 00000000
-        else if (opcode == OPCODE_HLT)
-        {
-            break; 
-        }
-        // GETCHAR - reads (from stdin) a char (1-byte) and stores it in the 
-        // given register
-        // XXXXXXXX dddd00000 00000000 00000000
-        else if (opcode == OPCODE_GETCHAR)
-        {
-            byte dest   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            *(int*)&registers[dest*4] = getchar();
-        }
-        // PUTCHAR - outputs (to stdout) a char (1-byte) from the given register
-        // XXXXXXXX ssss00000 00000000 00000000
-        else if (opcode == OPCODE_PUTCHAR)
-        {
-            byte src1   = (0b00000000111100000000000000000000 & instruction) >> 20;
-            if (DEBUG) printf ("Output = '");
-            putchar(*(int*)&registers[src1*4]);
-            if (DEBUG) printf ("'\n");
-        }
-        // unknown instruction
-        else
-        {
-            printf ("Invalid opcode %x%x\n", 
-                (0b11110000 & opcode) >> 4,
-                (0b00001111 & opcode) >> 0
-            );
-            break; 
+            printf ("Could not open image '%s'\n", imagePath);
+            return 1; 
         }
+        fseek (file, 0, SEEK_END);
+        size_t size = ftell (file);
+        fseek (file, 0, SEEK_SET);
+        byte* image = (byte*) malloc (size);
+        size = fread (image, 1, size, file);
+        fclose (file);
+        bool loaded = machine.load (image, size);
+        free (image);
+        if (!loaded) return 1; 
+    }
 
+    // print bytes 
+    if (DEBUG)
+    {
+        printMemory (machine.state.memory, MEMORY_SIZE_BYTES);
+    }
 
+    if (verify && !machine.verify ())
+    {
+        printf ("Program failed verification\n");
+        return 1; 
+    }
 
+    if (showCfg)
+    {
+        printControlFlowGraph (machine.controlFlow ());
+        return 0; 
+    }
 
-        // go to next instruction 
-        // each instruction is 4 bytes; 
-        currentInstructionAddress += 4; 
+    if (aotPath != nullptr)
+        return machine.compileNative (aotPath) ? 0 : 1; 
 
-        // print register file
-        if (DEBUG)
-        {
-            printf("registers:\n");
-            for (int i = 0; i < 16*4; i+=4)
-            {
-                printf(
-                    "   r%2d: %x%x %x%x %x%x %x%x ",
-                    i/4,
-                    (0b11110000 & registers[i+0]) >> 4,
-                    (0b00001111 & registers[i+0]) >> 0,
-                    (0b11110000 & registers[i+1]) >> 4,
-                    (0b00001111 & registers[i+1]) >> 0,
-                    (0b11110000 & registers[i+2]) >> 4,
-                    (0b00001111 & registers[i+2]) >> 0,
-                    (0b11110000 & registers[i+3]) >> 4,
-                    (0b00001111 & registers[i+3]) >> 0
-                );
-                // special registers
-                if (i/4 == ra) printf ("(ra)");
-                if (i/4 == bp) printf ("(bp)");
-                if (i/4 == sp) printf ("(sp)");
-                printf("\n");
-            }
-        }
+    // execute instructions 
+    if (DEBUG) printf ("Running Program\n");
 
+    // the machine returns whenever it needs more input 
+    uint64_t budget = INSTRUCTION_LIMIT == 0 ? UINT64_MAX : INSTRUCTION_LIMIT; 
+    RunResult result; 
+    while (true)
+    {
+        uint64_t remaining = budget - machine.state.instructionsRetired; 
+        result = machine.run (remaining);
+        if (result != RUN_WAITING_FOR_INPUT) break; 
+
+        // the program may have prompted for the input 
+        fflush (stdout);
+        byte buffer[4096]; 
+        ssize_t count = read (0, buffer, sizeof(buffer));
+        if (count <= 0) machine.closeInput ();
+        else            machine.provideInput (buffer, count);
     }
 
+    if (result == RUN_BUDGET_EXHAUSTED)
+        printf ("Instruction limit reached at %x\n", machine.state.currentInstructionAddress);
+
     if (DEBUG) printf ("Program Finished\n");
 
     // print bytes 
     if (DEBUG)
     {
-        printMemory (memory, MEMORY_SIZE_BYTES);
+        printMemory (machine.state.memory, MEMORY_SIZE_BYTES);
     }
 
 }
 
 //========================================================================
+
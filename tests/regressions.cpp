@@ -0,0 +1,485 @@
+// AmyMachine regression programs
+// runs each program on every engine and checks that it ends in the same
+// state (registers, pc, instructions retired and memory) as it does on
+// the reference engine
+// By Amy Burnett
+//========================================================================
+
+#include <stdio.h>
+#include <cstring>   //memcmp
+#include <string>
+#include <unistd.h>  //dup
+
+#include "amyMachine.h"
+
+//========================================================================
+// Programs
+
+// a loop storing twice through the same pointer, in a function called
+// often enough to be compiled - both stores share one induction variable
+// when their checks are hoisted out of the loop
+const byte loopTwoStores[] = {
+// main:
+    OPCODE_LUI,     0x10, 0x00, 0x00, // [0x00] r1 <- 0         - i = 0
+    OPCODE_LLI,     0x10, 0x00, 0x00, // [0x04] r1 <- 0x0000
+    OPCODE_LUI,     0x50,  100, 0x00, // [0x08] r5 <- 100       - count
+    OPCODE_LLI,     0x50, 0x00, 0x00, // [0x0c] r5 <- 0x0000
+// loop:
+    OPCODE_MODI,    0x31,   26, 0x00, // [0x10] r3 <- r1 % 26
+    OPCODE_ADDI,    0x33,  'A', 0x00, // [0x14] r3 <- r3 + 'A'  - byte to fill with
+    OPCODE_LUI,     0xc0, 0x38, 0x00, // [0x18] r12 <- 0x0038   - fill
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x1c] r12 <- 0x0000
+    OPCODE_CALL,    0xc0, 0x00, 0x00, // [0x20] call r12
+    OPCODE_ADDI,    0x11, 0x01, 0x00, // [0x24] r1 <- r1 + 1
+    OPCODE_LUI,     0xc0, 0x10, 0x00, // [0x28] r12 <- 0x0010   - loop
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x2c] r12 <- 0x0000
+    OPCODE_BLT,     0x15, 0xc0, 0x00, // [0x30] if r1 < r5 then pc <- r12
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x34] end of program
+// fill: - [0x1000..0x1100) <- r3
+    OPCODE_PUSH,    0xe0, 0x00, 0x00, // [0x38] push bp
+    OPCODE_ADDI,    0xef, 0x00, 0x00, // [0x3c] bp <- sp + 0
+    OPCODE_PUSH,    0x10, 0x00, 0x00, // [0x40] push r1
+    OPCODE_PUSH,    0x20, 0x00, 0x00, // [0x44] push r2
+    OPCODE_LUI,     0x10, 0x00, 0x10, // [0x48] r1 <- 0x1000    - pointer
+    OPCODE_LLI,     0x10, 0x00, 0x00, // [0x4c] r1 <- 0x0000
+    OPCODE_LUI,     0x20, 0x00, 0x11, // [0x50] r2 <- 0x1100    - end
+    OPCODE_LLI,     0x20, 0x00, 0x00, // [0x54] r2 <- 0x0000
+// fillLoop:
+    OPCODE_SB,      0x13, 0x00, 0x00, // [0x58] [r1 + 0] <- r3
+    OPCODE_SB,      0x13, 0x01, 0x00, // [0x5c] [r1 + 1] <- r3
+    OPCODE_ADDI,    0x11, 0x02, 0x00, // [0x60] r1 <- r1 + 2
+    OPCODE_LUI,     0xc0, 0x58, 0x00, // [0x64] r12 <- 0x0058   - fillLoop
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x68] r12 <- 0x0000
+    OPCODE_BLT,     0x12, 0xc0, 0x00, // [0x6c] if r1 < r2 then pc <- r12
+    OPCODE_POP,     0x20, 0x00, 0x00, // [0x70] pop r2
+    OPCODE_POP,     0x10, 0x00, 0x00, // [0x74] pop r1
+    OPCODE_ADDI,    0xfe, 0x00, 0x00, // [0x78] sp <- bp + 0
+    OPCODE_POP,     0xe0, 0x00, 0x00, // [0x7c] pop bp
+    OPCODE_RET,     0x00, 0x00, 0x00, // [0x80] return
+};
+
+// PUSHes that write instructions over the ones after them - a single
+// PUSH, a run of them and a function prologue (PUSH bp ; ADDI bp, sp, 0).
+// r1 ends as 1 + 5 + 7 + 7 + 9 = 29, and is printed
+const byte pushIntoCode[] = {
+    OPCODE_LUI,     0x10, 0x01, 0x00, // [0x00] r1 <- 1
+    OPCODE_LLI,     0x10, 0x00, 0x00, // [0x04] r1 <- 0x0000
+    OPCODE_LUI,     0x20, OPCODE_ADDI, 0x11, // [0x08] r2 <- ADDI r1, r1, 5
+    OPCODE_LLI,     0x20, 0x05, 0x00, // [0x0c] r2 <- 0x0005
+    OPCODE_LUI,     0xf0, 0x20, 0x00, // [0x10] sp <- 0x20
+    OPCODE_LLI,     0xf0, 0x00, 0x00, // [0x14] sp <- 0x0000
+    OPCODE_PUSH,    0x20, 0x00, 0x00, // [0x18] push r2     - [0x1c] <- r2
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x1c] becomes ADDI r1, r1, 5
+    OPCODE_LUI,     0x30, OPCODE_ADDI, 0x11, // [0x20] r3 <- ADDI r1, r1, 7
+    OPCODE_LLI,     0x30, 0x07, 0x00, // [0x24] r3 <- 0x0007
+    OPCODE_LUI,     0xf0, 0x40, 0x00, // [0x28] sp <- 0x40
+    OPCODE_LLI,     0xf0, 0x00, 0x00, // [0x2c] sp <- 0x0000
+    OPCODE_PUSH,    0x30, 0x00, 0x00, // [0x30] push r3     - [0x3c] <- r3
+    OPCODE_PUSH,    0x30, 0x00, 0x00, // [0x34] push r3     - [0x38] <- r3
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x38] becomes ADDI r1, r1, 7
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x3c] becomes ADDI r1, r1, 7
+    OPCODE_LUI,     0xe0, OPCODE_ADDI, 0x11, // [0x40] bp <- ADDI r1, r1, 9
+    OPCODE_LLI,     0xe0, 0x09, 0x00, // [0x44] bp <- 0x0009
+    OPCODE_LUI,     0xf0, 0x5c, 0x00, // [0x48] sp <- 0x5c
+    OPCODE_LLI,     0xf0, 0x00, 0x00, // [0x4c] sp <- 0x0000
+    OPCODE_PUSH,    0xe0, 0x00, 0x00, // [0x50] push bp     - [0x58] <- bp
+    OPCODE_ADDI,    0xef, 0x00, 0x00, // [0x54] bp <- sp + 0
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x58] becomes ADDI r1, r1, 9
+    OPCODE_PUTCHAR, 0x10, 0x00, 0x00, // [0x5c] putchar r1
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x60] end of program
+};
+
+// a CALL whose return address lands on the instruction it returns to,
+// after that instruction has already run once. the return address 0x2c
+// reads as GETCHAR r0, so the second time through r0 gets EOF (-1) and
+// r1 is not incremented again. r1 is printed
+const byte callIntoCode[] = {
+    OPCODE_LUI,     0xc0, 0x5c, 0x00, // [0x00] r12 <- 0x005c   - f
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x04] r12 <- 0x0000
+    OPCODE_LUI,     0x50, 0x34, 0x00, // [0x08] r5 <- 0x34      - low stack
+    OPCODE_LLI,     0x50, 0x00, 0x00, // [0x0c] r5 <- 0x0000
+    OPCODE_LUI,     0x60, 0x2c, 0x00, // [0x10] r6 <- 0x002c    - call
+    OPCODE_LLI,     0x60, 0x00, 0x00, // [0x14] r6 <- 0x0000
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x18]
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x1c]
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x20]
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x24]
+    OPCODE_NOP,     0x00, 0x00, 0x00, // [0x28]
+// call:
+    OPCODE_CALL,    0xc0, 0x00, 0x00, // [0x2c] call r12        - [sp - 4] <- 0x2c
+    OPCODE_ADDI,    0x11, 0x01, 0x00, // [0x30] r1 <- r1 + 1    - becomes GETCHAR r0
+    OPCODE_ADDI,    0xaa, 0x01, 0x00, // [0x34] r10 <- r10 + 1
+    OPCODE_LUI,     0x80, 0x01, 0x00, // [0x38] r8 <- 1
+    OPCODE_LLI,     0x80, 0x00, 0x00, // [0x3c] r8 <- 0x0000
+    OPCODE_LUI,     0x90, 0x54, 0x00, // [0x40] r9 <- 0x0054    - again
+    OPCODE_LLI,     0x90, 0x00, 0x00, // [0x44] r9 <- 0x0000
+    OPCODE_BEQ,     0xa8, 0x90, 0x00, // [0x48] if r10 == r8 then pc <- r9
+    OPCODE_PUTCHAR, 0x10, 0x00, 0x00, // [0x4c] putchar r1
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x50] end of program
+// again:
+    OPCODE_ADDI,    0xf5, 0x00, 0x00, // [0x54] sp <- r5 + 0
+    OPCODE_JMP,     0x60, 0x00, 0x00, // [0x58] pc <- r6        - call
+// f:
+    OPCODE_RET,     0x00, 0x00, 0x00, // [0x5c] return
+};
+
+// a loop pushing often enough to be compiled, whose last PUSH writes HLT
+// over the instruction after the loop. r1 ends as 0
+const byte pushLoopIntoCode[] = {
+    OPCODE_LUI,     0x00, OPCODE_HLT, 0x00, // [0x00] r0 <- HLT
+    OPCODE_LLI,     0x00, 0x00, 0x00, // [0x04] r0 <- 0x0000
+    OPCODE_LUI,     0xf0, 0xb0, 0x38, // [0x08] sp <- 0x38b0    - 0x2c + 4 * 20001
+    OPCODE_LLI,     0xf0, 0x01, 0x00, // [0x0c] sp <- 0x0001
+    OPCODE_LUI,     0x30, 0x21, 0x4e, // [0x10] r3 <- 20001     - count
+    OPCODE_LLI,     0x30, 0x00, 0x00, // [0x14] r3 <- 0x0000
+    OPCODE_LUI,     0xc0, 0x20, 0x00, // [0x18] r12 <- 0x0020   - loop
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x1c] r12 <- 0x0000
+// loop:
+    OPCODE_PUSH,    0x00, 0x00, 0x00, // [0x20] push r0
+    OPCODE_ADDI,    0x22, 0x01, 0x00, // [0x24] r2 <- r2 + 1
+    OPCODE_BLT,     0x23, 0xc0, 0x00, // [0x28] if r2 < r3 then pc <- r12
+    OPCODE_ADDI,    0x11, 0x01, 0x00, // [0x2c] r1 <- r1 + 1    - becomes HLT
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x30] end of program
+};
+
+// a function called often enough to be compiled whose first instruction
+// stores into the slot its PUSH uses - leaving for that store must not
+// come straight back into the function
+const byte storeIntoSlotAtEntry[] = {
+// main:
+    OPCODE_LUI,     0xf0, 0x00, 0x00, // [0x00] sp <- 0x0000
+    OPCODE_LLI,     0xf0, 0x01, 0x00, // [0x04] sp <- 0x0001
+    OPCODE_LUI,     0xb0, 0xf8, 0xff, // [0x08] r11 <- 0xfff8   - f's slot
+    OPCODE_LLI,     0xb0, 0x00, 0x00, // [0x0c] r11 <- 0x0000
+    OPCODE_LUI,     0x30, 0xe8, 0x03, // [0x10] r3 <- 1000      - count
+    OPCODE_LLI,     0x30, 0x00, 0x00, // [0x14] r3 <- 0x0000
+    OPCODE_LUI,     0xc0, 0x38, 0x00, // [0x18] r12 <- 0x0038   - f
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x1c] r12 <- 0x0000
+// loop:
+    OPCODE_CALL,    0xc0, 0x00, 0x00, // [0x20] call r12
+    OPCODE_ADDI,    0x22, 0x01, 0x00, // [0x24] r2 <- r2 + 1
+    OPCODE_LUI,     0x80, 0x20, 0x00, // [0x28] r8 <- 0x0020    - loop
+    OPCODE_LLI,     0x80, 0x00, 0x00, // [0x2c] r8 <- 0x0000
+    OPCODE_BLT,     0x23, 0x80, 0x00, // [0x30] if r2 < r3 then pc <- r8
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x34] end of program
+// f:
+    OPCODE_SB,      0xb2, 0x00, 0x00, // [0x38] [r11 + 0] <- r2
+    OPCODE_PUSH,    0x20, 0x00, 0x00, // [0x3c] push r2     - [0xfff8] <- r2
+    OPCODE_POP,     0x10, 0x00, 0x00, // [0x40] pop r1
+    OPCODE_RET,     0x00, 0x00, 0x00, // [0x44] return
+};
+
+// runs of PUSHes and POPs whose stack window crosses 2^31 or the end of
+// memory - each stops on the access that leaves memory
+const byte pushesAcross2To31[] = {
+    OPCODE_LUI,     0xf0, 0x04, 0x00, // [0x00] sp <- 0x0004
+    OPCODE_LLI,     0xf0, 0x00, 0x80, // [0x04] sp <- 0x8000
+    OPCODE_PUSH,    0x10, 0x00, 0x00, // [0x08] push r1
+    OPCODE_PUSH,    0x20, 0x00, 0x00, // [0x0c] push r2     - [0x7ffffffc] faults
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+const byte popsAcross2To31[] = {
+    OPCODE_LUI,     0xf0, 0xfc, 0xff, // [0x00] sp <- 0xfffc
+    OPCODE_LLI,     0xf0, 0xff, 0x7f, // [0x04] sp <- 0x7fff
+    OPCODE_POP,     0x10, 0x00, 0x00, // [0x08] pop r1      - [0x7ffffffc] faults
+    OPCODE_POP,     0x20, 0x00, 0x00, // [0x0c] pop r2
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+const byte pushesPastEndOfMemory[] = {
+    OPCODE_LUI,     0xf0, 0x04, 0x00, // [0x00] sp <- 0x0004
+    OPCODE_LLI,     0xf0, 0x10, 0x00, // [0x04] sp <- 0x0010
+    OPCODE_PUSH,    0x10, 0x00, 0x00, // [0x08] push r1     - [0x100000] faults
+    OPCODE_PUSH,    0x20, 0x00, 0x00, // [0x0c] push r2
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+const byte popsPastEndOfMemory[] = {
+    OPCODE_LUI,     0xf0, 0xfc, 0xff, // [0x00] sp <- 0xfffc
+    OPCODE_LLI,     0xf0, 0x0f, 0x00, // [0x04] sp <- 0x000f
+    OPCODE_POP,     0x10, 0x00, 0x00, // [0x08] pop r1
+    OPCODE_POP,     0x20, 0x00, 0x00, // [0x0c] pop r2      - [0x100000] faults
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+const byte popsBelowZero[] = {
+    OPCODE_LUI,     0xf0, 0xfc, 0xff, // [0x00] sp <- 0xfffc
+    OPCODE_LLI,     0xf0, 0xff, 0xff, // [0x04] sp <- 0xffff
+    OPCODE_POP,     0x10, 0x00, 0x00, // [0x08] pop r1      - [-4] faults
+    OPCODE_POP,     0x20, 0x00, 0x00, // [0x0c] pop r2
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+
+// function prologues and epilogues whose frame crosses 2^31 or the end
+// of memory
+const byte enterAcross2To31[] = {
+    OPCODE_LUI,     0xf0, 0x02, 0x00, // [0x00] sp <- 0x0002
+    OPCODE_LLI,     0xf0, 0x00, 0x80, // [0x04] sp <- 0x8000
+    OPCODE_PUSH,    0xe0, 0x00, 0x00, // [0x08] push bp     - [0x7ffffffe] faults
+    OPCODE_ADDI,    0xef, 0x00, 0x00, // [0x0c] bp <- sp + 0
+    OPCODE_SUBI,    0xff, 0x08, 0x00, // [0x10] sp <- sp - 8
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x14] end of program
+};
+const byte leaveAcross2To31[] = {
+    OPCODE_LUI,     0xe0, 0xfc, 0xff, // [0x00] bp <- 0xfffc
+    OPCODE_LLI,     0xe0, 0xff, 0x7f, // [0x04] bp <- 0x7fff
+    OPCODE_ADDI,    0xfe, 0x00, 0x00, // [0x08] sp <- bp + 0
+    OPCODE_POP,     0xe0, 0x00, 0x00, // [0x0c] pop bp      - [0x7ffffffc] faults
+    OPCODE_RET,     0x00, 0x00, 0x00, // [0x10] return
+};
+const byte enterPastEndOfMemory[] = {
+    OPCODE_LUI,     0xf0, 0x04, 0x00, // [0x00] sp <- 0x0004
+    OPCODE_LLI,     0xf0, 0x10, 0x00, // [0x04] sp <- 0x0010
+    OPCODE_PUSH,    0xe0, 0x00, 0x00, // [0x08] push bp     - [0x100000] faults
+    OPCODE_ADDI,    0xef, 0x00, 0x00, // [0x0c] bp <- sp + 0
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0x10] end of program
+};
+const byte leavePastEndOfMemory[] = {
+    OPCODE_LUI,     0xe0, 0xfc, 0xff, // [0x00] bp <- 0xfffc
+    OPCODE_LLI,     0xe0, 0x0f, 0x00, // [0x04] bp <- 0x000f
+    OPCODE_ADDI,    0xfe, 0x00, 0x00, // [0x08] sp <- bp + 0
+    OPCODE_POP,     0xe0, 0x00, 0x00, // [0x0c] pop bp
+    OPCODE_RET,     0x00, 0x00, 0x00, // [0x10] return      - [0x100000] faults
+};
+
+// DIVI/MODI by constants over dividends at the ends of the 32-bit range
+// and of the 16-bit immediates, in a loop run often enough to be
+// compiled. the divisors are 2 and -32768 (each as a DIVI/MODI pair),
+// 32767, -7, -3, 3, -2, and 1 and -1 (which have no reciprocal). -1 only
+// divides -5 - INT_MIN / -1 overflows. the results are stored from 0x1000
+const byte divideByConstants[] = {
+// main:
+    OPCODE_LUI,     0xb0, 0x2c, 0x01, // [0x00] r11 <- 300       - count
+    OPCODE_LLI,     0xb0, 0x00, 0x00, // [0x04] r11 <- 0x0000
+// outer:
+    OPCODE_LUI,     0x10, 0xc0, 0x00, // [0x08] r1 <- 0x00c0   - dividends
+    OPCODE_LLI,     0x10, 0x00, 0x00, // [0x0c] r1 <- 0x0000
+    OPCODE_LUI,     0x20, 0xec, 0x00, // [0x10] r2 <- 0x00ec   - end
+    OPCODE_LLI,     0x20, 0x00, 0x00, // [0x14] r2 <- 0x0000
+    OPCODE_LUI,     0xd0, 0x00, 0x10, // [0x18] r13 <- 0x1000   - results
+    OPCODE_LLI,     0xd0, 0x00, 0x00, // [0x1c] r13 <- 0x0000
+// inner:
+    OPCODE_LW,      0x31, 0x00, 0x00, // [0x20] r3 <- [r1 + 0]
+    OPCODE_DIVI,    0x43, 0x02, 0x00, // [0x24] r4 <- r3 / 2
+    OPCODE_MODI,    0x53, 0x02, 0x00, // [0x28] r5 <- r3 % 2
+    OPCODE_MODI,    0x63, 0x00, 0x80, // [0x2c] r6 <- r3 % -32768
+    OPCODE_DIVI,    0x73, 0x00, 0x80, // [0x30] r7 <- r3 / -32768
+    OPCODE_DIVI,    0x83, 0xff, 0x7f, // [0x34] r8 <- r3 / 32767
+    OPCODE_MODI,    0x93, 0xf9, 0xff, // [0x38] r9 <- r3 % -7
+    OPCODE_SW,      0xd4, 0x00, 0x00, // [0x3c] [r13 + 0] <- r4
+    OPCODE_SW,      0xd5, 0x04, 0x00, // [0x40] [r13 + 4] <- r5
+    OPCODE_SW,      0xd6, 0x08, 0x00, // [0x44] [r13 + 8] <- r6
+    OPCODE_SW,      0xd7, 0x0c, 0x00, // [0x48] [r13 + 12] <- r7
+    OPCODE_SW,      0xd8, 0x10, 0x00, // [0x4c] [r13 + 16] <- r8
+    OPCODE_SW,      0xd9, 0x14, 0x00, // [0x50] [r13 + 20] <- r9
+    OPCODE_ADDI,    0xdd, 0x18, 0x00, // [0x54] r13 <- r13 + 24
+    OPCODE_DIVI,    0x43, 0x01, 0x00, // [0x58] r4 <- r3 / 1
+    OPCODE_MODI,    0x53, 0x01, 0x00, // [0x5c] r5 <- r3 % 1
+    OPCODE_DIVI,    0x63, 0xfd, 0xff, // [0x60] r6 <- r3 / -3
+    OPCODE_MODI,    0x73, 0x03, 0x00, // [0x64] r7 <- r3 % 3
+    OPCODE_MODI,    0x83, 0x00, 0x80, // [0x68] r8 <- r3 % -32768
+    OPCODE_DIVI,    0x93, 0xfe, 0xff, // [0x6c] r9 <- r3 / -2
+    OPCODE_SW,      0xd4, 0x00, 0x00, // [0x70] [r13 + 0] <- r4
+    OPCODE_SW,      0xd5, 0x04, 0x00, // [0x74] [r13 + 4] <- r5
+    OPCODE_SW,      0xd6, 0x08, 0x00, // [0x78] [r13 + 8] <- r6
+    OPCODE_SW,      0xd7, 0x0c, 0x00, // [0x7c] [r13 + 12] <- r7
+    OPCODE_SW,      0xd8, 0x10, 0x00, // [0x80] [r13 + 16] <- r8
+    OPCODE_SW,      0xd9, 0x14, 0x00, // [0x84] [r13 + 20] <- r9
+    OPCODE_ADDI,    0xdd, 0x18, 0x00, // [0x88] r13 <- r13 + 24
+    OPCODE_ADDI,    0x11, 0x04, 0x00, // [0x8c] r1 <- r1 + 4
+    OPCODE_LUI,     0xc0, 0x20, 0x00, // [0x90] r12 <- 0x0020   - inner
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0x94] r12 <- 0x0000
+    OPCODE_BLT,     0x12, 0xc0, 0x00, // [0x98] if r1 < r2 then pc <- r12
+    OPCODE_ADDI,    0xaa, 0x01, 0x00, // [0x9c] r10 <- r10 + 1
+    OPCODE_LUI,     0xc0, 0x08, 0x00, // [0xa0] r12 <- 0x0008   - outer
+    OPCODE_LLI,     0xc0, 0x00, 0x00, // [0xa4] r12 <- 0x0000
+    OPCODE_BLT,     0xab, 0xc0, 0x00, // [0xa8] if r10 < r11 then pc <- r12
+    OPCODE_LUI,     0x30, 0xfb, 0xff, // [0xac] r3 <- 0xfffb   - -5
+    OPCODE_LLI,     0x30, 0xff, 0xff, // [0xb0] r3 <- 0xffff
+    OPCODE_DIVI,    0x43, 0xff, 0xff, // [0xb4] r4 <- r3 / -1
+    OPCODE_MODI,    0x53, 0xff, 0xff, // [0xb8] r5 <- r3 % -1
+    OPCODE_HLT,     0x00, 0x00, 0x00, // [0xbc] end of program
+// dividends:
+    0x00, 0x00, 0x00, 0x80, // [0xc0] -2147483648
+    0xff, 0xff, 0xff, 0x7f, // [0xc4] 2147483647
+    0xff, 0xff, 0xff, 0xff, // [0xc8] -1
+    0x00, 0x00, 0x00, 0x00, // [0xcc] 0
+    0x01, 0x00, 0x00, 0x00, // [0xd0] 1
+    0xff, 0x7f, 0x00, 0x00, // [0xd4] 32767
+    0x00, 0x80, 0xff, 0xff, // [0xd8] -32768
+    0x00, 0x80, 0x00, 0x00, // [0xdc] 32768
+    0xff, 0x7f, 0xff, 0xff, // [0xe0] -32769
+    0x07, 0xca, 0x9a, 0x3b, // [0xe4] 1000000007
+    0xeb, 0x32, 0xa4, 0xf8, // [0xe8] -123456789
+
+};
+
+//========================================================================
+// Runner
+
+struct Regression
+{
+    const char* name;
+    const byte* program;
+    size_t size;
+};
+
+#define REGRESSION(program) { #program, program, sizeof(program) }
+
+const Regression regressions[] = {
+    REGRESSION(loopTwoStores),
+    REGRESSION(pushIntoCode),
+    REGRESSION(callIntoCode),
+    REGRESSION(pushLoopIntoCode),
+    REGRESSION(storeIntoSlotAtEntry),
+    REGRESSION(pushesAcross2To31),
+    REGRESSION(popsAcross2To31),
+    REGRESSION(pushesPastEndOfMemory),
+    REGRESSION(popsPastEndOfMemory),
+    REGRESSION(popsBelowZero),
+    REGRESSION(enterAcross2To31),
+    REGRESSION(leaveAcross2To31),
+    REGRESSION(enterPastEndOfMemory),
+    REGRESSION(leavePastEndOfMemory),
+    REGRESSION(divideByConstants),
+};
+
+// programs also compiled with --aot - the native program has to print
+// what the reference engine prints
+const Regression nativeRegressions[] = {
+    REGRESSION(pushIntoCode),
+    REGRESSION(callIntoCode),
+};
+
+// every program ends well before this
+const uint64_t INSTRUCTION_LIMIT = 100000000;
+// the tiered engine compiles on a thread of its own, so each engine runs
+// a program this many times to catch results that depend on timing
+const int RUNS = 8;
+const size_t MEMORY_SIZE_BYTES = 1 << 20;
+
+// runs a program to the end on engine
+void
+runOn (AmyMachine& machine, const Regression& test, Engine engine)
+{
+    machine.engine = engine;
+    machine.load (test.program, test.size);
+    machine.closeInput ();
+    machine.run (INSTRUCTION_LIMIT);
+}
+
+// prints the first difference between a run and the reference run -
+// false if there is one
+bool
+compare (const MachineState& expected, const MachineState& actual, const char* name, Engine engine)
+{
+    const char* engineText = engineName (engine);
+    if (actual.currentInstructionAddress != expected.currentInstructionAddress)
+    {
+        printf ("%s: %s stopped at %x instead of %x\n", name, engineText,
+            actual.currentInstructionAddress, expected.currentInstructionAddress);
+        return false;
+    }
+    if (actual.instructionsRetired != expected.instructionsRetired)
+    {
+        printf ("%s: %s retired %lu instructions instead of %lu\n", name, engineText,
+            (unsigned long)actual.instructionsRetired, (unsigned long)expected.instructionsRetired);
+        return false;
+    }
+    for (int r = 0; r < 16; ++r)
+    {
+        if (actual.registers[r] == expected.registers[r]) continue;
+        printf ("%s: %s ended with r%d = %x instead of %x\n", name, engineText,
+            r, actual.registers[r], expected.registers[r]);
+        return false;
+    }
+    for (size_t i = 0; i < expected.memorySize; ++i)
+    {
+        if (actual.memory[i] == expected.memory[i]) continue;
+        printf ("%s: %s ended with [%zx] = %x instead of %x\n", name, engineText,
+            i, actual.memory[i], expected.memory[i]);
+        return false;
+    }
+    return true;
+}
+
+// what a program prints on the reference engine
+std::string
+referenceOutput (AmyMachine& machine, const Regression& test)
+{
+    fflush (stdout);
+    int saved = dup (1);
+    FILE* output = tmpfile ();
+    dup2 (fileno (output), 1);
+    runOn (machine, test, ENGINE_REFERENCE);
+    fflush (stdout);
+    dup2 (saved, 1);
+    close (saved);
+    std::string text;
+    rewind (output);
+    for (int c = fgetc (output); c != EOF; c = fgetc (output)) text += (char)c;
+    fclose (output);
+    return text;
+}
+
+// what the program compiled with --aot prints (with stdin closed) - 
+// false if it could not be compiled or run
+bool
+nativeOutput (AmyMachine& machine, const Regression& test, std::string& text)
+{
+    std::string path = "/tmp/amyRegression_" + std::to_string (getpid ()) + "_" + test.name;
+    machine.load (test.program, test.size);
+    bool compiled = machine.compileNative (path.c_str ());
+    FILE* output = compiled ? popen (("'" + path + "' < /dev/null").c_str (), "r") : nullptr;
+    if (output != nullptr)
+    {
+        for (int c = fgetc (output); c != EOF; c = fgetc (output)) text += (char)c;
+        pclose (output);
+    }
+    remove (path.c_str ());
+    remove ((path + ".cpp").c_str ());
+    return output != nullptr;
+}
+
+int
+main ()
+{
+    AmyMachine reference (MEMORY_SIZE_BYTES);
+    AmyMachine machine (MEMORY_SIZE_BYTES);
+    int failed = 0;
+    for (const Regression& test : regressions)
+    {
+        runOn (reference, test, ENGINE_REFERENCE);
+        for (int e = ENGINE_REFERENCE + 1; e < NUM_ENGINES; ++e)
+        {
+            for (int run = 0; run < RUNS; ++run)
+            {
+                runOn (machine, test, (Engine)e);
+                if (!compare (reference.state, machine.state, test.name, (Engine)e))
+                {
+                    ++failed;
+                    break;
+                }
+            }
+        }
+    }
+    for (const Regression& test : nativeRegressions)
+    {
+        std::string expected = referenceOutput (reference, test);
+        std::string actual;
+        if (!nativeOutput (machine, test, actual))
+        {
+            printf ("%s: could not compile and run it with --aot\n", test.name);
+            ++failed;
+        }
+        else if (actual != expected)
+        {
+            printf ("%s: printed %zu bytes with --aot that differ from the reference engine's %zu\n",
+                test.name, actual.size (), expected.size ());
+            ++failed;
+        }
+    }
+    if (failed == 0) printf ("All %zu programs ran the same on every engine (%zu compiled with --aot)\n",
+        sizeof(regressions) / sizeof(regressions[0]),
+        sizeof(nativeRegressions) / sizeof(nativeRegressions[0]));
+    return failed == 0 ? 0 : 1;
+}
+
+//========================================================================